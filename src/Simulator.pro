@@ -1,72 +1,43 @@
-QT += widgets
 QT += network xml
 
-INCLUDEPATH += ./qextserialport
-SOURCES += \
-    main.cpp \
-    qextserialport/win_qextserialport.cpp \
-    qextserialport/qextserialport.cpp \
-    qextserialport/qextserialbase.cpp \
-    roadbranchwidget.cpp \
-    mutility.cpp \
-    serialdata.cpp \
-    detectorideditwidget.cpp \
-    detectoriddelegate.cpp \
-    simulatorwidget.cpp \
-    synccommand.cpp \
-    command.cpp \
-    xmlhelper.cpp \
-    tscparam.cpp \
-    filereaderwriter.cpp \
-    mdatabase.cpp \
-    timingparam.cpp \
-    timesection.cpp \
-    signalerparam.cpp \
-    phasetiming.cpp \
-    phaseparam.cpp \
-    phaseconflictparam.cpp \
-    detectorparam.cpp \
-    channelparam.cpp \
-    scheduleparam.cpp \
-    testdlg.cpp \
-    phasehandler.cpp
+include(simulatorcore.pri)
 
-HEADERS += \
-    qextserialport/win_qextserialport.h \
-    qextserialport/qextserialport.h \
-    qextserialport/qextserialbase.h \
-    macrostrings.h \
-    roadbranchwidget.h \
-    mutility.h \
-    serialdata.h \
-    detectorideditwidget.h \
-    utilmacros.h \
-    detectoriddelegate.h \
-    simulatorwidget.h \
-    synccommand.h \
-    command.h \
-    xmlhelper.h \
-    tscparam.h \
-    tsc.h \
-    filereaderwriter.h \
-    mdatabase.h \
-    timingparam.h \
-    timesection.h \
-    signalerparam.h \
-    scheduleparam.h \
-    phasetiming.h \
-    phaseparam.h \
-    phaseconflictparam.h \
-    detectorparam.h \
-    channelparam.h \
-    testdlg.h \
-    phasehandler.h
+# qmake CONFIG+=headless builds the widget-free console simulator
+headless {
+    QT -= gui xml
+    CONFIG += console
+    CONFIG -= app_bundle
+    TARGET = SimulatorConsole
 
+    SOURCES += \
+        consolemain.cpp \
+        qextserialport/qextserialport.cpp
 
-DESTDIR = ./
+    HEADERS += \
+        qextserialport/qextserialport.h
+
+    unix:SOURCES += qextserialport/posix_qextserialport.cpp \
+        qextserialport/posix_qextptyport.cpp
+    unix:HEADERS += qextserialport/posix_qextserialport.h \
+        qextserialport/posix_qextptyport.h \
+        qextserialport/qextspscqueue.h
+    unix:DEFINES += _TTY_POSIX_
+
+    win32:SOURCES += qextserialport/win_qextserialport.cpp
+    win32:HEADERS += qextserialport/win_qextserialport.h
+    win32:DEFINES += _TTY_WIN_
+} else {
+    QT += widgets
+
+    include(simulatorgui.pri)
 
-TRANSLATIONS = $$PWD/../resource/languages/simulator.ts
+    SOURCES += main.cpp
 
-RC_FILE = ../resource/appicon.rc
+    TRANSLATIONS = $$PWD/../resource/languages/simulator.ts
+
+    RC_FILE = ../resource/appicon.rc
+}
+
+DESTDIR = ./
 
 RESOURCES +=
@@ -0,0 +1,214 @@
+#include "arrivalgenerator.h"
+
+#include <QString>
+#include <math.h>
+
+#define USECS_PER_HOUR  3600000000.0
+
+ArrivalGenerator::ArrivalGenerator(int lane_count, quint64 seed)
+{
+    seed_ = seed;
+    occupancy_ms_ = DETECTOR_OCCUPANCY_MS;
+    setLaneCount(lane_count);
+    setSeed(seed);
+}
+
+void ArrivalGenerator::setSeed(quint64 seed)
+{
+    seed_ = seed;
+    common_rng_.seed(FastRandom::streamSeed(seed_, -1));
+    for (int i = 0; i < lane_list_.size(); i++)
+    {
+        seedLane(i);
+    }
+}
+
+void ArrivalGenerator::setLaneCount(int lane_count)
+{
+    int old_count = lane_list_.size();
+    lane_list_.resize(lane_count);
+    for (int i = old_count; i < lane_count; i++)
+    {
+        lane_list_[i].model = Poisson;
+        lane_list_[i].flow_vph = 0;
+        lane_list_[i].next_us = -1;
+        seedLane(i);
+    }
+}
+
+int ArrivalGenerator::laneCount() const
+{
+    return lane_list_.size();
+}
+
+void ArrivalGenerator::setLaneFlow(int lane_index, ArrivalGenerator::Model model, double flow_vph)
+{
+    if (lane_index < 0 || lane_index >= lane_list_.size())
+    {
+        return;
+    }
+    LaneStream &lane = lane_list_[lane_index];
+    lane.model = model;
+    lane.flow_vph = flow_vph > 0 ? flow_vph : 0;
+    lane.next_us = -1;
+    lane.platoon_left = 0;
+}
+
+void ArrivalGenerator::setAllLaneFlow(ArrivalGenerator::Model model, double flow_vph)
+{
+    for (int i = 0; i < lane_list_.size(); i++)
+    {
+        setLaneFlow(i, model, flow_vph);
+    }
+}
+
+void ArrivalGenerator::setOccupancy(int msecs)
+{
+    occupancy_ms_ = msecs > 0 ? msecs : 1;
+}
+
+bool ArrivalGenerator::isEnabled() const
+{
+    for (int i = 0; i < lane_list_.size(); i++)
+    {
+        if (lane_list_.at(i).flow_vph > 0)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+// restart all streams and schedule the first arrival of every lane
+void ArrivalGenerator::reset(qint64 now_us)
+{
+    setSeed(seed_);
+    for (int i = 0; i < lane_list_.size(); i++)
+    {
+        LaneStream &lane = lane_list_[i];
+        lane.platoon_left = 0;
+        lane.next_us = lane.flow_vph > 0 ? now_us + headwayUs(lane) : -1;
+    }
+}
+
+// appends the index of every lane with an arrival due by now_us, once per vehicle
+int ArrivalGenerator::takeArrivals(qint64 now_us, QList<int> &lane_list)
+{
+    int count = 0;
+    for (int i = 0; i < lane_list_.size(); i++)
+    {
+        LaneStream &lane = lane_list_[i];
+        if (lane.flow_vph <= 0)
+        {
+            continue;
+        }
+        if (lane.next_us < 0)
+        {
+            lane.next_us = now_us + headwayUs(lane);
+            continue;
+        }
+        int backlog = 0;
+        while (lane.next_us <= now_us)
+        {
+            if (++backlog > ARRIVAL_MAX_BACKLOG)
+            {
+                // poller stalled, drop the rest instead of bursting
+                lane.next_us = now_us + headwayUs(lane);
+                break;
+            }
+            lane_list.append(i);
+            count++;
+            lane.next_us += headwayUs(lane);
+        }
+    }
+    return count;
+}
+
+// occupancy of one vehicle, +-1/3 jitter
+qint64 ArrivalGenerator::occupancyUs(int lane_index)
+{
+    FastRandom &rng = (lane_index >= 0 && lane_index < lane_list_.size()) ? lane_list_[lane_index].rng : common_rng_;
+    double factor = 2.0 / 3 + rng.uniform() * 2.0 / 3;
+    return (qint64)(occupancy_ms_ * 1000 * factor);
+}
+
+int ArrivalGenerator::uniformLane(int lane_count)
+{
+    return lane_count > 0 ? (int)common_rng_.bounded(lane_count) : 0;
+}
+
+FastRandom &ArrivalGenerator::random()
+{
+    return common_rng_;
+}
+
+ArrivalGenerator::Model ArrivalGenerator::modelOfName(const QString &name, bool *ok)
+{
+    if (ok != 0)
+    {
+        *ok = true;
+    }
+    if (name == "poisson")
+    {
+        return Poisson;
+    }
+    if (name == "platoon")
+    {
+        return Platoon;
+    }
+    if (name == "constant")
+    {
+        return ConstantHeadway;
+    }
+    if (ok != 0)
+    {
+        *ok = false;
+    }
+    return Poisson;
+}
+
+qint64 ArrivalGenerator::headwayUs(ArrivalGenerator::LaneStream &lane)
+{
+    double mean_us = USECS_PER_HOUR / lane.flow_vph;
+    double headway = mean_us;
+    switch (lane.model)
+    {
+    case Poisson:
+        headway = -log(1.0 - lane.rng.uniform()) * mean_us;
+        break;
+    case Platoon:
+        if (lane.platoon_left > 0)
+        {
+            lane.platoon_left--;
+            headway = PLATOON_HEADWAY_MS * 1000.0;
+        }
+        else
+        {
+            // geometric platoon size with mean PLATOON_MEAN_SIZE
+            int size = 1;
+            while (lane.rng.uniform() > 1.0 / PLATOON_MEAN_SIZE)
+            {
+                size++;
+            }
+            lane.platoon_left = size - 1;
+            // gap between platoons keeps the mean flow at flow_vph
+            double gap_mean = PLATOON_MEAN_SIZE * mean_us - (PLATOON_MEAN_SIZE - 1) * PLATOON_HEADWAY_MS * 1000.0;
+            if (gap_mean < PLATOON_HEADWAY_MS * 1000.0)
+            {
+                gap_mean = PLATOON_HEADWAY_MS * 1000.0;
+            }
+            headway = -log(1.0 - lane.rng.uniform()) * gap_mean;
+        }
+        break;
+    case ConstantHeadway:
+    default:
+        break;
+    }
+    return headway < 1 ? 1 : (qint64)headway;
+}
+
+void ArrivalGenerator::seedLane(int lane_index)
+{
+    lane_list_[lane_index].rng.seed(FastRandom::streamSeed(seed_, lane_index));
+    lane_list_[lane_index].platoon_left = 0;
+}
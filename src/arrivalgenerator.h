@@ -0,0 +1,70 @@
+#ifndef ARRIVALGENERATOR_H
+#define ARRIVALGENERATOR_H
+
+#include <QList>
+#include <QVector>
+#include "fastrandom.h"
+
+class QString;
+
+#define PLATOON_MEAN_SIZE       4
+#define PLATOON_HEADWAY_MS      2000    // saturation headway inside a platoon
+#define DETECTOR_OCCUPANCY_MS   300     // enter -> leave of one vehicle
+#define ARRIVAL_MAX_BACKLOG     64      // arrivals per lane caught up in one poll
+
+/* Per-detector vehicle arrivals.
+ * Every lane has its own flow (vehicles/hour), arrival model and random
+ * stream, so the arrivals of one lane do not depend on how often the others
+ * are polled. Times are FrameClock microseconds.
+*/
+class ArrivalGenerator
+{
+public:
+    enum Model
+    {
+        Poisson = 0,        // exponential headways
+        Platoon,            // geometric sized platoons at saturation headway
+        ConstantHeadway
+    };
+
+    explicit ArrivalGenerator(int lane_count = 0, quint64 seed = 1);
+
+    void setSeed(quint64 seed);
+    void setLaneCount(int lane_count);
+    int laneCount() const;
+    void setLaneFlow(int lane_index, Model model, double flow_vph);
+    void setAllLaneFlow(Model model, double flow_vph);
+    void setOccupancy(int msecs);
+    bool isEnabled() const;
+
+    void reset(qint64 now_us);
+    int takeArrivals(qint64 now_us, QList<int> &lane_list);
+    qint64 occupancyUs(int lane_index);
+
+    // legacy single lane pick, drawn from a stream of its own
+    int uniformLane(int lane_count);
+    FastRandom &random();
+
+    static Model modelOfName(const QString &name, bool *ok = 0);
+
+private:
+    struct LaneStream
+    {
+        Model model;
+        double flow_vph;
+        FastRandom rng;
+        qint64 next_us;
+        int platoon_left;
+    };
+
+    qint64 headwayUs(LaneStream &lane);
+    void seedLane(int lane_index);
+
+private:
+    QVector<LaneStream> lane_list_;
+    FastRandom common_rng_;
+    quint64 seed_;
+    int occupancy_ms_;
+};
+
+#endif // ARRIVALGENERATOR_H
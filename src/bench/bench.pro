@@ -0,0 +1,18 @@
+# micro-benchmarks of the simulator hot paths, qmake && make && ./SimulatorBench
+# widget benchmarks (CYT parsing) need the windows serial port, like the gui itself.
+
+QT += testlib network xml
+QT -= gui
+CONFIG += console
+CONFIG -= app_bundle
+TARGET = SimulatorBench
+
+include(../simulatorcore.pri)
+
+win32 {
+    QT += gui widgets
+    include(../simulatorgui.pri)
+    DEFINES += BENCH_WIDGET
+}
+
+SOURCES += simulatorbench.cpp
@@ -0,0 +1,382 @@
+#include <QtTest>
+#include <QTemporaryDir>
+
+#include "simulatorcore.h"
+#include "mdatabase.h"
+#include "databasestore.h"
+#include "phasehandler.h"
+#include "filereaderwriter.h"
+#include "tscparam.h"
+#include "tscimage.h"
+#include "cytdecoder.h"
+#include "tracefile.h"
+#include "tracereplayer.h"
+#ifdef BENCH_WIDGET
+#include <QApplication>
+#include "simulatorwidget.h"
+#endif
+
+#define BENCH_PHASE_COUNT       4
+#define BENCH_CHANNEL_COUNT     16
+#define BENCH_DETECTOR_COUNT    48
+#define BENCH_MSG_COUNT         64
+
+/* Fixed inputs only: a generated four phase / sixteen channel config and a
+ * canned CYT3 light status message, so runs are comparable.
+*/
+class SimulatorBench : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void cleanupTestCase();
+
+    void packComData();
+    void trafficDispatch();
+    void isChannelAccessible();
+    void readFile();
+    void readCompactFile();
+    void getPhaseTable();
+    void databaseSnapshot();
+    void getChannelTable();
+    void getDetectorTable();
+    void getTimeconfigTable();
+    void cytParserFraming();
+    void lightPlaneDiff();
+    void traceReplay();
+#ifdef BENCH_WIDGET
+    void parseLightStatusContent();
+    void onCmdParseParamFraming();
+#endif
+
+private:
+    static void fillParam(TSCParam &param);
+    static QByteArray lightStatusMessage();
+
+private:
+    QTemporaryDir dir_;
+    QString cfg_path_;
+    MDatabase *db_;
+    SimulatorCore *core_;
+};
+
+void SimulatorBench::fillParam(TSCParam &param)
+{
+    param.phase_table_.FactPhaseNum = BENCH_PHASE_COUNT;
+    for (int i = 0; i < BENCH_PHASE_COUNT; i++)
+    {
+        param.phase_table_.PhaseList[i].PhaseId = i + 1;
+        param.phase_table_.PhaseList[i].PhaseType = 0x01;
+        param.phase_table_.PhaseList[i].PhaseMinGreen = 10;
+        param.phase_table_.PhaseList[i].PhaseMaxGreen1 = 40;
+    }
+    param.channel_table_.FactChannelNum = BENCH_CHANNEL_COUNT;
+    param.channel_hint_table_.FactChannelHintNum = BENCH_CHANNEL_COUNT;
+    for (int i = 0; i < BENCH_CHANNEL_COUNT; i++)
+    {
+        param.channel_table_.ChannelList[i].ChannelId = i + 1;
+        param.channel_table_.ChannelList[i].ChannelCtrlSrc = i % BENCH_PHASE_COUNT + 1;
+        param.channel_table_.ChannelList[i].ChannelType = 2;
+        param.channel_hint_table_.ChannelHintList[i].ChannelId = i + 1;
+    }
+    param.detector_table_.FactDetectorNum = BENCH_DETECTOR_COUNT;
+    for (int i = 0; i < BENCH_DETECTOR_COUNT; i++)
+    {
+        param.detector_table_.DetectorList[i].DetectorId = i + 1;
+        param.detector_table_.DetectorList[i].DetectorPhase = i % BENCH_PHASE_COUNT + 1;
+    }
+    param.stage_timing_table_.FactTimeConfigNum = 1;
+    param.stage_timing_table_.FactStageNum = BENCH_PHASE_COUNT;
+    for (int i = 0; i < BENCH_PHASE_COUNT; i++)
+    {
+        param.stage_timing_table_.TimeConfigList[0][i].TimeConfigId = 1;
+        param.stage_timing_table_.TimeConfigList[0][i].StageId = i + 1;
+        param.stage_timing_table_.TimeConfigList[0][i].PhaseId = 0x01 << i;
+        param.stage_timing_table_.TimeConfigList[0][i].GreenTime = 20;
+        param.stage_timing_table_.TimeConfigList[0][i].YellowTime = 3;
+        param.stage_timing_table_.TimeConfigList[0][i].RedTime = 2;
+    }
+}
+
+// CYT3: size, then per light group a separator and red/yellow/green bits,
+// work mode, plan id, released phase bits and END
+QByteArray SimulatorBench::lightStatusMessage()
+{
+    QByteArray msg("CYT3");
+    msg.append('4');
+    for (int i = 0; i < 4; i++)
+    {
+        msg.append(',');
+        msg.append((char)0x0e);
+        msg.append((char)0x00);
+        msg.append((char)0x11);
+    }
+    msg.append((char)SimulatorCore::FullInduction);
+    msg.append((char)1);
+    unsigned int phase_id = 0x01;
+    msg.append((const char *)&phase_id, sizeof(phase_id));
+    msg.append("END");
+    return msg;
+}
+
+void SimulatorBench::initTestCase()
+{
+    QVERIFY(dir_.isValid());
+    cfg_path_ = dir_.path() + "/bench.dat";
+    TSCParam *param = new TSCParam;
+    fillParam(*param);
+    FileReaderWriter writer;
+    QVERIFY(writer.WriteFile(*param, cfg_path_.toLocal8Bit().constData()));
+    delete param;
+
+    db_ = new MDatabase;
+    FileReaderWriter reader;
+    QVERIFY(reader.ReadFile(db_, cfg_path_.toLocal8Bit().constData()));
+
+    core_ = new SimulatorCore;
+    core_->initDatabase(db_);
+    QList<int> lane_detector_id_list;
+    for (int i = 0; i < LANE_COUNT; i++)
+    {
+        lane_detector_id_list.append(i + 1);
+    }
+    core_->setLaneDetectorIdList(lane_detector_id_list);
+    core_->setCtrlMode(SimulatorCore::FullInduction);
+    core_->setPhaseIds(0x01);
+}
+
+void SimulatorBench::cleanupTestCase()
+{
+    delete core_;
+    delete db_;
+}
+
+void SimulatorBench::packComData()
+{
+    int lane = 0;
+    QBENCHMARK
+    {
+        core_->packComData(lane, lane & 0x01);
+        lane = (lane + 1) % LANE_COUNT;
+    }
+}
+
+// no device attached, the writer drops the batch on flush
+void SimulatorBench::trafficDispatch()
+{
+    QBENCHMARK
+    {
+        core_->trafficDispatch(1);
+        core_->writer_->clear();
+    }
+}
+
+void SimulatorBench::isChannelAccessible()
+{
+    unsigned char channel = 1;
+    QBENCHMARK
+    {
+        core_->isChannelAccessible(1, channel);
+        channel = channel % BENCH_CHANNEL_COUNT + 1;
+    }
+}
+
+void SimulatorBench::readFile()
+{
+    MDatabase db;
+    QByteArray path = cfg_path_.toLocal8Bit();
+    QBENCHMARK
+    {
+        FileReaderWriter reader;
+        reader.ReadFile(&db, path.constData());
+    }
+}
+
+// same config in the compact form, read back to the legacy image
+void SimulatorBench::readCompactFile()
+{
+    QString path = dir_.path() + "/bench.cfg";
+    TSCParam *param = new TSCParam;
+    fillParam(*param);
+    FileReaderWriter writer;
+    QVERIFY(writer.WriteCompactFile(*param, path.toLocal8Bit().constData()));
+    QVERIFY(QFileInfo(path).size() < TscImage::imageSize());
+    QByteArray image = TscImage::pack(*param);
+    delete param;
+
+    TscImage compact;
+    QVERIFY(compact.open(path));
+    QCOMPARE(QByteArray(compact.tableData(TscImage::Header), TscImage::imageSize()), image);
+    compact.close();
+
+    MDatabase db;
+    QByteArray local_path = path.toLocal8Bit();
+    QBENCHMARK
+    {
+        FileReaderWriter reader;
+        reader.ReadFile(&db, local_path.constData());
+    }
+}
+
+void SimulatorBench::getPhaseTable()
+{
+    QBENCHMARK
+    {
+        db_->get_phase_table();
+    }
+}
+
+// what a reader pays per look at the current config
+void SimulatorBench::databaseSnapshot()
+{
+    DatabaseStore store;
+    store.publish(new MDatabase(*db_));
+    QCOMPARE(store.version(), (quint64)1);
+    int phase_count = 0;
+    QBENCHMARK
+    {
+        DatabaseStore::Snapshot snapshot = store.snapshot();
+        phase_count = snapshot->get_phase().FactPhaseNum;
+    }
+    QCOMPARE(phase_count, BENCH_PHASE_COUNT);
+}
+
+void SimulatorBench::getChannelTable()
+{
+    QBENCHMARK
+    {
+        db_->get_channel_table();
+    }
+}
+
+void SimulatorBench::getDetectorTable()
+{
+    QBENCHMARK
+    {
+        db_->get_detector_table();
+    }
+}
+
+void SimulatorBench::getTimeconfigTable()
+{
+    QBENCHMARK
+    {
+        db_->get_timeconfig_table();
+    }
+}
+
+// BENCH_MSG_COUNT light status messages behind some garbage, fed in odd sized reads
+void SimulatorBench::cytParserFraming()
+{
+    QByteArray stream("\x01\x02garbage");
+    for (int i = 0; i < BENCH_MSG_COUNT; i++)
+    {
+        stream.append(lightStatusMessage());
+    }
+    CytParser parser;
+    CytDecoder::registerFraming(parser);
+    QByteArray message;
+    QBENCHMARK
+    {
+        int count = 0;
+        for (int pos = 0; pos < stream.size(); pos += 7)
+        {
+            parser.feed(stream.constData() + pos, qMin(7, stream.size() - pos));
+            while (parser.next(message) == CytParser::Message)
+            {
+                count++;
+            }
+        }
+        QCOMPARE(count, BENCH_MSG_COUNT);
+    }
+}
+
+// decode and diff of a light status against the previous one, one lamp changing per message
+void SimulatorBench::lightPlaneDiff()
+{
+    LightStatusInfo info;
+    QVERIFY(CytDecoder::decode(CytParser::payload(lightStatusMessage()), info));
+    LightPlanes prev, curr;
+    CytDecoder::toPlanes(info, prev);
+    int changed_count = 0;
+    QBENCHMARK
+    {
+        info.lights[0].green ^= 0x01;
+        CytDecoder::toPlanes(info, curr);
+        quint32 changed = CytDecoder::changedChannels(prev, curr);
+        for (int id = 1; changed != 0; id++, changed >>= 1)
+        {
+            if (changed & 0x01)
+            {
+                CytDecoder::channelColor(curr, id);
+                changed_count++;
+            }
+        }
+        prev = curr;
+    }
+    QVERIFY(changed_count > 0);
+}
+
+// a recorded trace of BENCH_MSG_COUNT light status messages in 7 byte reads, replayed at max speed
+void SimulatorBench::traceReplay()
+{
+    QString path = dir_.path() + "/bench.trc";
+    QByteArray stream;
+    for (int i = 0; i < BENCH_MSG_COUNT; i++)
+    {
+        stream.append(lightStatusMessage());
+    }
+    TraceFile trace;
+    QVERIFY(trace.create(path));
+    for (int pos = 0; pos < stream.size(); pos += 7)
+    {
+        QVERIFY(trace.append(pos, stream.constData() + pos, qMin(7, stream.size() - pos)));
+    }
+    trace.close();
+    QVERIFY(trace.openRead(path));
+    QCOMPARE(trace.totalBytes(), (qint64)stream.size());
+    CytParser parser;
+    CytDecoder::registerFraming(parser);
+    QBENCHMARK
+    {
+        QCOMPARE(TraceReplayer::feedParser(trace, parser), BENCH_MSG_COUNT);
+    }
+}
+
+#ifdef BENCH_WIDGET
+void SimulatorBench::parseLightStatusContent()
+{
+    SimulatorWidget widget;
+    widget.is_first_ = false;
+    const QByteArray msg = lightStatusMessage();
+    const QByteArray payload = CytParser::payload(msg);
+    QBENCHMARK
+    {
+        widget.parseLightStatusContent(payload);
+    }
+}
+
+// BENCH_MSG_COUNT light status messages arriving in one read
+void SimulatorBench::onCmdParseParamFraming()
+{
+    SimulatorWidget widget;
+    widget.is_first_ = false;
+    QByteArray burst;
+    for (int i = 0; i < BENCH_MSG_COUNT; i++)
+    {
+        burst.append(lightStatusMessage());
+    }
+    QBENCHMARK
+    {
+        QByteArray array = burst;
+        widget.onCmdParseParam(array);
+    }
+}
+
+QTEST_MAIN(SimulatorBench)
+#else
+QTEST_GUILESS_MAIN(SimulatorBench)
+#endif
+
+#include "simulatorbench.moc"
@@ -0,0 +1,137 @@
+#include "capturefile.h"
+
+#include <string.h>
+
+CaptureFile::CaptureFile()
+{
+    map_ = NULL;
+    count_ = 0;
+    writing_ = false;
+}
+
+CaptureFile::~CaptureFile()
+{
+    close();
+}
+
+bool CaptureFile::create(const QString &path)
+{
+    close();
+    file_.setFileName(path);
+    if (!file_.open(QIODevice::WriteOnly | QIODevice::Truncate))
+    {
+        return false;
+    }
+    char header[CAPTURE_HEADER_SIZE] = {'\0'};
+    quint32 record_size = sizeof(CaptureRecord);
+    memcpy(header, CAPTURE_MAGIC, 8);
+    memcpy(header + 8, &record_size, sizeof(record_size));
+    if (file_.write(header, CAPTURE_HEADER_SIZE) != CAPTURE_HEADER_SIZE)
+    {
+        file_.close();
+        return false;
+    }
+    writing_ = true;
+    return true;
+}
+
+bool CaptureFile::append(qint64 time_us, const char *frame)
+{
+    if (!writing_)
+    {
+        return false;
+    }
+    CaptureRecord rec;
+    rec.time_us = time_us;
+    memcpy(rec.frame, frame, SerialData::Size);
+    rec.reserved[0] = '\0';
+    rec.reserved[1] = '\0';
+    count_++;
+    return file_.write((const char *)&rec, sizeof(rec)) == sizeof(rec);
+}
+
+bool CaptureFile::openRead(const QString &path)
+{
+    close();
+    file_.setFileName(path);
+    if (!file_.open(QIODevice::ReadOnly))
+    {
+        return false;
+    }
+    qint64 size = file_.size();
+    if (size < CAPTURE_HEADER_SIZE)
+    {
+        file_.close();
+        return false;
+    }
+    map_ = file_.map(0, size);
+    if (map_ == NULL)
+    {
+        file_.close();
+        return false;
+    }
+    quint32 record_size = 0;
+    memcpy(&record_size, map_ + 8, sizeof(record_size));
+    if (memcmp(map_, CAPTURE_MAGIC, 8) != 0 || record_size != sizeof(CaptureRecord))
+    {
+        close();
+        return false;
+    }
+    count_ = (int)((size - CAPTURE_HEADER_SIZE) / sizeof(CaptureRecord));
+    return true;
+}
+
+int CaptureFile::count() const
+{
+    return count_;
+}
+
+const CaptureRecord &CaptureFile::record(int index) const
+{
+    return ((const CaptureRecord *)(map_ + CAPTURE_HEADER_SIZE))[index];
+}
+
+// first record at or after time_us, count() if there is none
+int CaptureFile::indexOfTime(qint64 time_us) const
+{
+    int low = 0;
+    int high = count_;
+    while (low < high)
+    {
+        int mid = low + (high - low) / 2;
+        if (record(mid).time_us < time_us)
+        {
+            low = mid + 1;
+        }
+        else
+        {
+            high = mid;
+        }
+    }
+    return low;
+}
+
+void CaptureFile::close()
+{
+    if (map_ != NULL)
+    {
+        file_.unmap((uchar *)map_);
+        map_ = NULL;
+    }
+    if (file_.isOpen())
+    {
+        file_.close();
+    }
+    count_ = 0;
+    writing_ = false;
+}
+
+bool CaptureFile::isOpen() const
+{
+    return file_.isOpen();
+}
+
+QString CaptureFile::errorString() const
+{
+    return file_.errorString();
+}
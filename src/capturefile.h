@@ -0,0 +1,54 @@
+#ifndef CAPTUREFILE_H
+#define CAPTUREFILE_H
+
+#include <QFile>
+#include <QString>
+#include "serialdata.h"
+
+#define CAPTURE_MAGIC           "SIMCAP01"
+#define CAPTURE_HEADER_SIZE     16
+
+/* One emitted frame. Records have a fixed size, so record i lives at
+ * CAPTURE_HEADER_SIZE + i * sizeof(CaptureRecord) and the time ordered
+ * record array is its own index.
+*/
+struct CaptureRecord
+{
+    qint64 time_us;                 // FrameClock when the frame was accepted for output
+    char frame[SerialData::Size];
+    char reserved[2];
+};
+
+Q_STATIC_ASSERT(sizeof(CaptureRecord) == 16);
+
+/* Append-only capture of detector frames.
+ * Header: magic[8], record size (quint32), reserved (quint32), then the
+ * records in native byte order. A capture being written can be opened for
+ * reading at the same time; a torn last record is ignored.
+*/
+class CaptureFile
+{
+public:
+    CaptureFile();
+    ~CaptureFile();
+
+    bool create(const QString &path);
+    bool append(qint64 time_us, const char *frame);
+
+    bool openRead(const QString &path);
+    int count() const;
+    const CaptureRecord &record(int index) const;
+    int indexOfTime(qint64 time_us) const;
+
+    void close();
+    bool isOpen() const;
+    QString errorString() const;
+
+private:
+    QFile file_;
+    const uchar *map_;
+    int count_;
+    bool writing_;
+};
+
+#endif // CAPTUREFILE_H
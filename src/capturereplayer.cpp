@@ -0,0 +1,108 @@
+#include "capturereplayer.h"
+#include "framewriter.h"
+#include "frameclock.h"
+
+#include <QTimer>
+
+CaptureReplayer::CaptureReplayer(QObject *parent) :
+    QObject(parent)
+{
+    writer_ = new FrameWriter(FRAME_WRITER_CAPACITY, this);
+    timer_ = new QTimer(this);
+    timer_->setSingleShot(true);
+    timer_->setTimerType(Qt::PreciseTimer);
+    connect(timer_, SIGNAL(timeout()), this, SLOT(replayTimeoutSlot()));
+    speed_ = 1;
+    next_ = 0;
+    start_us_ = 0;
+    base_us_ = 0;
+}
+
+bool CaptureReplayer::open(const QString &path)
+{
+    stop();
+    next_ = 0;
+    return file_.openRead(path);
+}
+
+void CaptureReplayer::setDevice(QIODevice *device)
+{
+    writer_->setDevice(device);
+}
+
+void CaptureReplayer::setSpeed(double speed)
+{
+    speed_ = speed > 0 ? speed : 0;
+}
+
+FrameWriter *CaptureReplayer::frameWriter() const
+{
+    return writer_;
+}
+
+int CaptureReplayer::count() const
+{
+    return file_.count();
+}
+
+int CaptureReplayer::position() const
+{
+    return next_;
+}
+
+void CaptureReplayer::start()
+{
+    next_ = 0;
+    if (file_.count() == 0)
+    {
+        emit finished();
+        return;
+    }
+    base_us_ = file_.record(0).time_us;
+    start_us_ = FrameClock::usecs();
+    replayTimeoutSlot();
+}
+
+void CaptureReplayer::stop()
+{
+    timer_->stop();
+    writer_->flush();
+}
+
+bool CaptureReplayer::isRunning() const
+{
+    return timer_->isActive();
+}
+
+void CaptureReplayer::replayTimeoutSlot()
+{
+    qint64 elapsed = (qint64)((FrameClock::usecs() - start_us_) * speed_);
+    while (next_ < file_.count())
+    {
+        const CaptureRecord &rec = file_.record(next_);
+        if (speed_ > 0 && rec.time_us - base_us_ > elapsed)
+        {
+            break;
+        }
+        if (speed_ == 0 && writer_->isCongested())
+        {
+            break;
+        }
+        writer_->append(rec.frame, SerialData::Size);
+        emit frameSentSignal(QByteArray::fromRawData(rec.frame, SerialData::Size));
+        next_++;
+    }
+    writer_->flush();
+    if (next_ >= file_.count())
+    {
+        emit finished();
+        return;
+    }
+    int wait_ms = 1;
+    if (speed_ > 0)
+    {
+        qint64 due = file_.record(next_).time_us - base_us_ - elapsed;
+        wait_ms = qMax(1, (int)(due / speed_ / 1000));
+    }
+    timer_->start(wait_ms);
+}
@@ -0,0 +1,50 @@
+#ifndef CAPTUREREPLAYER_H
+#define CAPTUREREPLAYER_H
+
+#include <QObject>
+#include <QByteArray>
+#include "capturefile.h"
+
+class QIODevice;
+class QTimer;
+class FrameWriter;
+
+/* Streams a capture back to a device keeping the recorded spacing.
+ * speed 1 replays in real time, N replays N times faster and 0 sends as
+ * fast as the frame writer lets it.
+*/
+class CaptureReplayer : public QObject
+{
+    Q_OBJECT
+public:
+    explicit CaptureReplayer(QObject *parent = 0);
+
+    bool open(const QString &path);
+    void setDevice(QIODevice *device);
+    void setSpeed(double speed);
+    FrameWriter *frameWriter() const;
+    int count() const;
+    int position() const;
+
+    void start();
+    void stop();
+    bool isRunning() const;
+
+signals:
+    void frameSentSignal(const QByteArray &frame);
+    void finished();
+
+private slots:
+    void replayTimeoutSlot();
+
+private:
+    CaptureFile file_;
+    FrameWriter *writer_;
+    QTimer *timer_;
+    double speed_;
+    int next_;
+    qint64 start_us_;   // FrameClock at start()
+    qint64 base_us_;    // capture time of the first record
+};
+
+#endif // CAPTUREREPLAYER_H
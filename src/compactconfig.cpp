@@ -0,0 +1,227 @@
+#include "compactconfig.h"
+#include "configdownload.h"
+#include "tscimage.h"
+
+#include <QSaveFile>
+#include <stddef.h>
+#include <string.h>
+
+struct CompactHeader
+{
+    char magic[6];
+    quint16 version;
+    quint32 image_size;
+    quint32 image_crc;
+    quint32 table_count;
+    quint32 reserved;
+};
+
+struct CompactEntry
+{
+    quint32 offset;
+    quint32 size;
+    quint32 crc;        // of the legacy table bytes
+    quint16 rows;       // stored rows
+    quint16 reserved;
+};
+
+Q_STATIC_ASSERT(sizeof(CompactHeader) == COMPACT_HEADER_SIZE);
+Q_STATIC_ASSERT(sizeof(CompactEntry) == COMPACT_ENTRY_SIZE);
+
+// row array of every table: bytes ahead of it, row size, row count
+struct TableRows
+{
+    int prefix;
+    int row_size;
+    int row_count;
+};
+
+static const TableRows table_rows_list[TscImage::TableCount] =
+{
+    { sizeof(TSCHeader_t), 0, 0 },
+    { sizeof(Unit_t), 0, 0 },
+    { offsetof(Schedule_t, ScheduleList), sizeof(ScheduleList_t), MAX_SCHEDULE_LINE },
+    { offsetof(TimeSection_t, TimeSectionList), sizeof(TimeSectionList_t), MAX_TIMESECTION_LINE * MAX_EVENT_LINE },
+    { offsetof(Pattern_t, PatternList), sizeof(PatternList_t), MAX_PATTERN_LINE },
+    { offsetof(TimeConfig_t, TimeConfigList), sizeof(TimeConfigList_t), MAX_TIMECONFIG_LINE * MAX_STAGE_LINE },
+    { offsetof(Phase_t, PhaseList), sizeof(PhaseList_t), MAX_PHASE_LINE },
+    { offsetof(PhaseError_t, PhaseErrorList), sizeof(PhaseErrorList_t), MAX_PHASE_LINE },
+    { offsetof(Channel_t, ChannelList), sizeof(ChannelList_t), MAX_CHANNEL_LINE },
+    { offsetof(ChannelHint_t, ChannelHintList), sizeof(ChannelHintList_t), MAX_CHANNEL },
+    { offsetof(Detector_t, DetectorList), sizeof(DetectorList_t), MAX_DETECTOR_LINE }
+};
+
+static quint32 checksum(const char *data, int len)
+{
+    return ~ConfigDownload::crc32(0xffffffff, data, len);
+}
+
+static int tailSize(int table)
+{
+    const TableRows &rows = table_rows_list[table];
+    return TscImage::tableSize((TscImage::Table)table) - rows.prefix - rows.row_size * rows.row_count;
+}
+
+static bool isZero(const char *data, int len)
+{
+    for (int i = 0; i < len; i++)
+    {
+        if (data[i] != 0)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool fail(QString *error, const QString &message)
+{
+    if (error != NULL)
+    {
+        *error = message;
+    }
+    return false;
+}
+
+QByteArray CompactConfig::encode(const char *image, int size)
+{
+    if (image == NULL || size != TscImage::imageSize())
+    {
+        return QByteArray();
+    }
+    int dir_size = COMPACT_HEADER_SIZE + TscImage::TableCount * COMPACT_ENTRY_SIZE;
+    QByteArray out(dir_size, '\0');
+    for (int t = 0; t < TscImage::TableCount; t++)
+    {
+        const TableRows &rows = table_rows_list[t];
+        const char *table = image + TscImage::tableOffset((TscImage::Table)t);
+        int table_size = TscImage::tableSize((TscImage::Table)t);
+        int tail = tailSize(t);
+
+        CompactEntry entry;
+        memset(&entry, 0, sizeof(entry));
+        entry.offset = out.size();
+        entry.crc = checksum(table, table_size);
+        out.append(table, rows.prefix);
+        out.append(table + table_size - tail, tail);
+        for (quint16 i = 0; i < rows.row_count; i++)
+        {
+            const char *row = table + rows.prefix + i * rows.row_size;
+            if (isZero(row, rows.row_size))
+            {
+                continue;
+            }
+            out.append((const char *)&i, sizeof(i));
+            out.append(row, rows.row_size);
+            entry.rows++;
+        }
+        entry.size = out.size() - entry.offset;
+        memcpy(out.data() + COMPACT_HEADER_SIZE + t * COMPACT_ENTRY_SIZE, &entry, sizeof(entry));
+    }
+
+    CompactHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, COMPACT_MAGIC, sizeof(header.magic));
+    header.version = COMPACT_VERSION;
+    header.image_size = size;
+    header.image_crc = checksum(image, size);
+    header.table_count = TscImage::TableCount;
+    memcpy(out.data(), &header, sizeof(header));
+    return out;
+}
+
+QByteArray CompactConfig::encode(const QByteArray &image)
+{
+    return encode(image.constData(), image.size());
+}
+
+bool CompactConfig::decode(const char *data, int size, QByteArray &image, QString *error)
+{
+    if (!isCompact(data, size))
+    {
+        return fail(error, "not a compact config");
+    }
+    CompactHeader header;
+    memcpy(&header, data, sizeof(header));
+    if (header.version > COMPACT_VERSION)
+    {
+        return fail(error, QString("compact config version %1 not supported").arg(header.version));
+    }
+    if (header.image_size != (quint32)TscImage::imageSize() || header.table_count != TscImage::TableCount)
+    {
+        return fail(error, QString("compact config of %1 tables and %2 bytes, %3 and %4 expected")
+                    .arg(header.table_count).arg(header.image_size)
+                    .arg((int)TscImage::TableCount).arg(TscImage::imageSize()));
+    }
+    int dir_size = COMPACT_HEADER_SIZE + TscImage::TableCount * COMPACT_ENTRY_SIZE;
+    if (size < dir_size)
+    {
+        return fail(error, "compact config truncated");
+    }
+
+    image = QByteArray(header.image_size, '\0');
+    for (int t = 0; t < TscImage::TableCount; t++)
+    {
+        const TableRows &rows = table_rows_list[t];
+        char *table = image.data() + TscImage::tableOffset((TscImage::Table)t);
+        int table_size = TscImage::tableSize((TscImage::Table)t);
+        int tail = tailSize(t);
+
+        CompactEntry entry;
+        memcpy(&entry, data + COMPACT_HEADER_SIZE + t * COMPACT_ENTRY_SIZE, sizeof(entry));
+        qint64 expected = rows.prefix + tail + (qint64)entry.rows * (sizeof(quint16) + rows.row_size);
+        if (entry.offset < (quint32)dir_size || (qint64)entry.offset + entry.size > size
+                || entry.size != expected || entry.rows > rows.row_count)
+        {
+            return fail(error, QString("compact config table %1 corrupt").arg(t));
+        }
+        const char *section = data + entry.offset;
+        memcpy(table, section, rows.prefix);
+        memcpy(table + table_size - tail, section + rows.prefix, tail);
+        const char *row = section + rows.prefix + tail;
+        for (int i = 0; i < entry.rows; i++)
+        {
+            quint16 index = 0;
+            memcpy(&index, row, sizeof(index));
+            if (index >= rows.row_count)
+            {
+                return fail(error, QString("compact config table %1 corrupt").arg(t));
+            }
+            memcpy(table + rows.prefix + index * rows.row_size, row + sizeof(index), rows.row_size);
+            row += sizeof(index) + rows.row_size;
+        }
+        if (checksum(table, table_size) != entry.crc)
+        {
+            return fail(error, QString("compact config table %1 checksum mismatch").arg(t));
+        }
+    }
+    if (checksum(image.constData(), image.size()) != header.image_crc)
+    {
+        return fail(error, "compact config checksum mismatch");
+    }
+    return true;
+}
+
+bool CompactConfig::isCompact(const char *data, int size)
+{
+    return data != NULL && size >= COMPACT_HEADER_SIZE
+            && memcmp(data, COMPACT_MAGIC, sizeof(((CompactHeader *)0)->magic)) == 0;
+}
+
+// writes a temporary file and renames it over path
+bool CompactConfig::save(const QString &path, const QByteArray &image, QString *error)
+{
+    QByteArray compact = encode(image);
+    if (compact.isEmpty())
+    {
+        return fail(error, QString("image of %1 bytes, %2 expected").arg(image.size()).arg(TscImage::imageSize()));
+    }
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly)
+            || file.write(compact) != compact.size()
+            || !file.commit())
+    {
+        return fail(error, file.errorString());
+    }
+    return true;
+}
@@ -0,0 +1,37 @@
+#ifndef COMPACTCONFIG_H
+#define COMPACTCONFIG_H
+
+#include <QByteArray>
+#include <QString>
+
+#define COMPACT_MAGIC           "SIMCFG"
+#define COMPACT_VERSION         1
+#define COMPACT_HEADER_SIZE     24
+#define COMPACT_ENTRY_SIZE      16
+
+/* Compact on-disk form of a controller config image (.dat).
+ * Most rows of the legacy tables are never used and stay zero, the compact
+ * form stores only the rows holding a non-zero byte, so it round-trips the
+ * legacy image byte for byte, padding and stale rows included.
+ *
+ * Header: magic[6], version (quint16), legacy image size, CRC-32 of the
+ * legacy image, table count, reserved (quint32 each). Then one directory
+ * entry per TscImage table: offset and size of its section in the file,
+ * CRC-32 of the legacy table bytes, stored row count (quint16) and a
+ * reserved quint16. A section is the bytes ahead of the row array (the
+ * Fact counts), the bytes behind it, then index (quint16) and bytes of every
+ * stored row. Native byte order, no padding.
+*/
+class CompactConfig
+{
+public:
+    // image must be a whole legacy image, returns an empty array otherwise
+    static QByteArray encode(const char *image, int size);
+    static QByteArray encode(const QByteArray &image);
+    static bool decode(const char *data, int size, QByteArray &image, QString *error = NULL);
+
+    static bool isCompact(const char *data, int size);
+    static bool save(const QString &path, const QByteArray &image, QString *error = NULL);
+};
+
+#endif // COMPACTCONFIG_H
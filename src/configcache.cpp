@@ -0,0 +1,215 @@
+#include "configcache.h"
+#include "compactconfig.h"
+
+#include <QDir>
+#include <QFile>
+#include <QSaveFile>
+#include <QDateTime>
+#include <QStringList>
+#include <QCryptographicHash>
+
+static qint64 currentSecs()
+{
+    return QDateTime::currentMSecsSinceEpoch() / 1000;
+}
+
+ConfigCache::ConfigCache()
+{
+}
+
+// reads the index, a missing one is an empty cache
+bool ConfigCache::open(const QString &dir)
+{
+    entry_map_.clear();
+    dir_ = dir;
+    if (!dir_.endsWith('/'))
+    {
+        dir_ += '/';
+    }
+    if (!QDir().mkpath(dir_))
+    {
+        return false;
+    }
+    QFile file(dir_ + CONFIG_CACHE_INDEX);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text))
+    {
+        return true;
+    }
+    while (!file.atEnd())
+    {
+        QStringList fields = QString::fromLatin1(file.readLine()).trimmed().split(' ');
+        if (fields.size() != 3 || !QFile::exists(objectPath(fields.at(1))))
+        {
+            continue;
+        }
+        Entry entry;
+        entry.hash = fields.at(1);
+        entry.validated = fields.at(2).toLongLong();
+        entry_map_.insert(fields.at(0), entry);
+    }
+    return true;
+}
+
+QString ConfigCache::dir() const
+{
+    return dir_;
+}
+
+bool ConfigCache::contains(const QString &controller) const
+{
+    return entry_map_.contains(controller);
+}
+
+QString ConfigCache::hash(const QString &controller) const
+{
+    return entry_map_.value(controller).hash;
+}
+
+QString ConfigCache::path(const QString &controller) const
+{
+    if (!entry_map_.contains(controller))
+    {
+        return QString();
+    }
+    return objectPath(entry_map_.value(controller).hash);
+}
+
+bool ConfigCache::isFresh(const QString &controller, int max_age) const
+{
+    if (max_age <= 0 || !entry_map_.contains(controller))
+    {
+        return false;
+    }
+    qint64 age = currentSecs() - entry_map_.value(controller).validated;
+    return age >= 0 && age < max_age;
+}
+
+bool ConfigCache::lookup(const QString &controller, QByteArray &image) const
+{
+    if (!entry_map_.contains(controller))
+    {
+        return false;
+    }
+    QFile file(path(controller));
+    if (!file.open(QIODevice::ReadOnly))
+    {
+        return false;
+    }
+    QByteArray data = file.readAll();
+    if (!CompactConfig::isCompact(data.constData(), data.size()))
+    {
+        image = data;
+        return true;
+    }
+    return CompactConfig::decode(data.constData(), data.size(), image);
+}
+
+// an unchanged config only renews the validation time
+bool ConfigCache::store(const QString &controller, const QByteArray &image, bool *changed, QString *error)
+{
+    QString hash = contentHash(image);
+    QString old_hash = entry_map_.value(controller).hash;
+    if (changed != NULL)
+    {
+        *changed = (hash != old_hash);
+    }
+    QString object_path = objectPath(hash);
+    if (!QFile::exists(object_path))
+    {
+        // images of another layout are kept as they are
+        QByteArray data = CompactConfig::encode(image);
+        if (data.isEmpty())
+        {
+            data = image;
+        }
+        QSaveFile file(object_path);
+        if (!file.open(QIODevice::WriteOnly)
+                || file.write(data) != data.size()
+                || !file.commit())
+        {
+            if (error != NULL)
+            {
+                *error = file.errorString();
+            }
+            return false;
+        }
+    }
+    Entry entry;
+    entry.hash = hash;
+    entry.validated = currentSecs();
+    entry_map_.insert(controller, entry);
+    if (!old_hash.isEmpty() && old_hash != hash && !isReferenced(old_hash))
+    {
+        QFile::remove(objectPath(old_hash));
+    }
+    return saveIndex(error);
+}
+
+void ConfigCache::remove(const QString &controller)
+{
+    if (!entry_map_.contains(controller))
+    {
+        return;
+    }
+    QString hash = entry_map_.take(controller).hash;
+    if (!isReferenced(hash))
+    {
+        QFile::remove(objectPath(hash));
+    }
+    saveIndex();
+}
+
+QString ConfigCache::controllerKey(const QString &ip, unsigned int port)
+{
+    return ip + ":" + QString::number(port);
+}
+
+QString ConfigCache::contentHash(const QByteArray &image)
+{
+    return QString::fromLatin1(QCryptographicHash::hash(image, QCryptographicHash::Sha1).toHex());
+}
+
+QString ConfigCache::objectPath(const QString &hash) const
+{
+    return dir_ + hash + ".cfg";
+}
+
+bool ConfigCache::isReferenced(const QString &hash) const
+{
+    QHash<QString, Entry>::const_iterator it = entry_map_.constBegin();
+    for (; it != entry_map_.constEnd(); ++it)
+    {
+        if (it.value().hash == hash)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool ConfigCache::saveIndex(QString *error)
+{
+    QByteArray data;
+    QHash<QString, Entry>::const_iterator it = entry_map_.constBegin();
+    for (; it != entry_map_.constEnd(); ++it)
+    {
+        data.append(it.key().toLatin1());
+        data.append(' ');
+        data.append(it.value().hash.toLatin1());
+        data.append(' ');
+        data.append(QByteArray::number(it.value().validated));
+        data.append('\n');
+    }
+    QSaveFile file(dir_ + CONFIG_CACHE_INDEX);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Text)
+            || file.write(data) != data.size()
+            || !file.commit())
+    {
+        if (error != NULL)
+        {
+            *error = file.errorString();
+        }
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,64 @@
+#ifndef CONFIGCACHE_H
+#define CONFIGCACHE_H
+
+#include <QString>
+#include <QByteArray>
+#include <QHash>
+
+#define CONFIG_CACHE_INDEX      "index.txt"
+#define CONFIG_CACHE_MAX_AGE    0       // s a cached config is trusted without a download, 0: never
+
+/* Local copies of the controller configs, one file per distinct content.
+ * Files are named by the SHA-1 of the legacy image and written once, in the
+ * compact form, controllers with the same config share one. The index maps
+ * every controller (ip:port) to the hash of its config and the time a
+ * download last confirmed it.
+ *
+ * The protocol has no way to ask a signaler for a hash, so by default a
+ * cached config is only a fast start: it is loaded at once and the download
+ * still runs, its content is hashed and only a changed config is written and
+ * loaded again. With a max age set, an entry confirmed by a download or a
+ * pushed config less than max age ago isFresh() and the download is skipped;
+ * configs pushed while monitoring revalidate it.
+*/
+class ConfigCache
+{
+public:
+    ConfigCache();
+
+    bool open(const QString &dir);
+    QString dir() const;
+
+    bool contains(const QString &controller) const;
+    QString hash(const QString &controller) const;
+    // file of the cached config, TscImage opens it as it is
+    QString path(const QString &controller) const;
+    // confirmed less than max_age s ago, never when max_age <= 0
+    bool isFresh(const QString &controller, int max_age = CONFIG_CACHE_MAX_AGE) const;
+    // legacy image of the cached config
+    bool lookup(const QString &controller, QByteArray &image) const;
+
+    // changed is set when image differs from the cached config
+    bool store(const QString &controller, const QByteArray &image, bool *changed = NULL, QString *error = NULL);
+    void remove(const QString &controller);
+
+    static QString controllerKey(const QString &ip, unsigned int port);
+    static QString contentHash(const QByteArray &image);
+
+private:
+    QString objectPath(const QString &hash) const;
+    bool isReferenced(const QString &hash) const;
+    bool saveIndex(QString *error = NULL);
+
+private:
+    typedef struct EntryTag
+    {
+        QString hash;
+        qint64 validated;   // s since epoch
+    }Entry;
+
+    QString dir_;
+    QHash<QString, Entry> entry_map_;   // controller -> config
+};
+
+#endif // CONFIGCACHE_H
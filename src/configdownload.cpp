@@ -0,0 +1,193 @@
+#include "configdownload.h"
+#include "cytparser.h"
+#include "cytdecoder.h"
+
+#include <string.h>
+
+static quint32 crc_table[256];
+
+static void initCrcTable()
+{
+    for (quint32 i = 0; i < 256; i++)
+    {
+        quint32 c = i;
+        for (int k = 0; k < 8; k++)
+        {
+            c = (c & 1) ? (0xedb88320 ^ (c >> 1)) : (c >> 1);
+        }
+        crc_table[i] = c;
+    }
+}
+
+ConfigDownload::ConfigDownload()
+{
+    reset();
+}
+
+ConfigDownload::State ConfigDownload::feed(const char *data, int len)
+{
+    if (state_ != Receiving)
+    {
+        begin();
+    }
+    int pos = 0;
+    while (pos < len && prefix_len_ < PrefixSize)
+    {
+        prefix_[prefix_len_++] = data[pos++];
+        if (prefix_len_ == CytParser::HeadSize && memcmp(prefix_, "CYT4", CytParser::HeadSize) != 0)
+        {
+            state_ = Failed;
+            return state_;
+        }
+    }
+    if (prefix_len_ < PrefixSize)
+    {
+        return state_;
+    }
+    if (total_ < 0)
+    {
+        quint32 msg_len = 0;
+        memcpy(&msg_len, prefix_ + CytParser::HeadSize, CytDecoder::ConfigLengthSize);
+        int total = (int)msg_len - PrefixSize - CytParser::TailSize;
+        if (msg_len > CYT_MAX_MESSAGE_SIZE || total < 0)
+        {
+            state_ = Failed;
+            return state_;
+        }
+        if (kept_ > total)
+        {
+            kept_ = 0;
+            content_.clear();
+        }
+        total_ = total;
+        content_.reserve(total_);
+    }
+
+    int n = qMin(len - pos, total_ - received_);
+    if (n > 0)
+    {
+        const char *piece = data + pos;
+        crc_ = crc32(crc_, piece, n);
+        // the resent start of an interrupted transfer only has to match what is kept
+        int same = 0;
+        if (received_ < kept_)
+        {
+            int cmp = qMin(n, kept_ - received_);
+            while (same < cmp && content_.at(received_ + same) == piece[same])
+            {
+                same++;
+            }
+            if (same < cmp)
+            {
+                content_.truncate(received_ + same);    // the config changed meanwhile
+                kept_ = 0;
+            }
+        }
+        if (same < n)
+        {
+            content_.append(piece + same, n - same);
+        }
+        received_ += n;
+        pos += n;
+    }
+
+    while (pos < len && tail_len_ < 3)
+    {
+        tail_[tail_len_++] = data[pos++];
+    }
+    if (tail_len_ == 3)
+    {
+        state_ = (memcmp(tail_, "END", 3) == 0 && pos == len) ? Complete : Failed;
+        // the kept part was only compared, check the assembled image
+        if (state_ == Complete && resumed_
+                && ~crc32(0xffffffff, content_.constData(), content_.size()) != checksum())
+        {
+            state_ = Failed;
+        }
+        kept_ = 0;
+    }
+    return state_;
+}
+
+ConfigDownload::State ConfigDownload::feed(const QByteArray &data)
+{
+    return feed(data.constData(), data.size());
+}
+
+// the link went down, keep the content for the next transfer
+void ConfigDownload::interrupt()
+{
+    if (state_ == Receiving)
+    {
+        state_ = Interrupted;
+    }
+}
+
+void ConfigDownload::reset()
+{
+    state_ = Idle;
+    prefix_len_ = 0;
+    total_ = -1;
+    received_ = 0;
+    kept_ = 0;
+    resumed_ = false;
+    crc_ = 0xffffffff;
+    tail_len_ = 0;
+    content_.clear();
+}
+
+ConfigDownload::State ConfigDownload::state() const
+{
+    return state_;
+}
+
+int ConfigDownload::received() const
+{
+    return received_;
+}
+
+int ConfigDownload::total() const
+{
+    return total_;
+}
+
+quint32 ConfigDownload::checksum() const
+{
+    return ~crc_;
+}
+
+const QByteArray &ConfigDownload::content() const
+{
+    return content_;
+}
+
+// crc is the running value, start with 0xffffffff and invert the result
+quint32 ConfigDownload::crc32(quint32 crc, const char *data, int len)
+{
+    if (crc_table[1] == 0)
+    {
+        initCrcTable();
+    }
+    for (int i = 0; i < len; i++)
+    {
+        crc = crc_table[(crc ^ (unsigned char)data[i]) & 0xff] ^ (crc >> 8);
+    }
+    return crc;
+}
+
+void ConfigDownload::begin()
+{
+    int kept = (state_ == Interrupted) ? content_.size() : 0;
+    if (kept == 0)
+    {
+        content_.clear();
+    }
+    state_ = Receiving;
+    prefix_len_ = 0;
+    total_ = -1;
+    received_ = 0;
+    kept_ = kept;
+    resumed_ = (kept > 0);
+    crc_ = 0xffffffff;
+    tail_len_ = 0;
+}
@@ -0,0 +1,68 @@
+#ifndef CONFIGDOWNLOAD_H
+#define CONFIGDOWNLOAD_H
+
+#include <QByteArray>
+
+/* Receiver of the CYT4 config reply.
+ * The reply is fed in the pieces a streamed CytParser hands out: the head
+ * and its 4 byte length field, the file content, the END tail. Progress and
+ * the CRC-32 of the bytes on the link are kept up to date with every piece,
+ * nothing is searched or copied twice.
+ *
+ * GetConfigure has no offset, after a lost link the signaler sends the file
+ * from the start again. interrupt() keeps the part already received, the
+ * resent bytes are compared with it instead of being stored again and only
+ * a config that changed in between is downloaded anew. The content of such
+ * a resumed transfer must match the CRC-32 of what was received, or the
+ * download fails.
+*/
+class ConfigDownload
+{
+public:
+    ConfigDownload();
+
+    enum State
+    {
+        Idle = 0,
+        Receiving,
+        Interrupted,    // link lost while receiving, the partial content is kept
+        Complete,
+        Failed          // wrong head, length or tail
+    };
+
+    State feed(const char *data, int len);
+    State feed(const QByteArray &data);
+    void interrupt();
+    void reset();
+
+    State state() const;
+    int received() const;       // content bytes of the current transfer
+    int total() const;          // content size, -1 until the length field is in
+    quint32 checksum() const;   // CRC-32 of the content received so far
+    const QByteArray &content() const;
+
+    static quint32 crc32(quint32 crc, const char *data, int len);
+
+private:
+    enum
+    {
+        PrefixSize = 8      // "CYT4" + length field
+    };
+
+    void begin();
+
+private:
+    State state_;
+    char prefix_[PrefixSize];
+    int prefix_len_;
+    int total_;
+    int received_;
+    int kept_;          // content bytes kept from an interrupted transfer
+    bool resumed_;      // content started from a kept part
+    quint32 crc_;       // running, not inverted
+    char tail_[3];
+    int tail_len_;
+    QByteArray content_;
+};
+
+#endif // CONFIGDOWNLOAD_H
@@ -0,0 +1,296 @@
+#include <QCoreApplication>
+#include <QStringList>
+#include <QTimer>
+#include <QList>
+#include <QDebug>
+
+#include "simulatorcore.h"
+#include "mdatabase.h"
+#include "filereaderwriter.h"
+#include "qextserialport.h"
+#include "framesink.h"
+#include "arrivalgenerator.h"
+#include "capturereplayer.h"
+#ifdef _TTY_POSIX_
+#include "posix_qextptyport.h"
+#endif
+
+#include <stdio.h>
+
+/* Headless simulator.
+ * usage: SimulatorConsole [-i secs] [-m ctrl_mode] [-p phase_id] [-t run_secs]
+ *                        [-f flow_vph] [-g poisson|platoon|constant] [-s seed]
+ *                        [-c capture] config.dat[,port|,pty] ...
+ *        SimulatorConsole -r capture [-x speed] [-t run_secs] port|pty ...
+ * Every config.dat[,port] argument is one intersection; without a port the
+ * frames are generated but not written anywhere. The port name "pty" selects
+ * a pseudo-terminal loopback (posix only), its far end is decoded by a
+ * FrameSink whose throughput, latency and loss are printed on exit.
+ * -f gives every lane a generated flow in vehicles/hour instead of one random
+ * car per interval; the run is then reproducible for a given -s seed.
+ * -c records the frames of every intersection to capture, capture.1 ...
+ * -r replays a capture to every port, -x 0 as fast as the line allows.
+*/
+
+#define LOOPBACK_PORT_NAME      "pty"
+
+#define DEFAULT_INTERVAL_SECS   3
+#define ARRIVAL_TICK_MS         10
+
+static void usage()
+{
+    fprintf(stderr, "usage: SimulatorConsole [-i secs] [-m ctrl_mode] [-p phase_id] [-t run_secs]"
+                    " [-f flow_vph] [-g poisson|platoon|constant] [-s seed] [-c capture] config.dat[,port|,pty] ...\n"
+                    "       SimulatorConsole -r capture [-x speed] [-t run_secs] port|pty ...\n");
+}
+
+// opens a serial port or a loopback pair, sink is set for the loopback only
+static QextSerialBase *openPort(const QString &name, FrameSink **sink, QObject *parent)
+{
+    struct PortSettings setting = {BAUD9600, DATA_8, PAR_NONE, STOP_1, FLOW_OFF, 500};
+    QextSerialBase *port = NULL;
+    *sink = NULL;
+#ifdef _TTY_POSIX_
+    if (name == LOOPBACK_PORT_NAME)
+    {
+        Posix_QextPtyPort *pty_port = new Posix_QextPtyPort;
+        *sink = new FrameSink(parent);
+        QObject::connect(pty_port, SIGNAL(masterDataReceived(QByteArray)), *sink, SLOT(feed(QByteArray)));
+        port = pty_port;
+    }
+#else
+    Q_UNUSED(parent);
+#endif
+    if (port == NULL)
+    {
+        port = new QextSerialPort(name, setting, QextSerialBase::EventDriven);
+    }
+    if (!port->open(QIODevice::ReadWrite))
+    {
+        fprintf(stderr, "open serial port %s failed\n", qPrintable(name));
+        delete port;
+        delete *sink;
+        *sink = NULL;
+        return NULL;
+    }
+    if (*sink != NULL)
+    {
+        fprintf(stdout, "loopback on %s\n", qPrintable(port->portName()));
+    }
+    return port;
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QStringList args = app.arguments();
+    args.removeFirst();
+
+    int interval = DEFAULT_INTERVAL_SECS;
+    int run_secs = 0;
+    unsigned char ctrl_mode = SimulatorCore::FullInduction;
+    unsigned int phase_id = 1;
+    double flow_vph = 0;
+    ArrivalGenerator::Model model = ArrivalGenerator::Poisson;
+    quint64 seed = 1;
+    QString capture_path;
+    QString replay_path;
+    double speed = 1;
+    bool ok = true;
+    QStringList targets;
+    for (int i = 0; i < args.size(); i++)
+    {
+        const QString &arg = args.at(i);
+        if (arg.startsWith("-") && i + 1 >= args.size())
+        {
+            usage();
+            return 1;
+        }
+        if (arg == "-i")
+        {
+            interval = args.at(++i).toInt();
+        }
+        else if (arg == "-m")
+        {
+            ctrl_mode = args.at(++i).toUInt();
+        }
+        else if (arg == "-p")
+        {
+            phase_id = args.at(++i).toUInt();
+        }
+        else if (arg == "-t")
+        {
+            run_secs = args.at(++i).toInt();
+        }
+        else if (arg == "-f")
+        {
+            flow_vph = args.at(++i).toDouble();
+        }
+        else if (arg == "-g")
+        {
+            model = ArrivalGenerator::modelOfName(args.at(++i), &ok);
+        }
+        else if (arg == "-s")
+        {
+            seed = args.at(++i).toULongLong();
+        }
+        else if (arg == "-c")
+        {
+            capture_path = args.at(++i);
+        }
+        else if (arg == "-r")
+        {
+            replay_path = args.at(++i);
+        }
+        else if (arg == "-x")
+        {
+            speed = args.at(++i).toDouble();
+        }
+        else
+        {
+            targets.append(arg);
+        }
+    }
+    if (!ok || targets.isEmpty() || interval <= 0 || phase_id == 0 || phase_id > 32)
+    {
+        usage();
+        return 1;
+    }
+
+    QList<int> lane_detector_id_list;
+    for (int i = 0; i < LANE_COUNT; i++)
+    {
+        lane_detector_id_list.append(i + 1);
+    }
+
+    QList<MDatabase *> db_list;
+    QList<SimulatorCore *> core_list;
+    QList<CaptureReplayer *> replayer_list;
+    QList<QextSerialBase *> port_list;
+    QList<FrameSink *> sink_list;
+    for (int i = 0; i < targets.size(); i++)
+    {
+        FrameSink *sink = NULL;
+        if (!replay_path.isEmpty())
+        {
+            CaptureReplayer *replayer = new CaptureReplayer(&app);
+            if (!replayer->open(replay_path))
+            {
+                fprintf(stderr, "open capture %s failed\n", qPrintable(replay_path));
+                return 1;
+            }
+            QextSerialBase *port = openPort(targets.at(i), &sink, &app);
+            if (port == NULL)
+            {
+                delete replayer;
+                continue;
+            }
+            replayer->setDevice(port);
+            replayer->setSpeed(speed);
+            port_list.append(port);
+            replayer_list.append(replayer);
+            if (sink != NULL)
+            {
+                QObject::connect(replayer, SIGNAL(frameSentSignal(QByteArray)), sink, SLOT(frameSentSlot(QByteArray)));
+                sink_list.append(sink);
+            }
+            continue;
+        }
+
+        QStringList fields = targets.at(i).split(",");
+        MDatabase *db = new MDatabase;
+        FileReaderWriter reader;
+        if (!reader.ReadFile(db, fields.at(0).toStdString().c_str()))
+        {
+            fprintf(stderr, "open config %s failed\n", qPrintable(fields.at(0)));
+            delete db;
+            continue;
+        }
+        SimulatorCore *core = new SimulatorCore(&app);
+        core->initDatabase(db);
+        core->setLaneDetectorIdList(lane_detector_id_list);
+        core->setCtrlMode(ctrl_mode);
+        core->setPhaseIds(0x01 << (phase_id - 1));
+        core->arrivalGenerator()->setSeed(seed + i);
+        core->arrivalGenerator()->setAllLaneFlow(model, flow_vph);
+        if (fields.size() > 1)
+        {
+            QextSerialBase *port = openPort(fields.at(1), &sink, &app);
+            if (port == NULL)
+            {
+                delete core;
+                delete db;
+                continue;
+            }
+            core->setDevice(port);
+            port_list.append(port);
+            if (sink != NULL)
+            {
+                QObject::connect(core, SIGNAL(frameSentSignal(QByteArray)), sink, SLOT(frameSentSlot(QByteArray)));
+                sink_list.append(sink);
+            }
+        }
+        if (!capture_path.isEmpty())
+        {
+            QString path = (i == 0) ? capture_path : capture_path + "." + QString::number(i);
+            if (!core->startCapture(path))
+            {
+                fprintf(stderr, "create capture %s failed\n", qPrintable(path));
+            }
+        }
+        db_list.append(db);
+        core_list.append(core);
+    }
+    if (core_list.isEmpty() && replayer_list.isEmpty())
+    {
+        return 1;
+    }
+
+    for (int i = 0; i < core_list.size(); i++)
+    {
+        core_list.at(i)->start(flow_vph > 0 ? ARRIVAL_TICK_MS : interval * 1000);
+    }
+    for (int i = 0; i < replayer_list.size(); i++)
+    {
+        // all replay the same capture, the first one done ends the run
+        QObject::connect(replayer_list.at(i), SIGNAL(finished()), &app, SLOT(quit()));
+        replayer_list.at(i)->start();
+    }
+    if (run_secs > 0)
+    {
+        QTimer::singleShot(run_secs * 1000, &app, SLOT(quit()));
+    }
+    int ret = app.exec();
+
+    for (int i = 0; i < core_list.size(); i++)
+    {
+        core_list.at(i)->stop();
+        core_list.at(i)->stopCapture();
+    }
+    for (int i = 0; i < replayer_list.size(); i++)
+    {
+        replayer_list.at(i)->stop();
+    }
+    // let the last flushed frames reach the sinks
+    if (!sink_list.isEmpty())
+    {
+        QTimer::singleShot(100, &app, SLOT(quit()));
+        app.exec();
+    }
+    for (int i = 0; i < core_list.size(); i++)
+    {
+        fprintf(stdout, "%s\n", qPrintable(core_list.at(i)->pacingSummary()));
+    }
+    for (int i = 0; i < replayer_list.size(); i++)
+    {
+        fprintf(stdout, "replayed %d of %d frames\n", replayer_list.at(i)->position(), replayer_list.at(i)->count());
+    }
+    for (int i = 0; i < sink_list.size(); i++)
+    {
+        fprintf(stdout, "%s\n", qPrintable(sink_list.at(i)->summary()));
+    }
+    qDeleteAll(port_list);
+    qDeleteAll(core_list);
+    qDeleteAll(db_list);
+    return ret;
+}
@@ -0,0 +1,174 @@
+#include "cytdecoder.h"
+
+#include <string.h>
+
+typedef struct ReplyFramingTag
+{
+    char cmd_id;
+    CytParser::Framing framing;
+    int size;
+    CytParser::PayloadSizeFunc func;
+}ReplyFraming;
+
+// replies not listed here are text and run to the first END
+static const ReplyFraming reply_framing_list[] =
+{
+    {CytDecoder::BeginMonitor, CytParser::Fixed, sizeof(BeginMonitorInfo), NULL},
+    {CytDecoder::LightStatus, CytParser::Computed, 0, CytDecoder::lightStatusSize},
+    {CytDecoder::Config, CytParser::LengthPrefixed, 0, NULL},
+    {CytDecoder::CountDown, CytParser::Fixed, sizeof(CountDownInfo), NULL},
+    {CytDecoder::TscTime, CytParser::Fixed, 4, NULL},
+    {CytDecoder::DetectorFlow, CytParser::Fixed, 4, NULL},
+    {CytDecoder::AllLightOn, CytParser::Fixed, 1, NULL}
+};
+
+void CytDecoder::registerFraming(CytParser &parser)
+{
+    for (unsigned int i = 0; i < sizeof(reply_framing_list) / sizeof(reply_framing_list[0]); i++)
+    {
+        const ReplyFraming &rf = reply_framing_list[i];
+        if (rf.func != NULL)
+        {
+            parser.setFraming(rf.cmd_id, rf.func);
+        }
+        else
+        {
+            parser.setFraming(rf.cmd_id, rf.framing, rf.size);
+        }
+    }
+}
+
+bool CytDecoder::decode(const QByteArray &payload, BeginMonitorInfo &info)
+{
+    if ((unsigned int)payload.size() != sizeof(info))
+    {
+        return false;
+    }
+    memcpy(&info, payload.constData(), sizeof(info));
+    return true;
+}
+
+// count char, then per light group a separator and the r/y/g bits, then mode, plan and phase bits
+bool CytDecoder::decode(const QByteArray &payload, LightStatusInfo &info)
+{
+    if (lightStatusSize(payload.constData(), payload.size()) != payload.size())
+    {
+        return false;
+    }
+    const char *data = payload.constData();
+    int array_sz = data[0] - '0';
+    int pos = 1;
+    for (int i = 0; i < array_sz; i++)
+    {
+        pos += 1;
+        info.lights[i].red = data[pos];
+        info.lights[i].yellow = data[pos+1];
+        info.lights[i].green = data[pos+2];
+        pos += 3;
+    }
+    info.work_mode = data[pos];
+    info.plan_id = data[pos+1];
+    memcpy(&info.phase_id, data + pos + 2, 4);
+    return true;
+}
+
+bool CytDecoder::decode(const QByteArray &payload, CountDownInfo &info)
+{
+    if ((unsigned int)payload.size() != sizeof(info))
+    {
+        return false;
+    }
+    memcpy(&info, payload.constData(), sizeof(info));
+    return true;
+}
+
+bool CytDecoder::decodeTscTime(const QByteArray &payload, unsigned int &seconds)
+{
+    if (payload.size() != 4)
+    {
+        return false;
+    }
+    memcpy(&seconds, payload.constData(), 4);
+    return true;
+}
+
+bool CytDecoder::decodeAllLightOn(const QByteArray &payload, unsigned char &color)
+{
+    if (payload.size() != 1)
+    {
+        return false;
+    }
+    color = payload.at(0);
+    return true;
+}
+
+// length of the whole message, then the config file; content shares the data of payload
+bool CytDecoder::decodeConfig(const QByteArray &payload, QByteArray &content)
+{
+    if (payload.size() < ConfigLengthSize)
+    {
+        return false;
+    }
+    unsigned int len = 0;
+    memcpy(&len, payload.constData(), ConfigLengthSize);
+    if (len != (unsigned int)(CytParser::HeadSize + payload.size() + CytParser::TailSize))
+    {
+        return false;
+    }
+    content = QByteArray::fromRawData(payload.constData() + ConfigLengthSize, payload.size() - ConfigLengthSize);
+    return true;
+}
+
+int CytDecoder::lightStatusSize(const char *payload, int len)
+{
+    if (len < 1)
+    {
+        return -1;
+    }
+    int array_sz = payload[0] - '0';
+    if (array_sz < 0 || array_sz > MaxLightGroups)
+    {
+        return -2;
+    }
+    return 1 + array_sz*4 + 1 + 1 + 4;
+}
+
+void CytDecoder::toPlanes(const LightStatusInfo &info, LightPlanes &planes)
+{
+    planes.red = 0;
+    planes.yellow = 0;
+    planes.green = 0;
+    for (int i = 0; i < MaxLightGroups; i++)
+    {
+        planes.red |= (quint32)info.lights[i].red << (i * 8);
+        planes.yellow |= (quint32)info.lights[i].yellow << (i * 8);
+        planes.green |= (quint32)info.lights[i].green << (i * 8);
+    }
+}
+
+// bit n set when channel n+1 shows another color
+quint32 CytDecoder::changedChannels(const LightPlanes &prev, const LightPlanes &curr)
+{
+    quint32 red = prev.red ^ curr.red;
+    quint32 yellow = (prev.yellow & ~prev.red) ^ (curr.yellow & ~curr.red);
+    quint32 green = (prev.green & ~(prev.red | prev.yellow)) ^ (curr.green & ~(curr.red | curr.yellow));
+    return red | yellow | green;
+}
+
+CytDecoder::LampColor CytDecoder::channelColor(const LightPlanes &planes, int channel)
+{
+    quint32 bit = (quint32)1 << (channel - 1);
+    if (planes.red & bit)
+    {
+        return LampRed;
+    }
+    if (planes.yellow & bit)
+    {
+        return LampYellow;
+    }
+    if (planes.green & bit)
+    {
+        return LampGreen;
+    }
+    return LampOff;
+}
@@ -0,0 +1,112 @@
+#ifndef CYTDECODER_H
+#define CYTDECODER_H
+
+#include <QByteArray>
+#include "cytparser.h"
+
+typedef struct BeginMonitorTag
+{
+    unsigned char channel_id;
+    unsigned char status;
+}BeginMonitorInfo;
+
+typedef struct CountDownTag
+{
+    unsigned char ctrl_mode;
+    unsigned char stage_id;
+    unsigned char light_corlor;
+    unsigned char light_time;
+    unsigned int phase_ids;
+}CountDownInfo;
+
+typedef struct RedYellowGreenTag
+{
+    unsigned char red;
+    unsigned char yellow;
+    unsigned char green;
+
+    RedYellowGreenTag() :
+        red(0), yellow(0), green(0)
+    {}
+
+}RYGArray;
+
+typedef struct LightStatusTag
+{
+    RYGArray lights[4];
+    unsigned char work_mode;
+    unsigned char plan_id;
+    unsigned int phase_id;
+}LightStatusInfo;
+
+// channel lights as one word per color, bit n is channel n+1
+typedef struct LightPlaneTag
+{
+    quint32 red;
+    quint32 yellow;
+    quint32 green;
+
+    LightPlaneTag() :
+        red(0), yellow(0), green(0)
+    {}
+}LightPlanes;
+
+/* Payload layouts of the signaler replies.
+ * The reply table gives every command id its framing, registerFraming()
+ * installs it in a parser; the decode functions turn a payload into the
+ * matching struct and fail on a size that does not fit the layout.
+ * A new reply type needs a row in the table and, if it carries data, a
+ * struct and a decode function here.
+*/
+class CytDecoder
+{
+public:
+    enum CommandId
+    {
+        VersionId = '0',
+        BeginMonitor = '1',
+        LightStatus = '3',
+        Config = '4',
+        CountDown = '5',
+        TscTime = '7',
+        NetAddress = '8',
+        DetectorFlow = '9',
+        DetectorFault = 'A',
+        RealTimeFlow = 'B',
+        DriverStatus = 'C',
+        DriverRealtimeStatus = 'D',
+        LightRealTimeStatus = 'E',
+        AllLightOn = 'F'
+    };
+
+    enum
+    {
+        MaxLightGroups = 4,
+        ConfigLengthSize = 4
+    };
+
+    static void registerFraming(CytParser &parser);
+
+    static bool decode(const QByteArray &payload, BeginMonitorInfo &info);
+    static bool decode(const QByteArray &payload, LightStatusInfo &info);
+    static bool decode(const QByteArray &payload, CountDownInfo &info);
+    static bool decodeTscTime(const QByteArray &payload, unsigned int &seconds);
+    static bool decodeAllLightOn(const QByteArray &payload, unsigned char &color);
+    static bool decodeConfig(const QByteArray &payload, QByteArray &content);
+
+    static int lightStatusSize(const char *payload, int len);
+
+    // channels are numbered from 1, a lit red hides yellow and green
+    enum LampColor
+    {
+        LampRed = 0,
+        LampYellow,
+        LampGreen,
+        LampOff
+    };
+    static void toPlanes(const LightStatusInfo &info, LightPlanes &planes);
+    static quint32 changedChannels(const LightPlanes &prev, const LightPlanes &curr);
+    static LampColor channelColor(const LightPlanes &planes, int channel);
+};
+
+#endif // CYTDECODER_H
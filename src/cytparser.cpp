@@ -0,0 +1,372 @@
+#include "cytparser.h"
+
+#include <string.h>
+
+static const char *const error_reply_list[] =
+{
+    "DETECTDATAER",     // no detector data
+    "DRIVEINFOER"       // no driver board info
+};
+
+CytParser::CytParser(int capacity)
+{
+    int size = 1;
+    while (size < capacity)
+    {
+        size <<= 1;
+    }
+    buffer_ = new char[size];
+    mask_ = size - 1;
+    head_ = 0;
+    count_ = 0;
+    scan_ = 0;
+    stream_left_ = 0;
+    stream_id_ = '\0';
+    discarded_bytes_ = 0;
+    for (int i = 0; i < 256; i++)
+    {
+        rule_list_[i].framing = Delimited;
+        rule_list_[i].size = 0;
+        rule_list_[i].func = NULL;
+        rule_list_[i].streamed = false;
+    }
+}
+
+CytParser::~CytParser()
+{
+    delete [] buffer_;
+    buffer_ = NULL;
+}
+
+void CytParser::setFraming(char cmd_id, Framing framing, int size)
+{
+    FramingRule &rule = rule_list_[(unsigned char)cmd_id];
+    rule.framing = framing;
+    rule.size = size;
+    rule.func = NULL;
+}
+
+void CytParser::setFraming(char cmd_id, PayloadSizeFunc func)
+{
+    FramingRule &rule = rule_list_[(unsigned char)cmd_id];
+    rule.framing = Computed;
+    rule.size = 0;
+    rule.func = func;
+}
+
+void CytParser::setStreamed(char cmd_id, bool streamed)
+{
+    rule_list_[(unsigned char)cmd_id].streamed = streamed;
+}
+
+void CytParser::feed(const char *data, int len)
+{
+    if (len <= 0)
+    {
+        return;
+    }
+    reserve(len);
+    int tail = (head_ + count_) & mask_;
+    int first = qMin(len, mask_ + 1 - tail);
+    memcpy(buffer_ + tail, data, first);
+    memcpy(buffer_, data + first, len - first);
+    count_ += len;
+}
+
+void CytParser::feed(const QByteArray &array)
+{
+    feed(array.constData(), array.size());
+}
+
+CytParser::Result CytParser::next(QByteArray &message)
+{
+    if (stream_left_ > 0)
+    {
+        return streamOut(message);
+    }
+    while (count_ > 0)
+    {
+        if (scan_ == 0)
+        {
+            bool partial = false;
+            if (matchAt("CYT", 3, &partial))
+            {
+                if (count_ < HeadSize)
+                {
+                    return NeedMore;
+                }
+                scan_ = HeadSize;
+            }
+            else if (partial)
+            {
+                return NeedMore;
+            }
+            else
+            {
+                int len = errorReplySize(&partial);
+                if (len > 0)
+                {
+                    copyOut(len, message);
+                    consume(len);
+                    return ErrorReply;
+                }
+                if (partial)
+                {
+                    return NeedMore;
+                }
+                // resync: drop one byte and look for a head again
+                consume(1);
+                discarded_bytes_++;
+                continue;
+            }
+        }
+
+        if (rule_list_[(unsigned char)at(HeadSize - 1)].framing != Delimited)
+        {
+            int size = payloadSize();
+            if (size == -1)
+            {
+                return NeedMore;
+            }
+            int len = HeadSize + size + TailSize;
+            if (size >= 0 && len <= CYT_MAX_MESSAGE_SIZE)
+            {
+                if (rule_list_[(unsigned char)at(HeadSize - 1)].streamed)
+                {
+                    stream_id_ = at(HeadSize - 1);
+                    stream_left_ = len;
+                    scan_ = 0;
+                    return streamOut(message);
+                }
+                if (count_ < len)
+                {
+                    return NeedMore;
+                }
+                if (at(len - 3) == 'E' && at(len - 2) == 'N' && at(len - 1) == 'D')
+                {
+                    copyOut(len, message);
+                    consume(len);
+                    scan_ = 0;
+                    return Message;
+                }
+            }
+            // no tail where the size says, the head was garbage
+            consume(1);
+            discarded_bytes_++;
+            scan_ = 0;
+            continue;
+        }
+
+        while (scan_ + TailSize <= count_)
+        {
+            if (at(scan_) == 'E' && at(scan_ + 1) == 'N' && at(scan_ + 2) == 'D')
+            {
+                int len = scan_ + TailSize;
+                copyOut(len, message);
+                consume(len);
+                scan_ = 0;
+                return Message;
+            }
+            scan_++;
+        }
+        if (scan_ < CYT_MAX_MESSAGE_SIZE)
+        {
+            return NeedMore;
+        }
+        // the head was garbage, hunt again behind it
+        consume(1);
+        discarded_bytes_++;
+        scan_ = 0;
+    }
+    return NeedMore;
+}
+
+void CytParser::clear()
+{
+    head_ = 0;
+    count_ = 0;
+    scan_ = 0;
+    stream_left_ = 0;
+}
+
+int CytParser::bufferedBytes() const
+{
+    return count_;
+}
+
+char CytParser::streamId() const
+{
+    return stream_id_;
+}
+
+qint64 CytParser::discardedBytes() const
+{
+    return discarded_bytes_;
+}
+
+char CytParser::commandId(const QByteArray &message)
+{
+    if (message.size() < HeadSize)
+    {
+        return '\0';
+    }
+    return message.at(HeadSize - 1);
+}
+
+QByteArray CytParser::payload(const QByteArray &message)
+{
+    if (message.size() < HeadSize + TailSize)
+    {
+        return QByteArray();
+    }
+    return QByteArray::fromRawData(message.constData() + HeadSize, message.size() - HeadSize - TailSize);
+}
+
+// payload size of the buffered head by its framing rule, -1 while unknown, -2 when invalid
+int CytParser::payloadSize() const
+{
+    const FramingRule &rule = rule_list_[(unsigned char)at(HeadSize - 1)];
+    int available = count_ - HeadSize;
+    switch (rule.framing)
+    {
+    case Fixed:
+        return rule.size;
+    case LengthPrefixed:
+    {
+        if (available < 4)
+        {
+            return -1;
+        }
+        unsigned int len = 0;
+        for (int i = 3; i >= 0; i--)
+        {
+            len = (len << 8) | (unsigned char)at(HeadSize + i);
+        }
+        if (len < (unsigned int)(HeadSize + 4 + TailSize) || len > CYT_MAX_MESSAGE_SIZE)
+        {
+            return -2;
+        }
+        return (int)len - HeadSize - TailSize;
+    }
+    case Computed:
+    {
+        char peek[CYT_SIZE_PEEK];
+        int len = qMin(available, (int)CYT_SIZE_PEEK);
+        for (int i = 0; i < len; i++)
+        {
+            peek[i] = at(HeadSize + i);
+        }
+        int size = rule.func(peek, len);
+        if (size == -1 && len == CYT_SIZE_PEEK)
+        {
+            return -2;
+        }
+        return size < -1 ? -2 : size;
+    }
+    default:
+        return -2;
+    }
+}
+
+char CytParser::at(int offset) const
+{
+    return buffer_[(head_ + offset) & mask_];
+}
+
+// partial is set when the buffered bytes are a prefix of str
+bool CytParser::matchAt(const char *str, int len, bool *partial) const
+{
+    int n = qMin(len, count_);
+    for (int i = 0; i < n; i++)
+    {
+        if (at(i) != str[i])
+        {
+            *partial = false;
+            return false;
+        }
+    }
+    *partial = (n < len);
+    return !*partial;
+}
+
+int CytParser::errorReplySize(bool *partial) const
+{
+    bool any_partial = false;
+    for (unsigned int i = 0; i < sizeof(error_reply_list) / sizeof(error_reply_list[0]); i++)
+    {
+        int len = (int)strlen(error_reply_list[i]);
+        if (matchAt(error_reply_list[i], len, partial))
+        {
+            return len;
+        }
+        any_partial = any_partial || *partial;
+    }
+    *partial = any_partial;
+    return 0;
+}
+
+void CytParser::copyOut(int len, QByteArray &out) const
+{
+    out.resize(len);
+    int first = qMin(len, mask_ + 1 - head_);
+    memcpy(out.data(), buffer_ + head_, first);
+    memcpy(out.data() + first, buffer_, len - first);
+}
+
+void CytParser::consume(int len)
+{
+    head_ = (head_ + len) & mask_;
+    count_ -= len;
+    if (count_ == 0)
+    {
+        head_ = 0;
+    }
+}
+
+// hands out what is buffered of the streamed message, the tail as a piece of its own
+CytParser::Result CytParser::streamOut(QByteArray &message)
+{
+    int len = stream_left_ - TailSize;
+    if (len <= 0)
+    {
+        if (count_ < TailSize)
+        {
+            return NeedMore;
+        }
+        copyOut(TailSize, message);
+        consume(TailSize);
+        stream_left_ = 0;
+        return LastChunk;
+    }
+    len = qMin(len, count_);
+    if (len == 0)
+    {
+        return NeedMore;
+    }
+    copyOut(len, message);
+    consume(len);
+    stream_left_ -= len;
+    return Chunk;
+}
+
+// grows the ring to the next power of two that holds len more bytes
+void CytParser::reserve(int len)
+{
+    int size = mask_ + 1;
+    if (count_ + len <= size)
+    {
+        return;
+    }
+    while (size < count_ + len)
+    {
+        size <<= 1;
+    }
+    char *buffer = new char[size];
+    int first = qMin(count_, mask_ + 1 - head_);
+    memcpy(buffer, buffer_ + head_, first);
+    memcpy(buffer + first, buffer_, count_ - first);
+    delete [] buffer_;
+    buffer_ = buffer;
+    mask_ = size - 1;
+    head_ = 0;
+}
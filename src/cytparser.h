@@ -0,0 +1,104 @@
+#ifndef CYTPARSER_H
+#define CYTPARSER_H
+
+#include <QByteArray>
+
+#define CYT_PARSER_CAPACITY     4096
+#define CYT_MAX_MESSAGE_SIZE    (1024*1024)     // a head without a tail this far away is garbage
+#define CYT_SIZE_PEEK           16              // payload bytes a PayloadSizeFunc gets to look at
+
+/* Streaming framer for the signaler replies.
+ * Received bytes are appended to a ring buffer, next() hands out one complete
+ * CYT<id>...END message at a time and moves the read cursor past it. Every
+ * byte is looked at once: the search for END resumes where the previous call
+ * stopped, and garbage in front of a message is skipped until the next CYT.
+ *
+ * Binary replies declare their payload size with setFraming(), those are cut
+ * at the declared size and only checked for the END tail, so a payload that
+ * happens to contain "END" is not split.
+ *
+ * A streamed reply (setStreamed) is not buffered up to its end, next() hands
+ * it out in pieces as they arrive: Chunk for every piece but the last, which
+ * is a LastChunk made of the three tail bytes. The receiver checks the tail.
+*/
+class CytParser
+{
+public:
+    explicit CytParser(int capacity = CYT_PARSER_CAPACITY);
+    ~CytParser();
+
+    enum Result
+    {
+        NeedMore = 0,   // no complete message buffered
+        Message,        // CYT<id>...END
+        ErrorReply,     // bare error text sent instead of a message, e.g. DETECTDATAER
+        Chunk,          // piece of a streamed message, the first one starts with the head
+        LastChunk       // the tail of a streamed message
+    };
+
+    enum Layout
+    {
+        HeadSize = 4,   // "CYT" + id
+        TailSize = 3    // "END"
+    };
+
+    enum Framing
+    {
+        Delimited = 0,      // payload runs to the first END
+        Fixed,              // payload of size bytes
+        LengthPrefixed,     // payload starts with the length of the whole message, 4 bytes
+        Computed            // payload size told by a PayloadSizeFunc
+    };
+
+    // returns the payload size, -1 when len bytes are not enough to tell
+    typedef int (*PayloadSizeFunc)(const char *payload, int len);
+
+    void setFraming(char cmd_id, Framing framing, int size = 0);
+    void setFraming(char cmd_id, PayloadSizeFunc func);
+    // only for framings that know the size before the payload is in
+    void setStreamed(char cmd_id, bool streamed);
+
+    void feed(const char *data, int len);
+    void feed(const QByteArray &array);
+    Result next(QByteArray &message);
+    void clear();
+
+    int bufferedBytes() const;
+    char streamId() const;      // command id of the last streamed message
+    qint64 discardedBytes() const;
+
+    static char commandId(const QByteArray &message);
+    // bytes between head and tail, shares the data of message
+    static QByteArray payload(const QByteArray &message);
+
+private:
+    int payloadSize() const;
+    char at(int offset) const;
+    bool matchAt(const char *str, int len, bool *partial) const;
+    int errorReplySize(bool *partial) const;
+    void copyOut(int len, QByteArray &out) const;
+    void consume(int len);
+    void reserve(int len);
+    Result streamOut(QByteArray &message);
+
+private:
+    struct FramingRule
+    {
+        Framing framing;
+        int size;
+        PayloadSizeFunc func;
+        bool streamed;
+    };
+    FramingRule rule_list_[256];    // indexed by command id
+
+    char *buffer_;
+    int mask_;          // capacity - 1, capacity is a power of two
+    int head_;          // read cursor
+    int count_;
+    int scan_;          // offset from head_ where the END search resumes, 0 while hunting a head
+    int stream_left_;   // bytes of the streamed message not handed out yet
+    char stream_id_;
+    qint64 discarded_bytes_;
+};
+
+#endif // CYTPARSER_H
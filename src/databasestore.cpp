@@ -0,0 +1,33 @@
+#include "databasestore.h"
+
+DatabaseStore::DatabaseStore()
+{
+    version_ = 0;
+    current_ = Snapshot(new MDatabase);
+}
+
+DatabaseStore::Snapshot DatabaseStore::publish(MDatabase *db)
+{
+    Snapshot published(db);
+    Snapshot previous;
+    {
+        QWriteLocker locker(&lock_);
+        db->set_version(++version_);
+        previous = current_;
+        current_ = published;
+    }
+    // previous is dropped outside the lock, its last reader may free it later
+    return published;
+}
+
+DatabaseStore::Snapshot DatabaseStore::snapshot() const
+{
+    QReadLocker locker(&lock_);
+    return current_;
+}
+
+quint64 DatabaseStore::version() const
+{
+    QReadLocker locker(&lock_);
+    return version_;
+}
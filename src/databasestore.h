@@ -0,0 +1,34 @@
+#ifndef DATABASESTORE_H
+#define DATABASESTORE_H
+
+#include <QSharedPointer>
+#include <QReadWriteLock>
+#include "mdatabase.h"
+
+/* Hands the current config database to readers on any thread.
+ * A published MDatabase is not written again: publish() stamps it with the
+ * next version and swaps it in, a reader keeps the snapshot it took for as
+ * long as it needs it, whatever is published meanwhile, and an old database
+ * is freed with its last snapshot. The lock covers only the swap and the
+ * copy of the pointer, the tables are read without it.
+*/
+class DatabaseStore
+{
+public:
+    typedef QSharedPointer<const MDatabase> Snapshot;
+
+    DatabaseStore();
+
+    // takes db, returns the snapshot it became
+    Snapshot publish(MDatabase *db);
+    // never NULL, an empty database of version 0 until the first publish()
+    Snapshot snapshot() const;
+    quint64 version() const;
+
+private:
+    mutable QReadWriteLock lock_;
+    Snapshot current_;
+    quint64 version_;
+};
+
+#endif // DATABASESTORE_H
@@ -0,0 +1,41 @@
+#include "fastrandom.h"
+
+static quint64 splitMix64(quint64 &state)
+{
+    quint64 z = (state += Q_UINT64_C(0x9E3779B97F4A7C15));
+    z = (z ^ (z >> 30)) * Q_UINT64_C(0xBF58476D1CE4E5B9);
+    z = (z ^ (z >> 27)) * Q_UINT64_C(0x94D049BB133111EB);
+    return z ^ (z >> 31);
+}
+
+FastRandom::FastRandom(quint64 seed)
+{
+    this->seed(seed);
+}
+
+void FastRandom::seed(quint64 seed)
+{
+    s0_ = splitMix64(seed);
+    s1_ = splitMix64(seed);
+    if (s0_ == 0 && s1_ == 0)
+    {
+        s1_ = 1;
+    }
+}
+
+quint32 FastRandom::bounded(quint32 n)
+{
+    return (quint32)(((next() >> 32) * n) >> 32);
+}
+
+double FastRandom::uniform()
+{
+    return (next() >> 11) * (1.0 / 9007199254740992.0);
+}
+
+// seed of an independent stream, e.g. one per lane
+quint64 FastRandom::streamSeed(quint64 seed, int stream)
+{
+    quint64 state = seed ^ ((quint64)(stream + 1) * Q_UINT64_C(0xD1B54A32D192ED03));
+    return splitMix64(state);
+}
@@ -0,0 +1,37 @@
+#ifndef FASTRANDOM_H
+#define FASTRANDOM_H
+
+#include <QtGlobal>
+
+/* xorshift128+ generator.
+ * Seeded once through splitmix64, so nearby seeds (lane 0, lane 1 ...) give
+ * unrelated streams. Not for anything security related.
+*/
+class FastRandom
+{
+public:
+    explicit FastRandom(quint64 seed = 1);
+
+    void seed(quint64 seed);
+
+    inline quint64 next()
+    {
+        quint64 x = s0_;
+        const quint64 y = s1_;
+        s0_ = y;
+        x ^= x << 23;
+        s1_ = x ^ y ^ (x >> 17) ^ (y >> 26);
+        return s1_ + y;
+    }
+
+    quint32 bounded(quint32 n);     // [0, n)
+    double uniform();               // [0, 1)
+
+    static quint64 streamSeed(quint64 seed, int stream);
+
+private:
+    quint64 s0_;
+    quint64 s1_;
+};
+
+#endif // FASTRANDOM_H
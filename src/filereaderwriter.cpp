@@ -1,4 +1,6 @@
 #include "filereaderwriter.h"
+#include "tscimage.h"
+#include "compactconfig.h"
 #include <memory.h>
 #include <QDebug>
 
@@ -22,68 +24,31 @@ MDatabase* FileReaderWriter::defaultDatabase()
     return db_;
 }
 
+// the image is mapped once and copied table by table, see TscImage
 bool FileReaderWriter::ReadFile(MDatabase *db, const char* file_path)
 {
-	open_file_path_ = std::string(file_path);
-	FILE *fp = fopen(file_path, "rb");
-	if (fp == NULL)
-	{
-		return false;
-	}
+    open_file_path_ = std::string(file_path);
+    TscImage image;
+    if (!image.open(QString::fromLocal8Bit(file_path)))
+    {
+        qDebug() << file_path << image.errorString();
+        return false;
+    }
     db_ = db;
-	ResetParam();
-	fseek(fp, 0, SEEK_SET);
-	fread(&tsc_param_.tsc_header_, sizeof(tsc_param_.tsc_header_), 1, fp);
-	fread(&tsc_param_.unit_param_, sizeof(tsc_param_.unit_param_), 1, fp);
-	fread(&tsc_param_.sched_table_, sizeof(tsc_param_.sched_table_), 1, fp);
-	fread(&tsc_param_.time_section_table_, sizeof(tsc_param_.time_section_table_), 1, fp);
-	fread(&tsc_param_.timing_plan_table_, sizeof(tsc_param_.timing_plan_table_), 1, fp);
-	fread(&tsc_param_.stage_timing_table_, sizeof(tsc_param_.stage_timing_table_), 1, fp);
-	fread(&tsc_param_.phase_table_, sizeof(tsc_param_.phase_table_), 1, fp);
-	fread(&tsc_param_.phase_conflict_table_, sizeof(tsc_param_.phase_conflict_table_), 1, fp);
-	fread(&tsc_param_.channel_table_, sizeof(tsc_param_.channel_table_), 1, fp);
-	fread(&tsc_param_.channel_hint_table_, sizeof(tsc_param_.channel_hint_table_), 1, fp);
-	fread(&tsc_param_.detector_table_, sizeof(tsc_param_.detector_table_), 1, fp);
-	db_->set_tsc_header(tsc_param_.tsc_header_);
-	db_->set_unit_table(tsc_param_.unit_param_);
-	db_->set_schedule_table(tsc_param_.sched_table_);
-	db_->set_timesection_table(tsc_param_.time_section_table_);
-	db_->set_timing_table(tsc_param_.timing_plan_table_);
-	db_->set_phasetiming_table(tsc_param_.stage_timing_table_);
-	db_->set_phase_table(tsc_param_.phase_table_);
-	db_->set_phase_conflict_table(tsc_param_.phase_conflict_table_);
-	db_->set_channel_table(tsc_param_.channel_table_);
-	db_->set_channel_hint_table(tsc_param_.channel_hint_table_);
-	db_->set_detector_table(tsc_param_.detector_table_);
-
-	fclose(fp);
+    image.copyTo(db_);
     return true;
 }
 
 bool FileReaderWriter::ReadFile(const char *file_path, TSCParam &param)
 {
     open_file_path_ = std::string(file_path);
-    FILE *fp = fopen(file_path, "rb");
-    if (fp == NULL)
+    TscImage image;
+    if (!image.open(QString::fromLocal8Bit(file_path)))
     {
-        qDebug() << file_path << " file pointer is null";
+        qDebug() << file_path << image.errorString();
         return false;
     }
-    ResetParam();
-    fseek(fp, 0, SEEK_SET);
-    fread(&param.tsc_header_, sizeof(tsc_param_.tsc_header_), 1, fp);
-    fread(&param.unit_param_, sizeof(tsc_param_.unit_param_), 1, fp);
-    fread(&param.sched_table_, sizeof(tsc_param_.sched_table_), 1, fp);
-    fread(&param.time_section_table_, sizeof(tsc_param_.time_section_table_), 1, fp);
-    fread(&param.timing_plan_table_, sizeof(tsc_param_.timing_plan_table_), 1, fp);
-    fread(&param.stage_timing_table_, sizeof(tsc_param_.stage_timing_table_), 1, fp);
-    fread(&param.phase_table_, sizeof(tsc_param_.phase_table_), 1, fp);
-    fread(&param.phase_conflict_table_, sizeof(tsc_param_.phase_conflict_table_), 1, fp);
-    fread(&param.channel_table_, sizeof(tsc_param_.channel_table_), 1, fp);
-    fread(&param.channel_hint_table_, sizeof(tsc_param_.channel_hint_table_), 1, fp);
-    fread(&param.detector_table_, sizeof(tsc_param_.detector_table_), 1, fp);
-
-    fclose(fp);
+    image.copyTo(param);
     return true;
 }
 
@@ -151,6 +116,18 @@ bool FileReaderWriter::WriteFile(const TSCParam &param, const char *file_path)
     return true;
 }
 
+// only the used rows, ReadFile() takes both forms
+bool FileReaderWriter::WriteCompactFile(const TSCParam &param, const char *file_path)
+{
+    QString error;
+    if (!CompactConfig::save(QString::fromLocal8Bit(file_path), TscImage::pack(param), &error))
+    {
+        qDebug() << file_path << error;
+        return false;
+    }
+    return true;
+}
+
 void FileReaderWriter::SetTSCParam(const TSCParam &param)
 {
     memcpy(&tsc_param_, &param, sizeof(param));
@@ -22,6 +22,7 @@ public:
     bool ReadFile(const char *file_path, TSCParam &param);
     bool WriteFile(const char* file_path);
     bool WriteFile(const TSCParam &param, const char *file_path);
+    bool WriteCompactFile(const TSCParam &param, const char *file_path);
     void SetTSCParam(const TSCParam &param);
 
 private:
@@ -0,0 +1,32 @@
+#include "frameclock.h"
+
+#include <QElapsedTimer>
+
+static QElapsedTimer startedTimer()
+{
+    QElapsedTimer timer;
+    timer.start();
+    return timer;
+}
+
+// a local static is initialized once even when threads race for it
+static const QElapsedTimer &frameTimer()
+{
+    static const QElapsedTimer timer = startedTimer();
+    return timer;
+}
+
+qint64 FrameClock::nsecs()
+{
+    return frameTimer().nsecsElapsed();
+}
+
+qint64 FrameClock::usecs()
+{
+    return frameTimer().nsecsElapsed() / 1000;
+}
+
+qint64 FrameClock::msecs()
+{
+    return frameTimer().nsecsElapsed() / 1000000;
+}
@@ -0,0 +1,18 @@
+#ifndef FRAMECLOCK_H
+#define FRAMECLOCK_H
+
+#include <QtGlobal>
+
+/* Monotonic clock shared by everything that stamps or schedules detector
+ * frames. Starts on first use, never jumps with the wall clock and has
+ * sub-millisecond resolution where the platform provides it.
+*/
+class FrameClock
+{
+public:
+    static qint64 nsecs();
+    static qint64 usecs();
+    static qint64 msecs();
+};
+
+#endif // FRAMECLOCK_H
@@ -0,0 +1,149 @@
+#include "framesink.h"
+#include "frameclock.h"
+
+FrameSink::FrameSink(QObject *parent) :
+    QObject(parent)
+{
+    reset();
+}
+
+void FrameSink::reset()
+{
+    pending_list_.clear();
+    rx_array_.clear();
+    sent_ = 0;
+    received_ = 0;
+    lost_ = 0;
+    discarded_ = 0;
+    first_rx_ns_ = -1;
+    last_rx_ns_ = -1;
+    min_latency_ns_ = -1;
+    max_latency_ns_ = 0;
+    sum_latency_ns_ = 0;
+}
+
+qint64 FrameSink::framesSent() const
+{
+    return sent_;
+}
+
+qint64 FrameSink::framesReceived() const
+{
+    return received_;
+}
+
+// frames overtaken by a later frame, plus the ones still missing
+qint64 FrameSink::framesLost() const
+{
+    return lost_ + pending_list_.size();
+}
+
+qint64 FrameSink::bytesDiscarded() const
+{
+    return discarded_;
+}
+
+double FrameSink::framesPerSecond() const
+{
+    if (received_ < 2 || last_rx_ns_ <= first_rx_ns_)
+    {
+        return 0;
+    }
+    return (received_ - 1) * 1e9 / (last_rx_ns_ - first_rx_ns_);
+}
+
+qint64 FrameSink::minLatencyUs() const
+{
+    return min_latency_ns_ < 0 ? 0 : min_latency_ns_ / 1000;
+}
+
+qint64 FrameSink::maxLatencyUs() const
+{
+    return max_latency_ns_ / 1000;
+}
+
+qint64 FrameSink::avgLatencyUs() const
+{
+    return received_ > 0 ? sum_latency_ns_ / received_ / 1000 : 0;
+}
+
+QString FrameSink::summary() const
+{
+    return QString("sent %1 received %2 lost %3 discarded %4 bytes, %5 frames/s, latency min %6 avg %7 max %8 us")
+            .arg(framesSent()).arg(framesReceived()).arg(framesLost()).arg(bytesDiscarded())
+            .arg(framesPerSecond(), 0, 'f', 1)
+            .arg(minLatencyUs()).arg(avgLatencyUs()).arg(maxLatencyUs());
+}
+
+void FrameSink::frameSentSlot(const QByteArray &frame)
+{
+    if (frame.size() != SerialData::Size)
+    {
+        return;
+    }
+    PendingFrame pending;
+    memcpy(pending.frame, frame.constData(), SerialData::Size);
+    pending.sent_ns = FrameClock::nsecs();
+    pending_list_.enqueue(pending);
+    sent_++;
+}
+
+void FrameSink::feed(const QByteArray &data)
+{
+    rx_array_.append(data);
+    int pos = 0;
+    while (rx_array_.size() - pos >= SerialData::Size)
+    {
+        const char *p = rx_array_.constData() + pos;
+        if (!SerialData::isFrame(p))
+        {
+            // out of sync, slide one byte
+            pos++;
+            discarded_++;
+            continue;
+        }
+        frameReceived(p);
+        pos += SerialData::Size;
+    }
+    rx_array_.remove(0, pos);
+}
+
+void FrameSink::frameReceived(const char *frame)
+{
+    qint64 now = FrameClock::nsecs();
+
+    // frames arrive in order, anything skipped before a match was lost
+    int skipped = 0;
+    while (skipped < pending_list_.size()
+           && !SerialData::equal(pending_list_.at(skipped).frame, frame))
+    {
+        skipped++;
+    }
+    if (skipped == pending_list_.size())
+    {
+        // not sent by us, count it as noise on the line
+        discarded_ += SerialData::Size;
+        return;
+    }
+    if (first_rx_ns_ < 0)
+    {
+        first_rx_ns_ = now;
+    }
+    last_rx_ns_ = now;
+    received_++;
+    for (int i = 0; i < skipped; i++)
+    {
+        pending_list_.dequeue();
+    }
+    lost_ += skipped;
+    qint64 latency = now - pending_list_.dequeue().sent_ns;
+    if (min_latency_ns_ < 0 || latency < min_latency_ns_)
+    {
+        min_latency_ns_ = latency;
+    }
+    if (latency > max_latency_ns_)
+    {
+        max_latency_ns_ = latency;
+    }
+    sum_latency_ns_ += latency;
+}
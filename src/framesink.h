@@ -0,0 +1,60 @@
+#ifndef FRAMESINK_H
+#define FRAMESINK_H
+
+#include <QObject>
+#include <QByteArray>
+#include <QQueue>
+#include "serialdata.h"
+
+/* Far end of a loopback port.
+ * Decodes the 0xF1 ... 0xED detector frames read back from the line and
+ * matches them against the frames the simulator reported as sent, which
+ * gives frames/second, send-to-receive latency and frame loss.
+*/
+class FrameSink : public QObject
+{
+    Q_OBJECT
+public:
+    explicit FrameSink(QObject *parent = 0);
+
+    void reset();
+
+    qint64 framesSent() const;
+    qint64 framesReceived() const;
+    qint64 framesLost() const;
+    qint64 bytesDiscarded() const;
+    double framesPerSecond() const;
+    qint64 minLatencyUs() const;
+    qint64 maxLatencyUs() const;
+    qint64 avgLatencyUs() const;
+    QString summary() const;
+
+public slots:
+    void frameSentSlot(const QByteArray &frame);
+    void feed(const QByteArray &data);
+
+private:
+    void frameReceived(const char *frame);
+
+private:
+    struct PendingFrame
+    {
+        char frame[SerialData::Size];
+        qint64 sent_ns;
+    };
+
+    QQueue<PendingFrame> pending_list_;     // sent, not yet seen on the line
+    QByteArray rx_array_;
+
+    qint64 sent_;
+    qint64 received_;
+    qint64 lost_;
+    qint64 discarded_;
+    qint64 first_rx_ns_;
+    qint64 last_rx_ns_;
+    qint64 min_latency_ns_;
+    qint64 max_latency_ns_;
+    qint64 sum_latency_ns_;
+};
+
+#endif // FRAMESINK_H
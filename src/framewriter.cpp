@@ -0,0 +1,279 @@
+#include "framewriter.h"
+#include "frameclock.h"
+#include "serialdata.h"
+#include "qextserialbase.h"
+
+#include <QIODevice>
+#include <QTimer>
+#include <string.h>
+
+FrameWriter::FrameWriter(int capacity, QObject *parent) :
+    QObject(parent)
+{
+    device_ = NULL;
+    port_ = NULL;
+    capacity_ = capacity > 0 ? capacity : FRAME_WRITER_CAPACITY;
+    buffer_ = new char[capacity_];
+    scratch_ = new char[capacity_];
+    head_ = 0;
+    count_ = 0;
+
+    deadline_ms_ = FRAME_FLUSH_DEADLINE_MS;
+    deadline_timer_ = new QTimer(this);
+    deadline_timer_->setSingleShot(true);
+    deadline_timer_->setTimerType(Qt::PreciseTimer);
+    connect(deadline_timer_, SIGNAL(timeout()), this, SLOT(deadlineTimeoutSlot()));
+
+    link_rate_ = -1;
+    max_queue_ms_ = FRAME_MAX_QUEUE_MS;
+    credit_ = 0;
+    credit_us_ = FrameClock::usecs();
+    dropped_frames_ = 0;
+}
+
+FrameWriter::~FrameWriter()
+{
+    delete [] buffer_;
+    buffer_ = NULL;
+    delete [] scratch_;
+    scratch_ = NULL;
+}
+
+void FrameWriter::setDevice(QIODevice *device)
+{
+    device_ = device;
+    port_ = qobject_cast<QextSerialBase *>(device);
+}
+
+QIODevice *FrameWriter::device() const
+{
+    return device_;
+}
+
+void FrameWriter::setFlushDeadline(int msecs)
+{
+    deadline_ms_ = msecs;
+}
+
+// -1 follows the settings of the serial port, 0 disables pacing
+void FrameWriter::setLinkRate(int bytes_per_sec)
+{
+    link_rate_ = bytes_per_sec;
+}
+
+int FrameWriter::linkRate() const
+{
+    if (link_rate_ >= 0)
+    {
+        return link_rate_;
+    }
+    if (port_ == NULL)
+    {
+        return 0;
+    }
+    struct PortSettings settings;
+    settings.BaudRate = port_->baudRate();
+    settings.DataBits = port_->dataBits();
+    settings.Parity = port_->parity();
+    settings.StopBits = port_->stopBits();
+    settings.FlowControl = port_->flowControl();
+    settings.Timeout_Millisec = 0;
+    return bytesPerSecond(settings);
+}
+
+void FrameWriter::setMaxQueueTime(int msecs)
+{
+    max_queue_ms_ = msecs;
+}
+
+// returns false when the frame is dropped
+// reserved frames may use the room kept free and are not bound by the queue time
+bool FrameWriter::append(const char *data, int len, bool reserved)
+{
+    if (len <= 0)
+    {
+        return true;
+    }
+    int room = reserved ? capacity_ : capacity_ - reservedBytes();
+    if (linkRate() > 0)
+    {
+        if (!reserved && queuedBytes() + len > queueLimit())
+        {
+            dropped_frames_++;
+            return false;
+        }
+    }
+    else if (len > room - count_)
+    {
+        flush();
+    }
+    if (len > room - count_)
+    {
+        dropped_frames_++;
+        return false;
+    }
+    int tail = (head_ + count_) % capacity_;
+    int first = qMin(len, capacity_ - tail);
+    memcpy(buffer_ + tail, data, first);
+    if (first < len)
+    {
+        memcpy(buffer_, data + first, len - first);
+    }
+    count_ += len;
+    if (!deadline_timer_->isActive())
+    {
+        deadline_timer_->start(deadline_ms_);
+    }
+    return true;
+}
+
+int FrameWriter::pendingBytes() const
+{
+    return count_;
+}
+
+// pending here plus not yet sent by the device
+int FrameWriter::queuedBytes() const
+{
+    qint64 device_bytes = (device_ != NULL && device_->isOpen()) ? device_->bytesToWrite() : 0;
+    return count_ + (int)device_bytes;
+}
+
+int FrameWriter::capacity() const
+{
+    return capacity_;
+}
+
+// producers should hold back new traffic while this is true
+bool FrameWriter::isCongested() const
+{
+    return queuedBytes() * 2 >= queueLimit();
+}
+
+qint64 FrameWriter::droppedFrames() const
+{
+    return dropped_frames_;
+}
+
+void FrameWriter::clear()
+{
+    head_ = 0;
+    count_ = 0;
+    deadline_timer_->stop();
+}
+
+/* bytes/s of a serial line: every character costs a start bit, the data
+ * bits, the parity bit and the stop bits (1.5 counted as 2).
+*/
+int FrameWriter::bytesPerSecond(const PortSettings &settings)
+{
+    static const int baud_list[] =
+    {
+        50, 75, 110, 134, 150, 200, 300, 600, 1200, 1800, 2400, 4800, 9600,
+        14400, 19200, 38400, 56000, 57600, 76800, 115200, 128000, 256000
+    };
+    if (settings.BaudRate < 0 || settings.BaudRate >= (int)(sizeof(baud_list) / sizeof(baud_list[0])))
+    {
+        return 0;
+    }
+    int bits = 1 + 5 + settings.DataBits;
+    if (settings.Parity != PAR_NONE)
+    {
+        bits += 1;
+    }
+    bits += (settings.StopBits == STOP_1) ? 1 : 2;
+    return baud_list[settings.BaudRate] / bits;
+}
+
+qint64 FrameWriter::flush()
+{
+    deadline_timer_->stop();
+    if (count_ == 0)
+    {
+        return 0;
+    }
+    if (device_ == NULL || !device_->isOpen())
+    {
+        clear();
+        return 0;
+    }
+    int len = count_;
+    int rate = linkRate();
+    if (rate > 0)
+    {
+        len = qMin(len, refill(rate));
+        if (len <= 0)
+        {
+            // wait until the line can take one more frame
+            int need = qMin(count_, (int)SerialData::Size) - (int)credit_;
+            deadline_timer_->start(qMax(1, need * 1000 / rate + 1));
+            return 0;
+        }
+    }
+    const char *data = buffer_ + head_;
+    if (head_ + len > capacity_)
+    {
+        int first = capacity_ - head_;
+        memcpy(scratch_, buffer_ + head_, first);
+        memcpy(scratch_ + first, buffer_, len - first);
+        data = scratch_;
+    }
+    qint64 sz = device_->write(data, len);
+    if (sz > 0)
+    {
+        consume(sz);
+        credit_ -= sz;
+    }
+    if (count_ > 0)
+    {
+        // partial or paced write, retry the remaining bytes later
+        deadline_timer_->start(rate > 0 ? qMax(1, qMin(count_, (int)SerialData::Size) * 1000 / rate + 1) : deadline_ms_);
+    }
+    return sz;
+}
+
+void FrameWriter::deadlineTimeoutSlot()
+{
+    flush();
+}
+
+void FrameWriter::consume(int len)
+{
+    head_ = (head_ + len) % capacity_;
+    count_ -= len;
+    if (count_ == 0)
+    {
+        head_ = 0;
+    }
+}
+
+// room held back for leave frames, ordinary frames never fill it
+int FrameWriter::reservedBytes() const
+{
+    return qMin(capacity_ / 2, FRAME_RESERVED_FRAMES * (int)SerialData::Size);
+}
+
+// bytes that fit in max_queue_ms_ of line time, never more than the unreserved buffer
+int FrameWriter::queueLimit() const
+{
+    int rate = linkRate();
+    if (rate <= 0)
+    {
+        return capacity_;
+    }
+    return qBound((int)SerialData::Size, rate * max_queue_ms_ / 1000, capacity_ - reservedBytes());
+}
+
+// line credit accumulated since the last write, at most one deadline worth of burst
+int FrameWriter::refill(int rate)
+{
+    qint64 now = FrameClock::usecs();
+    credit_ += (now - credit_us_) * rate / 1000000.0;
+    credit_us_ = now;
+    double burst = qMax((double)SerialData::Size, rate * deadline_ms_ / 1000.0);
+    if (credit_ > burst)
+    {
+        credit_ = burst;
+    }
+    return (int)credit_;
+}
@@ -0,0 +1,81 @@
+#ifndef FRAMEWRITER_H
+#define FRAMEWRITER_H
+
+#include <QObject>
+
+class QIODevice;
+class QTimer;
+class QextSerialBase;
+struct PortSettings;
+
+#define FRAME_WRITER_CAPACITY   (6*256)     // 256 detector frames
+#define FRAME_FLUSH_DEADLINE_MS 20
+#define FRAME_MAX_QUEUE_MS      250         // paced: frames older than this are not worth sending
+#define FRAME_RESERVED_FRAMES   32          // room kept for reserved frames, at most half the ring
+
+/* Collects the serial frames produced during one dispatch tick in a
+ * preallocated ring buffer and hands them to the device in a single write.
+ * Frames that are not flushed explicitly go out when the deadline expires.
+ *
+ * On a serial port the writes are paced to the line rate of its current
+ * settings; frames that would wait longer than FRAME_MAX_QUEUE_MS are
+ * dropped instead of being queued, and isCongested() tells producers to
+ * back off. Reserved frames (detector leaves, which must not be lost) may
+ * use room the others leave free and are only refused on a full ring.
+*/
+class FrameWriter : public QObject
+{
+    Q_OBJECT
+public:
+    explicit FrameWriter(int capacity = FRAME_WRITER_CAPACITY, QObject *parent = 0);
+    ~FrameWriter();
+
+    void setDevice(QIODevice *device);
+    QIODevice *device() const;
+    void setFlushDeadline(int msecs);
+    void setLinkRate(int bytes_per_sec);
+    int linkRate() const;
+    void setMaxQueueTime(int msecs);
+
+    bool append(const char *data, int len, bool reserved = false);
+    int pendingBytes() const;
+    int queuedBytes() const;
+    int capacity() const;
+    bool isCongested() const;
+    qint64 droppedFrames() const;
+    void clear();
+
+    static int bytesPerSecond(const PortSettings &settings);
+
+public slots:
+    qint64 flush();
+
+private slots:
+    void deadlineTimeoutSlot();
+
+private:
+    void consume(int len);
+    int reservedBytes() const;
+    int queueLimit() const;
+    int refill(int rate);
+
+private:
+    QIODevice *device_;
+    QextSerialBase *port_;
+    char *buffer_;
+    char *scratch_;     // linear copy when pending bytes wrap around
+    int capacity_;
+    int head_;          // read position
+    int count_;         // pending bytes
+
+    int deadline_ms_;
+    QTimer *deadline_timer_;
+
+    int link_rate_;     // bytes/s, -1: follow the port settings, 0: unpaced
+    int max_queue_ms_;
+    double credit_;     // bytes the line can take right now
+    qint64 credit_us_;
+    qint64 dropped_frames_;
+};
+
+#endif // FRAMEWRITER_H
@@ -26,6 +26,7 @@
 #define STRING_UI_START         QObject::tr("Start")
 #define STRING_UI_STOP          QObject::tr("Stop")
 #define STRING_UI_TIMESPAN      QObject::tr("Departure interval")
+#define STRING_UI_CAPTURE       QObject::tr("Capture frames")
 
 #define STRING_UI_PORT          QObject::tr("Port")
 #define STRING_UI_BAUDRATE      QObject::tr("Baud rate")
@@ -112,8 +113,10 @@
 #define STRING_NETWORK_VERSION_RIGHT        QObject::tr("Version corrected")
 #define STRING_NETWORK_CONFIG_RETRY         QObject::tr("Read config file failed. Retry?")
 #define STRING_NETWORK_CFG_TEMP_SAVE        QObject::tr("Save config temp file failed. Retry?")
+#define STRING_NETWORK_CONFIG_PROGRESS      QObject::tr("Reading config file %1%")
 #define STRING_NETWORK_PARSE_ERROR          QObject::tr("Parse network package error")
 #define STRING_NETWORK_HOST_UNREACHABLE     QObject::tr("Host unreachable")
+#define STRING_NETWORK_RECONNECTING         QObject::tr("Link lost, reconnect in %1 s")
 
 
 #endif // MACROSTRINGS_H
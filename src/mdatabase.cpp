@@ -32,6 +32,7 @@ void MDatabase::ResetData()
     memset(&channel_table_, 0x00, sizeof(channel_table_));
     memset(&channel_hint_table_, 0x00, sizeof(channel_hint_table_));
     memset(&detector_table_, 0x00, sizeof(detector_table_));
+    rebuild_index();
 }
 
 void MDatabase::set_tsc_header(const TSCHeader_t &header)
@@ -214,6 +215,7 @@ void MDatabase::set_phase_table(const QList<PhaseParam> &phase_list)
             channel_phase_map_.insertMulti(channel_id_list.at(j), phase_list.at(i).phase_id);
         }
     }
+    rebuild_index();
 }
 
 void MDatabase::set_phase_table(const Phase_t &phase)
@@ -224,6 +226,7 @@ void MDatabase::set_phase_table(const Phase_t &phase)
     {
         memcpy(&phase_table_.PhaseList[i], &phase.PhaseList[i], sizeof(phase.PhaseList[i]));
     }
+    rebuild_index();
 }
 
 void MDatabase::set_channel_table(const QList<ChannelParam> &channel_list)
@@ -259,6 +262,7 @@ void MDatabase::set_channel_table(const QList<ChannelParam> &channel_list)
     }
     channel_table_.FactChannelNum = index;
     channel_hint_table_.FactChannelHintNum = i;
+    rebuild_index();
 }
 
 void MDatabase::set_channel_table(const Channel_t &channel)
@@ -269,6 +273,7 @@ void MDatabase::set_channel_table(const Channel_t &channel)
     {
         memcpy(&channel_table_.ChannelList[i], &channel.ChannelList[i], sizeof(channel.ChannelList[i]));
     }
+    rebuild_index();
 }
 
 void MDatabase::set_channel_hint_table(const ChannelHint_t &channel_hint)
@@ -279,6 +284,7 @@ void MDatabase::set_channel_hint_table(const ChannelHint_t &channel_hint)
     {
         memcpy(&channel_hint_table_.ChannelHintList[i], &channel_hint.ChannelHintList[i], sizeof(channel_hint.ChannelHintList[i]));
     }
+    rebuild_index();
 }
 
 void MDatabase::set_phase_conflict_table(const QList<PhaseConflictParam> &conflict_list)
@@ -418,7 +424,113 @@ Detector_t &MDatabase::get_detector()
     return detector_table_;
 }
 
-QList<ScheduleParam> MDatabase::get_schedule_table()
+const TSCHeader_t &MDatabase::get_tsc_header() const
+{
+    return tsc_header_;
+}
+
+const Unit_t &MDatabase::get_unit_table() const
+{
+    return unit_table_;
+}
+
+const Schedule_t &MDatabase::get_schedule() const
+{
+    return sched_table_;
+}
+
+const TimeSection_t &MDatabase::get_timesection() const
+{
+    return timesection_table_;
+}
+
+const Pattern_t &MDatabase::get_timingplan() const
+{
+    return pattern_table_;
+}
+
+const TimeConfig_t &MDatabase::get_timeconfig() const
+{
+    return timeconfig_table_;
+}
+
+const Phase_t &MDatabase::get_phase() const
+{
+    return phase_table_;
+}
+
+const PhaseError_t &MDatabase::get_phase_err() const
+{
+    return phase_conflict_table_;
+}
+
+const Channel_t &MDatabase::get_channel() const
+{
+    return channel_table_;
+}
+
+const ChannelHint_t &MDatabase::get_channel_hint() const
+{
+    return channel_hint_table_;
+}
+
+const Detector_t &MDatabase::get_detector() const
+{
+    return detector_table_;
+}
+
+quint64 MDatabase::get_version() const
+{
+    return version_;
+}
+
+void MDatabase::set_version(quint64 version)
+{
+    version_ = version;
+}
+
+void MDatabase::rebuild_index()
+{
+    memset(phase_index_, -1, sizeof(phase_index_));
+    memset(channel_hint_index_, -1, sizeof(channel_hint_index_));
+    memset(phase_channel_index_, 0, sizeof(phase_channel_index_));
+    // backwards, so the first row of a repeated id wins as with a scan
+    for (int i = qMin<int>(phase_table_.FactPhaseNum, MAX_PHASE_LINE) - 1; i >= 0; i--)
+    {
+        phase_index_[phase_table_.PhaseList[i].PhaseId] = i;
+    }
+    for (int i = qMin<int>(channel_hint_table_.FactChannelHintNum, MAX_CHANNEL) - 1; i >= 0; i--)
+    {
+        channel_hint_index_[channel_hint_table_.ChannelHintList[i].ChannelId] = i;
+    }
+    for (int i = 0; i < qMin<int>(channel_table_.FactChannelNum, MAX_CHANNEL_LINE); i++)
+    {
+        const ChannelList_t &channel = channel_table_.ChannelList[i];
+        unsigned char &channel_id = phase_channel_index_[channel.ChannelCtrlSrc];
+        if (channel.ChannelCtrlSrc != 0 && (channel_id == 0 || channel.ChannelId < channel_id))
+        {
+            channel_id = channel.ChannelId;
+        }
+    }
+}
+
+int MDatabase::index_of_phase(unsigned char phase_id) const
+{
+    return phase_index_[phase_id];
+}
+
+unsigned char MDatabase::get_phase_type(unsigned char phase_id) const
+{
+    int index = phase_index_[phase_id];
+    return index != -1 ? phase_table_.PhaseList[index].PhaseType : 0;
+}
+
+unsigned char MDatabase::get_phase_channel_id(unsigned char phase_id) const
+{
+    return phase_channel_index_[phase_id];
+}
+
+QList<ScheduleParam> MDatabase::get_schedule_table() const
 {
     QList<ScheduleParam> sched_list;
     for (int i = 0; i < sched_table_.FactScheduleNum; i++)
@@ -435,7 +547,7 @@ QList<ScheduleParam> MDatabase::get_schedule_table()
     return sched_list;
 }
 
-QList<TimeSection> MDatabase::get_timesection_table()
+QList<TimeSection> MDatabase::get_timesection_table() const
 {
     QList<TimeSection> time_section_list;
     for (int i = 0; i < timesection_table_.FactTimeSectionNum; i++)
@@ -462,7 +574,7 @@ QList<TimeSection> MDatabase::get_timesection_table()
     return time_section_list;
 }
 
-QList<TimingParam> MDatabase::get_timing_table()
+QList<TimingParam> MDatabase::get_timing_table() const
 {
     QList<TimingParam> timing_list;
     for (int i = 0; i < pattern_table_.FactPatternNum; i++)
@@ -479,7 +591,7 @@ QList<TimingParam> MDatabase::get_timing_table()
     return timing_list;
 }
 
-QList<PhaseTiming> MDatabase::get_timeconfig_table()
+QList<PhaseTiming> MDatabase::get_timeconfig_table() const
 {
 	unsigned char spec_func = 0;
     QList<PhaseTiming> phase_timing_list;
@@ -510,11 +622,11 @@ QList<PhaseTiming> MDatabase::get_timeconfig_table()
     return phase_timing_list;
 }
 
-QList<PhaseParam> MDatabase::get_phase_table()
+QList<PhaseParam> MDatabase::get_phase_table() const
 {
     QList<PhaseParam> phase_list;
     QList<unsigned char> channel_id_list;
-	init_channel_ctrl_src_phase();
+	QMultiMap<unsigned char, unsigned char> channel_phase_read_map = get_channel_ctrl_src_map();
     for (int i = 0; i < phase_table_.FactPhaseNum; i++)
     {
         PhaseParam phase;
@@ -531,7 +643,7 @@ QList<PhaseParam> MDatabase::get_phase_table()
         phase.phase_spec_func = phase_table_.PhaseList[i].PhaseSpecFunc;
         phase.phase_reserved = phase_table_.PhaseList[i].PhaseReserved;
         //phase.phase_channel = ...
-        channel_id_list = channel_phase_read_map_.keys(phase.phase_id);
+        channel_id_list = channel_phase_read_map.keys(phase.phase_id);
         if (channel_id_list.isEmpty())
         {
             phase.phase_channel = 0;
@@ -550,7 +662,7 @@ QList<PhaseParam> MDatabase::get_phase_table()
     return phase_list;
 }
 
-QList<ChannelParam> MDatabase::get_channel_table()
+QList<ChannelParam> MDatabase::get_channel_table() const
 {
     QList<ChannelParam> channel_list;
     for (int index = -1, i = 0; i < channel_table_.FactChannelNum; i++)
@@ -577,7 +689,7 @@ QList<ChannelParam> MDatabase::get_channel_table()
     return channel_list;
 }
 
-QList<DetectorParam> MDatabase::get_detector_table()
+QList<DetectorParam> MDatabase::get_detector_table() const
 {
     QList<DetectorParam> detector_list;
     for (int i = 0; i < detector_table_.FactDetectorNum; i++)
@@ -602,6 +714,13 @@ QList<DetectorParam> MDatabase::get_detector_table()
     detector_list.clear();
 	detector_list = QList<DetectorParam>::fromStdList(std_detector_list);
 
+    // the sort keeps the rows of an id together, search only those
+    short first_of_id[256];
+    memset(first_of_id, -1, sizeof(first_of_id));
+    for (int i = detector_list.size() - 1; i >= 0; i--)
+    {
+        first_of_id[detector_list.at(i).detector_id] = i;
+    }
     DetectorParam detector_tmp;
     for (int i = 0, index = -1; i < detector_table_.FactDetectorNum; i++)
     {
@@ -615,7 +734,15 @@ QList<DetectorParam> MDatabase::get_detector_table()
 		detector_tmp.detector_effective_time = detector_table_.DetectorList[i].DetectorDelay;
 		detector_tmp.detector_failure_time = detector_table_.DetectorList[i].DetectorSpecFunc >> 2;
 
-        index = detector_list.indexOf(detector_tmp);
+        index = first_of_id[detector_tmp.detector_id];
+        while (index != -1 && !(detector_list[index] == detector_tmp))
+        {
+            index++;
+            if (index >= detector_list.size() || detector_list.at(index).detector_id != detector_tmp.detector_id)
+            {
+                index = -1;
+            }
+        }
         if (index != -1)
         {
             detector_list[index].detector_phase_ids |= (0x01 << (detector_table_.DetectorList[i].DetectorPhase - 1));
@@ -625,7 +752,7 @@ QList<DetectorParam> MDatabase::get_detector_table()
     return detector_list;
 }
 
-QList<PhaseConflictParam> MDatabase::get_phase_conflict_table()
+QList<PhaseConflictParam> MDatabase::get_phase_conflict_table() const
 {
     QList<PhaseConflictParam> conflict_list;
     for (int i = 0; i < phase_conflict_table_.FactPhaseErrorNum; i++)
@@ -663,6 +790,8 @@ MDatabase::MDatabase()
     memset(&channel_table_, 0x00, sizeof(channel_table_));
     memset(&channel_hint_table_, 0x00, sizeof(channel_hint_table_));
     memset(&detector_table_, 0x00, sizeof(detector_table_));
+    version_ = 0;
+    rebuild_index();
 }
 
 MDatabase::~MDatabase()
@@ -678,7 +807,7 @@ MDatabase *MDatabase::GetInstance()
     return instance_;
 }
 
-QList<unsigned char> MDatabase::get_id_list_by_bits_op(unsigned int phase_ids)
+QList<unsigned char> MDatabase::get_id_list_by_bits_op(unsigned int phase_ids) const
 {
     QList<unsigned char> phase_id_list;
     for (unsigned char i = 1; i <= 32; i++)
@@ -708,13 +837,14 @@ bool MDatabase::detector_less_than( const DetectorParam &left, const DetectorPar
 	}
 }
 
-void MDatabase::init_channel_ctrl_src_phase()
+QMultiMap<unsigned char, unsigned char> MDatabase::get_channel_ctrl_src_map() const
 {
-	channel_phase_read_map_.clear();
+	QMultiMap<unsigned char, unsigned char> channel_phase_read_map;
 	for (int i = 0; i < channel_table_.FactChannelNum; i++)
 	{
-		channel_phase_read_map_.insertMulti(channel_table_.ChannelList[i].ChannelId, channel_table_.ChannelList[i].ChannelCtrlSrc);
+		channel_phase_read_map.insertMulti(channel_table_.ChannelList[i].ChannelId, channel_table_.ChannelList[i].ChannelCtrlSrc);
 	}
+	return channel_phase_read_map;
 }
 
 bool MDatabase::channel_less_than( const ChannelParam &left, const ChannelParam &right )
@@ -733,18 +863,9 @@ bool MDatabase::channel_less_than( const ChannelParam &left, const ChannelParam
 	}
 }
 
-int MDatabase::index_of_channel_hint_table( unsigned char channel_id )
+int MDatabase::index_of_channel_hint_table( unsigned char channel_id ) const
 {
-	int index = -1;
-	for (int i = 0; i < channel_hint_table_.FactChannelHintNum; i++)
-	{
-		if (channel_hint_table_.ChannelHintList[i].ChannelId == channel_id)
-		{
-			index = i;
-			return index;
-		}
-	}
-	return index;
+	return channel_hint_index_[channel_id];
 }
 
 bool MDatabase::phasetiming_less_than( const PhaseTiming &left, const PhaseTiming &right )
@@ -779,7 +900,7 @@ bool MDatabase::timesection_less_than( const TimeSection &left, const TimeSectio
 	}
 }
 
-unsigned char MDatabase::get_phasetiming_phase_id( unsigned int phase_id_bits )
+unsigned char MDatabase::get_phasetiming_phase_id( unsigned int phase_id_bits ) const
 {
 	for (int i = 1; i <= 32; i++)
 	{
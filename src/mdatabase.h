@@ -76,22 +76,46 @@ public:
     ChannelHint_t &get_channel_hint();
     Detector_t &get_detector();
 
-    QList<ScheduleParam> get_schedule_table();
-    QList<TimeSection> get_timesection_table();
-    QList<TimingParam> get_timing_table();
-    QList<PhaseTiming> get_timeconfig_table();
-    QList<PhaseParam> get_phase_table();
-    QList<ChannelParam> get_channel_table();
-    QList<DetectorParam> get_detector_table();
-    QList<PhaseConflictParam> get_phase_conflict_table();
+    // for readers of a published snapshot, see DatabaseStore
+    const TSCHeader_t &get_tsc_header() const;
+    const Unit_t &get_unit_table() const;
+    const Schedule_t &get_schedule() const;
+    const TimeSection_t &get_timesection() const;
+    const Pattern_t &get_timingplan() const;
+    const TimeConfig_t &get_timeconfig() const;
+    const Phase_t &get_phase() const;
+    const PhaseError_t &get_phase_err() const;
+    const Channel_t &get_channel() const;
+    const ChannelHint_t &get_channel_hint() const;
+    const Detector_t &get_detector() const;
+
+    QList<ScheduleParam> get_schedule_table() const;
+    QList<TimeSection> get_timesection_table() const;
+    QList<TimingParam> get_timing_table() const;
+    QList<PhaseTiming> get_timeconfig_table() const;
+    QList<PhaseParam> get_phase_table() const;
+    QList<ChannelParam> get_channel_table() const;
+    QList<DetectorParam> get_detector_table() const;
+    QList<PhaseConflictParam> get_phase_conflict_table() const;
 
 //    SignalerMap &get_signaler_map();
 
+    quint64 get_version() const;
+    void set_version(quint64 version);
+
+    // O(1) id lookups; the setters keep them current, call rebuild_index()
+    // after writing tables through the reference getters
+    void rebuild_index();
+    int index_of_phase(unsigned char phase_id) const;
+    unsigned char get_phase_type(unsigned char phase_id) const;
+    // lowest channel whose control source is phase_id, 0 when there is none
+    unsigned char get_phase_channel_id(unsigned char phase_id) const;
+
 
 private:
-	unsigned char get_phasetiming_phase_id(unsigned int phase_id_bits);
-    QList<unsigned char> get_id_list_by_bits_op(unsigned int phase_ids);
-	int index_of_channel_hint_table(unsigned char channel_id);
+	unsigned char get_phasetiming_phase_id(unsigned int phase_id_bits) const;
+    QList<unsigned char> get_id_list_by_bits_op(unsigned int phase_ids) const;
+	int index_of_channel_hint_table(unsigned char channel_id) const;
 	static bool phasetiming_less_than(const PhaseTiming &left, const PhaseTiming &right);
 	static bool timesection_less_than(const TimeSection &left, const TimeSection &right);
 	static bool channel_less_than(const ChannelParam &left, const ChannelParam &right);
@@ -119,8 +143,15 @@ private:
     QMap<unsigned char, unsigned short> cycle_time_map_;
     QMultiMap<unsigned char, unsigned char> channel_phase_map_; // for write to file
 
-    QMultiMap<unsigned char, unsigned char> channel_phase_read_map_;    // for read from file
-	void init_channel_ctrl_src_phase();
+    quint64 version_;   // set when published
+
+    // dense indexes by id (ids are unsigned char), -1 / 0 when absent
+    short phase_index_[256];                    // phase id -> PhaseList row
+    short channel_hint_index_[256];             // channel id -> ChannelHintList row
+    unsigned char phase_channel_index_[256];    // phase id -> lowest channel it controls
+
+    // channel id -> ctrl src phase, for read from file
+	QMultiMap<unsigned char, unsigned char> get_channel_ctrl_src_map() const;
 
 };
 
@@ -0,0 +1,229 @@
+#include <QCoreApplication>
+#include <QStringList>
+#include <QTimer>
+#include <QFile>
+#include <QList>
+
+#include "mockcontroller.h"
+#include "signalplan.h"
+#include "filereaderwriter.h"
+#include "compactconfig.h"
+#include "tscparam.h"
+#include "simulatorcore.h"
+
+#include <stdio.h>
+
+/* Stand-in signaler for load tests.
+ * usage: MockSignaler [-n controllers] [-p base_port] [-l lamp_hz] [-d countdown_hz]
+ *                     [-m ctrl_mode] [-t run_secs] config.dat
+ * Controller i listens on base_port + i and runs the plan of config.dat
+ * shifted by its own offset into the cycle. Monitoring clients get CYT3 and
+ * the CYT1 changes lamp_hz times a second, CYT5 countdown_hz times a second
+ * and CYT7 once a minute. Thousands of controllers need a matching open file limit.
+*/
+
+#define DEFAULT_BASE_PORT       5000
+#define DEFAULT_LAMP_HZ         1
+#define DEFAULT_COUNTDOWN_HZ    1
+#define TIME_PUSH_MS            (60*1000)
+#define STATS_MS                (5*1000)
+
+static void usage()
+{
+    fprintf(stderr, "usage: MockSignaler [-n controllers] [-p base_port] [-l lamp_hz] [-d countdown_hz]"
+                    " [-m ctrl_mode] [-t run_secs] config.dat\n");
+}
+
+class MockPool : public QObject
+{
+    Q_OBJECT
+public:
+    explicit MockPool(QObject *parent = 0) :
+        QObject(parent), last_bytes_(0)
+    {}
+
+    QList<MockController *> controller_list_;
+
+public slots:
+    void lampSlot()
+    {
+        for (int i = 0; i < controller_list_.size(); i++)
+        {
+            controller_list_.at(i)->pushLightStatus();
+        }
+    }
+
+    void countDownSlot()
+    {
+        for (int i = 0; i < controller_list_.size(); i++)
+        {
+            controller_list_.at(i)->pushCountDown();
+        }
+    }
+
+    void timeSlot()
+    {
+        for (int i = 0; i < controller_list_.size(); i++)
+        {
+            controller_list_.at(i)->pushTime();
+        }
+    }
+
+    void statsSlot()
+    {
+        int clients = 0, monitors = 0;
+        qint64 bytes = 0;
+        for (int i = 0; i < controller_list_.size(); i++)
+        {
+            clients += controller_list_.at(i)->clientCount();
+            monitors += controller_list_.at(i)->monitorCount();
+            bytes += controller_list_.at(i)->sentBytes();
+        }
+        fprintf(stdout, "controllers %d clients %d monitoring %d sent %.1f KB/s\n",
+                controller_list_.size(), clients, monitors, (bytes - last_bytes_) / 1024.0 / (STATS_MS / 1000));
+        fflush(stdout);
+        last_bytes_ = bytes;
+    }
+
+private:
+    qint64 last_bytes_;
+};
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QStringList args = app.arguments();
+    args.removeFirst();
+
+    int count = 1;
+    int base_port = DEFAULT_BASE_PORT;
+    double lamp_hz = DEFAULT_LAMP_HZ;
+    double countdown_hz = DEFAULT_COUNTDOWN_HZ;
+    unsigned char ctrl_mode = SimulatorCore::FullInduction;
+    int run_secs = 0;
+    QString cfg_path;
+    for (int i = 0; i < args.size(); i++)
+    {
+        const QString &arg = args.at(i);
+        if (arg.startsWith("-") && i + 1 >= args.size())
+        {
+            usage();
+            return 1;
+        }
+        if (arg == "-n")
+        {
+            count = args.at(++i).toInt();
+        }
+        else if (arg == "-p")
+        {
+            base_port = args.at(++i).toInt();
+        }
+        else if (arg == "-l")
+        {
+            lamp_hz = args.at(++i).toDouble();
+        }
+        else if (arg == "-d")
+        {
+            countdown_hz = args.at(++i).toDouble();
+        }
+        else if (arg == "-m")
+        {
+            ctrl_mode = args.at(++i).toUInt();
+        }
+        else if (arg == "-t")
+        {
+            run_secs = args.at(++i).toInt();
+        }
+        else
+        {
+            cfg_path = arg;
+        }
+    }
+    if (cfg_path.isEmpty() || count <= 0 || base_port <= 0 || base_port + count > 65536)
+    {
+        usage();
+        return 1;
+    }
+
+    TSCParam *param = new TSCParam;
+    FileReaderWriter reader;
+    if (!reader.ReadFile(cfg_path.toLocal8Bit().constData(), *param))
+    {
+        fprintf(stderr, "open config %s failed\n", qPrintable(cfg_path));
+        delete param;
+        return 1;
+    }
+    SignalPlan plan;
+    plan.load(*param);
+    delete param;
+
+    QFile file(cfg_path);
+    if (!file.open(QIODevice::ReadOnly))
+    {
+        fprintf(stderr, "open config %s failed\n", qPrintable(cfg_path));
+        return 1;
+    }
+    QByteArray content = file.readAll();
+    file.close();
+    // a controller sends the legacy image, never the compact form
+    if (CompactConfig::isCompact(content.constData(), content.size()))
+    {
+        QByteArray image;
+        QString error;
+        if (!CompactConfig::decode(content.constData(), content.size(), image, &error))
+        {
+            fprintf(stderr, "config %s: %s\n", qPrintable(cfg_path), qPrintable(error));
+            return 1;
+        }
+        content = image;
+    }
+    QByteArray config_message;
+    SignalPlan::configMessage(content, config_message);
+
+    MockPool pool;
+    for (int i = 0; i < count; i++)
+    {
+        // spread the controllers over the cycle
+        int offset = (int)((qint64)i * plan.cycleSecs() / count);
+        MockController *controller = new MockController(&plan, &config_message, offset, &pool);
+        controller->setCtrlMode(ctrl_mode);
+        if (!controller->listen(base_port + i))
+        {
+            fprintf(stderr, "listen on port %d failed\n", base_port + i);
+            delete controller;
+            continue;
+        }
+        pool.controller_list_.append(controller);
+    }
+    if (pool.controller_list_.isEmpty())
+    {
+        return 1;
+    }
+    fprintf(stdout, "%d controllers on ports %d-%d, %d stages, cycle %d s\n", pool.controller_list_.size(),
+            base_port, base_port + count - 1, plan.stageCount(), plan.cycleSecs());
+
+    QTimer lamp_timer, countdown_timer, time_timer, stats_timer;
+    lamp_timer.setTimerType(Qt::PreciseTimer);
+    countdown_timer.setTimerType(Qt::PreciseTimer);
+    QObject::connect(&lamp_timer, SIGNAL(timeout()), &pool, SLOT(lampSlot()));
+    QObject::connect(&countdown_timer, SIGNAL(timeout()), &pool, SLOT(countDownSlot()));
+    QObject::connect(&time_timer, SIGNAL(timeout()), &pool, SLOT(timeSlot()));
+    QObject::connect(&stats_timer, SIGNAL(timeout()), &pool, SLOT(statsSlot()));
+    if (lamp_hz > 0)
+    {
+        lamp_timer.start(qMax(1, (int)(1000 / lamp_hz)));
+    }
+    if (countdown_hz > 0)
+    {
+        countdown_timer.start(qMax(1, (int)(1000 / countdown_hz)));
+    }
+    time_timer.start(TIME_PUSH_MS);
+    stats_timer.start(STATS_MS);
+    if (run_secs > 0)
+    {
+        QTimer::singleShot(run_secs * 1000, &app, SLOT(quit()));
+    }
+    return app.exec();
+}
+
+#include "main.moc"
@@ -0,0 +1,296 @@
+#include "mockcontroller.h"
+#include "frameclock.h"
+#include "simulatorcore.h"
+
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QDateTime>
+#include <string.h>
+
+#define VERSION_REPLY       "CYT0V100END"
+#define CHINA_TIME_OFFSET   (8*60*60)       // the signaler clock runs on local time
+
+enum MockCommand
+{
+    CmdGetVerId = 0,
+    CmdGetConfigure,
+    CmdBeginMonitor,
+    CmdEndMonitor,
+    CmdGetLampStatus,
+    CmdGetTSCTime,
+    CmdGetDetectInfo,
+    CmdGetDriverInfo,
+    CmdOther
+};
+
+// requests are bare names without a delimiter, none is a prefix of another
+static const struct
+{
+    const char *name;
+    int command;
+} command_list[] =
+{
+    {"GetVerId", CmdGetVerId},
+    {"GetConfigure", CmdGetConfigure},
+    {"BeginMonitor", CmdBeginMonitor},
+    {"EndMonitor", CmdEndMonitor},
+    {"GetLampStatus", CmdGetLampStatus},
+    {"GetTSCTime", CmdGetTSCTime},
+    {"GetDetectInfo", CmdGetDetectInfo},
+    {"GetDriveBoardInfo", CmdGetDriverInfo},
+    {"GetEventInfo", CmdOther},
+    {"GetNetAddress", CmdOther},
+    {"ClearDetectInfo", CmdOther},
+    {"SetConfigure", CmdOther}
+};
+
+MockController::MockController(const SignalPlan *plan, const QByteArray *config_message, int offset_secs, QObject *parent) :
+    QObject(parent)
+{
+    plan_ = plan;
+    config_message_ = config_message;
+    offset_secs_ = offset_secs;
+    ctrl_mode_ = SimulatorCore::FullInduction;
+    monitor_count_ = 0;
+    sent_bytes_ = 0;
+    memset(channel_color_, SignalPlan::Off, sizeof(channel_color_));
+
+    server_ = new QTcpServer(this);
+    connect(server_, SIGNAL(newConnection()), this, SLOT(newConnectionSlot()));
+}
+
+bool MockController::listen(quint16 port)
+{
+    return server_->listen(QHostAddress::Any, port);
+}
+
+quint16 MockController::port() const
+{
+    return server_->serverPort();
+}
+
+void MockController::setCtrlMode(unsigned char ctrl_mode)
+{
+    ctrl_mode_ = ctrl_mode;
+}
+
+int MockController::clientCount() const
+{
+    return client_map_.size();
+}
+
+int MockController::monitorCount() const
+{
+    return monitor_count_;
+}
+
+qint64 MockController::sentBytes() const
+{
+    return sent_bytes_;
+}
+
+void MockController::pushLightStatus()
+{
+    if (monitor_count_ == 0)
+    {
+        return;
+    }
+    SignalPlan::State state = currentState();
+    for (int i = 0; i < PLAN_CHANNEL_COUNT; i++)
+    {
+        unsigned char color = plan_->channelColor(state, i);
+        if (color != channel_color_[i])
+        {
+            channel_color_[i] = color;
+            SignalPlan::beginMonitorMessage(i + 1, color, message_);
+            broadcast(message_);
+        }
+    }
+    plan_->lightStatusMessage(state, ctrl_mode_, message_);
+    broadcast(message_);
+}
+
+void MockController::pushCountDown()
+{
+    if (monitor_count_ == 0)
+    {
+        return;
+    }
+    plan_->countDownMessage(currentState(), ctrl_mode_, message_);
+    broadcast(message_);
+}
+
+void MockController::pushTime()
+{
+    if (monitor_count_ == 0)
+    {
+        return;
+    }
+    SignalPlan::tscTimeMessage(tscSeconds(), message_);
+    broadcast(message_);
+}
+
+void MockController::newConnectionSlot()
+{
+    while (server_->hasPendingConnections())
+    {
+        QTcpSocket *socket = server_->nextPendingConnection();
+        Client client;
+        client.monitoring = false;
+        client_map_.insert(socket, client);
+        connect(socket, SIGNAL(readyRead()), this, SLOT(readyReadSlot()));
+        connect(socket, SIGNAL(disconnected()), this, SLOT(disconnectedSlot()));
+    }
+}
+
+void MockController::readyReadSlot()
+{
+    QTcpSocket *socket = qobject_cast<QTcpSocket *>(sender());
+    if (socket == NULL || !client_map_.contains(socket))
+    {
+        return;
+    }
+    Client &client = client_map_[socket];
+    client.rx.append(socket->readAll());
+    parseCommands(socket, client);
+}
+
+void MockController::disconnectedSlot()
+{
+    QTcpSocket *socket = qobject_cast<QTcpSocket *>(sender());
+    if (socket == NULL)
+    {
+        return;
+    }
+    if (client_map_.value(socket).monitoring)
+    {
+        monitor_count_--;
+    }
+    client_map_.remove(socket);
+    socket->deleteLater();
+}
+
+SignalPlan::State MockController::currentState() const
+{
+    return plan_->state(FrameClock::msecs() / 1000 + offset_secs_);
+}
+
+void MockController::parseCommands(QTcpSocket *socket, Client &client)
+{
+    int pos = 0;
+    const int count = sizeof(command_list) / sizeof(command_list[0]);
+    while (pos < client.rx.size())
+    {
+        const char *data = client.rx.constData() + pos;
+        int len = client.rx.size() - pos;
+        // CYT7 time sync and CYT8 network settings are accepted and ignored
+        if (len >= 3 && memcmp(data, "CYT", 3) == 0)
+        {
+            int end = (len >= 4 && data[3] == '7') ? 11 : client.rx.indexOf("END", pos + 3) + 3 - pos;
+            if (end < 3 || end > len)
+            {
+                break;
+            }
+            pos += end;
+            continue;
+        }
+        bool matched = false;
+        bool partial = false;
+        for (int i = 0; i < count; i++)
+        {
+            int name_len = (int)strlen(command_list[i].name);
+            if (memcmp(data, command_list[i].name, qMin(len, name_len)) != 0)
+            {
+                continue;
+            }
+            if (len < name_len)
+            {
+                partial = true;
+                continue;
+            }
+            pos += name_len;
+            handleCommand(socket, client, command_list[i].command);
+            matched = true;
+            break;
+        }
+        if (matched)
+        {
+            continue;
+        }
+        if (partial || (len < 3 && memcmp(data, "CYT", len) == 0))
+        {
+            break;
+        }
+        pos++;      // garbage
+    }
+    client.rx.remove(0, pos);
+}
+
+void MockController::handleCommand(QTcpSocket *socket, Client &client, int command)
+{
+    switch (command)
+    {
+    case CmdGetVerId:
+        send(socket, QByteArray(VERSION_REPLY));
+        break;
+    case CmdGetConfigure:
+        send(socket, *config_message_);
+        break;
+    case CmdBeginMonitor:
+        if (!client.monitoring)
+        {
+            client.monitoring = true;
+            monitor_count_++;
+        }
+        break;
+    case CmdEndMonitor:
+        if (client.monitoring)
+        {
+            client.monitoring = false;
+            monitor_count_--;
+        }
+        break;
+    case CmdGetLampStatus:
+        plan_->lightStatusMessage(currentState(), ctrl_mode_, message_);
+        send(socket, message_);
+        break;
+    case CmdGetTSCTime:
+        SignalPlan::tscTimeMessage(tscSeconds(), message_);
+        send(socket, message_);
+        break;
+    case CmdGetDetectInfo:
+        send(socket, QByteArray("DETECTDATAER"));
+        break;
+    case CmdGetDriverInfo:
+        send(socket, QByteArray("DRIVEINFOER"));
+        break;
+    default:
+        break;
+    }
+}
+
+void MockController::send(QTcpSocket *socket, const QByteArray &message)
+{
+    qint64 sz = socket->write(message);
+    if (sz > 0)
+    {
+        sent_bytes_ += sz;
+    }
+}
+
+void MockController::broadcast(const QByteArray &message)
+{
+    QHash<QTcpSocket *, Client>::const_iterator it = client_map_.constBegin();
+    for (; it != client_map_.constEnd(); ++it)
+    {
+        if (it.value().monitoring)
+        {
+            send(it.key(), message);
+        }
+    }
+}
+
+unsigned int MockController::tscSeconds()
+{
+    return QDateTime::currentDateTimeUtc().toTime_t() + CHINA_TIME_OFFSET;
+}
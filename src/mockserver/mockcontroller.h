@@ -0,0 +1,70 @@
+#ifndef MOCKCONTROLLER_H
+#define MOCKCONTROLLER_H
+
+#include <QObject>
+#include <QHash>
+#include <QByteArray>
+#include "signalplan.h"
+
+class QTcpServer;
+class QTcpSocket;
+
+/* One simulated signaler on its own port.
+ * Answers GetVerId, GetConfigure, GetLampStatus and GetTSCTime like the
+ * real controller; clients that sent BeginMonitor get the CYT1/3/5/7
+ * pushes. The signal plan and config are shared, a controller only adds
+ * its own offset into the cycle.
+*/
+class MockController : public QObject
+{
+    Q_OBJECT
+public:
+    MockController(const SignalPlan *plan, const QByteArray *config_message, int offset_secs, QObject *parent = 0);
+
+    bool listen(quint16 port);
+    quint16 port() const;
+    void setCtrlMode(unsigned char ctrl_mode);
+
+    int clientCount() const;
+    int monitorCount() const;
+    qint64 sentBytes() const;
+
+    void pushLightStatus();     // CYT3, and CYT1 for every channel that changed
+    void pushCountDown();       // CYT5
+    void pushTime();            // CYT7
+
+private slots:
+    void newConnectionSlot();
+    void readyReadSlot();
+    void disconnectedSlot();
+
+private:
+    typedef struct ClientTag
+    {
+        QByteArray rx;
+        bool monitoring;
+    }Client;
+
+    SignalPlan::State currentState() const;
+    void parseCommands(QTcpSocket *socket, Client &client);
+    void handleCommand(QTcpSocket *socket, Client &client, int command);
+    void send(QTcpSocket *socket, const QByteArray &message);
+    void broadcast(const QByteArray &message);
+    static unsigned int tscSeconds();
+
+private:
+    const SignalPlan *plan_;
+    const QByteArray *config_message_;
+    int offset_secs_;
+    unsigned char ctrl_mode_;
+
+    QTcpServer *server_;
+    QHash<QTcpSocket *, Client> client_map_;
+    int monitor_count_;
+    qint64 sent_bytes_;
+
+    unsigned char channel_color_[PLAN_CHANNEL_COUNT];   // last pushed, for CYT1
+    QByteArray message_;
+};
+
+#endif // MOCKCONTROLLER_H
@@ -0,0 +1,19 @@
+# stand-in signaler for load tests of the monitor side, qmake && make && ./MockSignaler
+# serves one config to any number of simulated controllers on consecutive ports.
+
+QT += network
+QT -= gui
+CONFIG += console
+CONFIG -= app_bundle
+TARGET = MockSignaler
+
+include(../simulatorcore.pri)
+
+SOURCES += \
+    main.cpp \
+    signalplan.cpp \
+    mockcontroller.cpp
+
+HEADERS += \
+    signalplan.h \
+    mockcontroller.h
@@ -0,0 +1,208 @@
+#include "signalplan.h"
+#include "tscparam.h"
+
+#include <string.h>
+
+SignalPlan::SignalPlan()
+{
+    cycle_secs_ = 0;
+    memset(channel_phase_list_, 0, sizeof(channel_phase_list_));
+}
+
+void SignalPlan::load(const TSCParam &param)
+{
+    stage_list_.clear();
+    const TimeConfig_t &tc = param.stage_timing_table_;
+    for (int i = 0; i < tc.FactStageNum && i < MAX_STAGE_LINE; i++)
+    {
+        const TimeConfigList_t &item = tc.TimeConfigList[0][i];
+        if (item.PhaseId == 0)
+        {
+            continue;
+        }
+        Stage stage;
+        stage.phase_ids = item.PhaseId;
+        stage.green = qMax(1, (int)item.GreenTime);
+        stage.yellow = item.YellowTime;
+        stage.red = item.RedTime;
+        stage_list_.append(stage);
+    }
+    if (stage_list_.isEmpty())
+    {
+        for (int i = 0; i < param.phase_table_.FactPhaseNum && i < MAX_PHASE_LINE; i++)
+        {
+            unsigned char phase_id = param.phase_table_.PhaseList[i].PhaseId;
+            if (phase_id == 0 || phase_id > 32)
+            {
+                continue;
+            }
+            Stage stage;
+            stage.phase_ids = 0x01 << (phase_id - 1);
+            stage.green = PLAN_DEFAULT_GREEN;
+            stage.yellow = PLAN_DEFAULT_YELLOW;
+            stage.red = PLAN_DEFAULT_RED;
+            stage_list_.append(stage);
+        }
+    }
+    if (stage_list_.isEmpty())
+    {
+        Stage stage;
+        stage.phase_ids = 0x01;
+        stage.green = PLAN_DEFAULT_GREEN;
+        stage.yellow = PLAN_DEFAULT_YELLOW;
+        stage.red = PLAN_DEFAULT_RED;
+        stage_list_.append(stage);
+    }
+
+    cycle_secs_ = 0;
+    for (int i = 0; i < stage_list_.size(); i++)
+    {
+        cycle_secs_ += stage_list_.at(i).green + stage_list_.at(i).yellow + stage_list_.at(i).red;
+    }
+
+    memset(channel_phase_list_, 0, sizeof(channel_phase_list_));
+    for (int i = 0; i < param.channel_table_.FactChannelNum && i < MAX_CHANNEL_LINE; i++)
+    {
+        const ChannelList_t &ch = param.channel_table_.ChannelList[i];
+        if (ch.ChannelId == 0 || ch.ChannelId > PLAN_CHANNEL_COUNT || ch.ChannelCtrlSrc == 0 || ch.ChannelCtrlSrc > 32)
+        {
+            continue;
+        }
+        channel_phase_list_[ch.ChannelId - 1] = 0x01 << (ch.ChannelCtrlSrc - 1);
+    }
+}
+
+int SignalPlan::stageCount() const
+{
+    return stage_list_.size();
+}
+
+int SignalPlan::cycleSecs() const
+{
+    return cycle_secs_;
+}
+
+SignalPlan::State SignalPlan::state(qint64 secs) const
+{
+    State st;
+    int t = (int)(secs % cycle_secs_);
+    for (int i = 0; i < stage_list_.size(); i++)
+    {
+        const Stage &stage = stage_list_.at(i);
+        st.stage_id = i + 1;
+        st.phase_ids = stage.phase_ids;
+        if (t < stage.green)
+        {
+            st.color = Green;
+            st.remain = stage.green - t;
+            return st;
+        }
+        t -= stage.green;
+        if (t < stage.yellow)
+        {
+            st.color = Yellow;
+            st.remain = stage.yellow - t;
+            return st;
+        }
+        t -= stage.yellow;
+        if (t < stage.red)
+        {
+            st.color = Red;
+            st.remain = stage.red - t;
+            return st;
+        }
+        t -= stage.red;
+    }
+    return st;
+}
+
+unsigned char SignalPlan::channelColor(const State &state, int channel_idx) const
+{
+    unsigned int bit = channel_phase_list_[channel_idx];
+    if (bit == 0)
+    {
+        return Off;
+    }
+    if ((state.phase_ids & bit) == 0)
+    {
+        return Red;
+    }
+    return state.color;
+}
+
+// count, then per group of eight channels a separator and the r/y/g bits, then mode, stage and phases
+void SignalPlan::lightStatusMessage(const State &state, unsigned char ctrl_mode, QByteArray &message) const
+{
+    const int group_count = CytDecoder::MaxLightGroups;
+    message.resize(CytParser::HeadSize + CytDecoder::lightStatusSize("4", 1) + CytParser::TailSize);
+    char *p = message.data();
+    memcpy(p, "CYT3", CytParser::HeadSize);
+    p += CytParser::HeadSize;
+    *p++ = '0' + group_count;
+    for (int i = 0; i < group_count; i++)
+    {
+        unsigned char bits[3] = {0, 0, 0};
+        for (int j = 0; j < 8; j++)
+        {
+            unsigned char color = channelColor(state, i*8 + j);
+            if (color <= Green)
+            {
+                bits[color] |= (0x01 << j);
+            }
+        }
+        *p++ = ',';
+        *p++ = bits[Red];
+        *p++ = bits[Yellow];
+        *p++ = bits[Green];
+    }
+    *p++ = ctrl_mode;
+    *p++ = state.stage_id;
+    memcpy(p, &state.phase_ids, 4);
+    p += 4;
+    memcpy(p, "END", CytParser::TailSize);
+}
+
+void SignalPlan::countDownMessage(const State &state, unsigned char ctrl_mode, QByteArray &message) const
+{
+    CountDownInfo info;
+    info.ctrl_mode = ctrl_mode;
+    info.stage_id = state.stage_id;
+    info.light_corlor = state.color;
+    info.light_time = state.remain;
+    info.phase_ids = state.phase_ids;
+    message.resize(CytParser::HeadSize + sizeof(info) + CytParser::TailSize);
+    memcpy(message.data(), "CYT5", CytParser::HeadSize);
+    memcpy(message.data() + CytParser::HeadSize, &info, sizeof(info));
+    memcpy(message.data() + CytParser::HeadSize + sizeof(info), "END", CytParser::TailSize);
+}
+
+void SignalPlan::beginMonitorMessage(unsigned char channel_id, unsigned char color, QByteArray &message)
+{
+    BeginMonitorInfo info;
+    info.channel_id = channel_id;
+    info.status = color;
+    message.resize(CytParser::HeadSize + sizeof(info) + CytParser::TailSize);
+    memcpy(message.data(), "CYT1", CytParser::HeadSize);
+    memcpy(message.data() + CytParser::HeadSize, &info, sizeof(info));
+    memcpy(message.data() + CytParser::HeadSize + sizeof(info), "END", CytParser::TailSize);
+}
+
+void SignalPlan::tscTimeMessage(unsigned int seconds, QByteArray &message)
+{
+    message.resize(CytParser::HeadSize + 4 + CytParser::TailSize);
+    memcpy(message.data(), "CYT7", CytParser::HeadSize);
+    memcpy(message.data() + CytParser::HeadSize, &seconds, 4);
+    memcpy(message.data() + CytParser::HeadSize + 4, "END", CytParser::TailSize);
+}
+
+// the length field counts the whole message
+void SignalPlan::configMessage(const QByteArray &content, QByteArray &message)
+{
+    unsigned int len = CytParser::HeadSize + CytDecoder::ConfigLengthSize + content.size() + CytParser::TailSize;
+    message.resize(len);
+    char *p = message.data();
+    memcpy(p, "CYT4", CytParser::HeadSize);
+    memcpy(p + CytParser::HeadSize, &len, CytDecoder::ConfigLengthSize);
+    memcpy(p + CytParser::HeadSize + CytDecoder::ConfigLengthSize, content.constData(), content.size());
+    memcpy(p + len - CytParser::TailSize, "END", CytParser::TailSize);
+}
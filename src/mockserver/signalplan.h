@@ -0,0 +1,69 @@
+#ifndef SIGNALPLAN_H
+#define SIGNALPLAN_H
+
+#include <QList>
+#include <QByteArray>
+#include "cytdecoder.h"
+
+class TSCParam;
+
+#define PLAN_CHANNEL_COUNT      32      // channels a CYT3 message can carry
+#define PLAN_DEFAULT_GREEN      20
+#define PLAN_DEFAULT_YELLOW     3
+#define PLAN_DEFAULT_RED        2
+
+/* Fixed time cycle of one config, the first time config of the stage
+ * timing table or, without one, every phase in turn with default times.
+ * The state at any second of the cycle is computed, so any number of
+ * controllers can share a plan and only keep their own cycle offset.
+*/
+class SignalPlan
+{
+public:
+    SignalPlan();
+
+    enum LightColor
+    {
+        Red = 0,
+        Yellow,
+        Green,
+        Off
+    };
+
+    typedef struct StageTag
+    {
+        unsigned int phase_ids;
+        int green;
+        int yellow;
+        int red;
+    }Stage;
+
+    typedef struct StateTag
+    {
+        unsigned char stage_id;     // 1 based
+        unsigned int phase_ids;
+        unsigned char color;        // of the running stage
+        unsigned char remain;       // seconds left in color
+    }State;
+
+    void load(const TSCParam &param);
+    int stageCount() const;
+    int cycleSecs() const;
+
+    State state(qint64 secs) const;
+    unsigned char channelColor(const State &state, int channel_idx) const;
+
+    // complete CYT messages
+    void lightStatusMessage(const State &state, unsigned char ctrl_mode, QByteArray &message) const;
+    void countDownMessage(const State &state, unsigned char ctrl_mode, QByteArray &message) const;
+    static void beginMonitorMessage(unsigned char channel_id, unsigned char color, QByteArray &message);
+    static void tscTimeMessage(unsigned int seconds, QByteArray &message);
+    static void configMessage(const QByteArray &content, QByteArray &message);
+
+private:
+    QList<Stage> stage_list_;
+    unsigned int channel_phase_list_[PLAN_CHANNEL_COUNT];   // phase bit of each channel, 0 unused
+    int cycle_secs_;
+};
+
+#endif // SIGNALPLAN_H
@@ -0,0 +1,198 @@
+#include <QCoreApplication>
+#include <QStringList>
+#include <QTimer>
+#include <QSet>
+
+#include "sessionmanager.h"
+#include "synccommand.h"
+#include "configcache.h"
+#include "mdatabase.h"
+
+#include <stdio.h>
+
+/* Headless monitor of many signalers.
+ * usage: SimulatorMonitor [-n controllers] [-p base_port] [-j threads] [-a max_age]
+ *                         [-c cache_dir] [-t run_secs] host
+ * Controller i is host:base_port + i, all sessions share one SessionManager
+ * and its worker threads. Every session downloads its config, then monitors
+ * the pushes. With -c the configs are cached, and with -a a cached config
+ * confirmed less than max_age s ago is used without downloading it.
+ * -j 0 keeps the sessions in the main thread. For a load test start
+ * MockSignaler with the same -n and -p.
+*/
+
+#define DEFAULT_BASE_PORT       5000
+#define STATS_MS                (5*1000)
+
+static void usage()
+{
+    fprintf(stderr, "usage: SimulatorMonitor [-n controllers] [-p base_port] [-j threads] [-a max_age]"
+                    " [-c cache_dir] [-t run_secs] host\n");
+}
+
+class MonitorPool : public QObject
+{
+    Q_OBJECT
+public:
+    MonitorPool(SessionManager *manager, int max_age, QObject *parent = 0) :
+        QObject(parent), manager_(manager), max_age_(max_age),
+        configs_(0), cached_(0), failures_(0), messages_(0), bytes_(0), last_bytes_(0)
+    {}
+
+public slots:
+    void connectedSlot(SyncCommand *session)
+    {
+        connected_.insert(session);
+        if (manager_->isConfigFresh(session, max_age_))
+        {
+            cached_++;
+            manager_->monitor(session);
+            return;
+        }
+        manager_->requestConfig(session);
+    }
+
+    void disconnectedSlot(SyncCommand *session)
+    {
+        connected_.remove(session);
+    }
+
+    void configReceivedSlot(SyncCommand *session)
+    {
+        configs_++;
+        if (manager_->database(session)->get_phase_table().isEmpty())
+        {
+            fprintf(stderr, "%s:%u config without phases\n",
+                    qPrintable(session->getSocketIp()), session->getSocketPort());
+        }
+        manager_->monitor(session);
+    }
+
+    // monitored without a config rather than asked again and again
+    void configFailedSlot(SyncCommand *session, const QString &error)
+    {
+        failures_++;
+        fprintf(stderr, "%s:%u config failed: %s\n",
+                qPrintable(session->getSocketIp()), session->getSocketPort(), qPrintable(error));
+        manager_->monitor(session);
+    }
+
+    void messageSlot(SyncCommand *session, const QByteArray &message)
+    {
+        Q_UNUSED(session);
+        messages_++;
+        bytes_ += message.size();
+    }
+
+    void statsSlot()
+    {
+        fprintf(stdout, "sessions %d connected %d configs %lld cached %lld failed %lld messages %lld received %.1f KB/s\n",
+                manager_->sessionCount(), connected_.size(), configs_, cached_, failures_, messages_,
+                (bytes_ - last_bytes_) / 1024.0 / (STATS_MS / 1000));
+        fflush(stdout);
+        last_bytes_ = bytes_;
+    }
+
+private:
+    SessionManager *manager_;
+    int max_age_;
+    QSet<SyncCommand *> connected_;
+    qint64 configs_;
+    qint64 cached_;         // sessions that skipped the download
+    qint64 failures_;
+    qint64 messages_;
+    qint64 bytes_;
+    qint64 last_bytes_;
+};
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QStringList args = app.arguments();
+    args.removeFirst();
+
+    int count = 1;
+    int base_port = DEFAULT_BASE_PORT;
+    int thread_count = SESSION_THREAD_COUNT;
+    int max_age = CONFIG_CACHE_MAX_AGE;
+    int run_secs = 0;
+    QString cache_dir;
+    QString host;
+    for (int i = 0; i < args.size(); i++)
+    {
+        const QString &arg = args.at(i);
+        if (arg.startsWith("-") && i + 1 >= args.size())
+        {
+            usage();
+            return 1;
+        }
+        if (arg == "-n")
+        {
+            count = args.at(++i).toInt();
+        }
+        else if (arg == "-p")
+        {
+            base_port = args.at(++i).toInt();
+        }
+        else if (arg == "-j")
+        {
+            thread_count = args.at(++i).toInt();
+        }
+        else if (arg == "-a")
+        {
+            max_age = args.at(++i).toInt();
+        }
+        else if (arg == "-c")
+        {
+            cache_dir = args.at(++i);
+        }
+        else if (arg == "-t")
+        {
+            run_secs = args.at(++i).toInt();
+        }
+        else
+        {
+            host = arg;
+        }
+    }
+    if (host.isEmpty() || count <= 0 || base_port <= 0 || base_port + count > 65536)
+    {
+        usage();
+        return 1;
+    }
+
+    ConfigCache cache;
+    SessionManager manager(thread_count);
+    if (!cache_dir.isEmpty())
+    {
+        if (!cache.open(cache_dir))
+        {
+            fprintf(stderr, "open config cache %s failed\n", qPrintable(cache_dir));
+            return 1;
+        }
+        manager.setConfigCache(&cache);
+    }
+    MonitorPool pool(&manager, max_age);
+    QObject::connect(&manager, SIGNAL(sessionConnected(SyncCommand*)), &pool, SLOT(connectedSlot(SyncCommand*)));
+    QObject::connect(&manager, SIGNAL(sessionDisconnected(SyncCommand*)), &pool, SLOT(disconnectedSlot(SyncCommand*)));
+    QObject::connect(&manager, SIGNAL(configReceived(SyncCommand*)), &pool, SLOT(configReceivedSlot(SyncCommand*)));
+    QObject::connect(&manager, SIGNAL(configFailed(SyncCommand*,QString)), &pool, SLOT(configFailedSlot(SyncCommand*,QString)));
+    QObject::connect(&manager, SIGNAL(messageReceived(SyncCommand*,QByteArray)), &pool, SLOT(messageSlot(SyncCommand*,QByteArray)));
+    for (int i = 0; i < count; i++)
+    {
+        manager.openSession(host, base_port + i);
+    }
+    fprintf(stdout, "%d sessions to %s:%d-%d on %d threads\n", manager.sessionCount(),
+            qPrintable(host), base_port, base_port + count - 1, manager.threadCount());
+
+    QTimer stats_timer;
+    QObject::connect(&stats_timer, SIGNAL(timeout()), &pool, SLOT(statsSlot()));
+    stats_timer.start(STATS_MS);
+    if (run_secs > 0)
+    {
+        QTimer::singleShot(run_secs * 1000, &app, SLOT(quit()));
+    }
+    return app.exec();
+}
+
+#include "main.moc"
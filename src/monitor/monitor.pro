@@ -0,0 +1,12 @@
+# monitoring side of the load tests, qmake && make && ./SimulatorMonitor
+# connects to any number of controllers (MockSignaler or real ones) through one SessionManager.
+
+QT -= gui
+CONFIG += console
+CONFIG -= app_bundle
+TARGET = SimulatorMonitor
+
+include(../simulatorcore.pri)
+
+SOURCES += \
+    main.cpp
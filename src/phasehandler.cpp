@@ -1,10 +1,13 @@
 #include "phasehandler.h"
 //#include "macrostring.h"
 #include <QDebug>
+#include <string.h>
 
 PhaseHandler::PhaseHandler()
 {
     db_ = MDatabase::GetInstance();
+    read_db_ = db_;
+    rebuild_phase_index();
 }
 
 PhaseHandler::~PhaseHandler()
@@ -14,17 +17,29 @@ PhaseHandler::~PhaseHandler()
 void PhaseHandler::init_database(void *db_ptr)
 {
     db_ = static_cast<MDatabase *>(db_ptr);
+    read_db_ = db_;
 }
 
 void PhaseHandler::reset_database()
 {
     db_ = MDatabase::GetInstance();
+    read_db_ = db_;
 }
 
 void PhaseHandler::init()
 {
-    phase_list_ = db_->get_phase_table();
+    phase_list_ = read_db_->get_phase_table();
 	qSort(phase_list_.begin(), phase_list_.end(), phase_less_than);
+    rebuild_phase_index();
+}
+
+void PhaseHandler::init(const MDatabase *db)
+{
+    db_ = NULL;
+    read_db_ = db;
+    phase_list_ = db->get_phase_table();
+	qSort(phase_list_.begin(), phase_list_.end(), phase_less_than);
+    rebuild_phase_index();
 }
 
 void PhaseHandler::set_phase(unsigned char phase_id, const PhaseParam &phase)
@@ -39,6 +54,7 @@ void PhaseHandler::set_phase(unsigned char phase_id, const PhaseParam &phase)
 
     // add a new phase
     phase_list_.append(phase);
+    rebuild_phase_index();
 }
 
 bool PhaseHandler::get_phase(unsigned char phase_id, PhaseParam &phase)
@@ -57,18 +73,25 @@ bool PhaseHandler::is_phase_exists(unsigned char phase_id)
     return (index_of_phase_list(phase_id) != -1);
 }
 
+// the list is handed out by reference, a stale index is rebuilt on the miss
 int PhaseHandler::index_of_phase_list(unsigned char phase_id)
 {
-    int index = -1;
-    for (int i = 0; i < phase_list_.size(); i++)
+    int index = phase_index_[phase_id];
+    if (index != -1 && index < phase_list_.size() && phase_list_.at(index).phase_id == phase_id)
     {
-        if (phase_id == phase_list_.at(i).phase_id)
-        {
-            index = i;
-            return index;
-        }
+        return index;
+    }
+    rebuild_phase_index();
+    return phase_index_[phase_id];
+}
+
+void PhaseHandler::rebuild_phase_index()
+{
+    memset(phase_index_, -1, sizeof(phase_index_));
+    for (int i = phase_list_.size() - 1; i >= 0; i--)
+    {
+        phase_index_[phase_list_.at(i).phase_id] = i;
     }
-    return index;
 }
 
 bool PhaseHandler::add_phase(const PhaseParam &phase)
@@ -78,14 +101,17 @@ bool PhaseHandler::add_phase(const PhaseParam &phase)
         return false;
     }
     phase_list_.append(phase);
+    rebuild_phase_index();
     return true;
 }
 
 bool PhaseHandler::remove_phase(unsigned char phase_id)
 {
-    if (int idx = index_of_phase_list(phase_id) != -1)
+    int idx = index_of_phase_list(phase_id);
+    if (idx != -1)
     {
         phase_list_.removeAt(idx);
+        rebuild_phase_index();
         return true;
     }
     return false;
@@ -105,6 +131,7 @@ QList<PhaseParam *> PhaseHandler::get_phase_ptr_list()
 QList<PhaseParam> &PhaseHandler::get_phase_list()
 {
     qSort(phase_list_.begin(), phase_list_.end(), phase_less_than);
+    rebuild_phase_index();
     return phase_list_;
 }
 
@@ -148,17 +175,7 @@ void PhaseHandler::dump_list()
 
 unsigned char PhaseHandler::get_phase_channel_id( unsigned char phase_id )
 {
-    QList<ChannelParam> channels = db_->get_channel_table();
-	unsigned char channel_id = 0;
-    for (int i = 0; i < channels.size(); i++)
-    {
-        if (phase_id == channels.at(i).channel_ctrl_src)
-        {
-            channel_id = channels.at(i).channel_id;
-            break;
-        }
-    }
-	return channel_id;
+    return read_db_->get_phase_channel_id(phase_id);
 }
 
 QString PhaseHandler::get_phase_ctrled_channels_desc( unsigned int channel_ids )
@@ -279,10 +296,15 @@ QString PhaseHandler::get_phase_type_desc(unsigned char phase_type)
 */
 bool PhaseHandler::save_data()
 {
+    if (db_ == NULL)
+    {
+        return false;
+    }
     std::list<PhaseParam> std_list = phase_list_.toStdList();
     std_list.sort();
     phase_list_.clear();
     phase_list_ = QList<PhaseParam>::fromStdList(std_list);
+    rebuild_phase_index();
     db_->set_phase_table(phase_list_);
     return true;
 }
@@ -15,6 +15,9 @@ public:
     void reset_database();
 
     void init();
+    // phase list and lookups of a published snapshot, which is never written:
+    // save_data() fails until init_database() binds a writable database
+    void init(const MDatabase *db);
 
     bool addNewPhase();
     bool deletePhase(unsigned char phase_id);
@@ -38,13 +41,16 @@ public:
 
 private:
     unsigned char get_max_phase_id();
+    void rebuild_phase_index();
     void dump_list();
 
     static bool phase_less_than(const PhaseParam &left, const PhaseParam &right);
 
 private:
-    MDatabase* db_;
+    MDatabase* db_;             // NULL when bound to a snapshot
+    const MDatabase *read_db_;  // lookups, db_ or the snapshot
     QList<PhaseParam> phase_list_;
+    short phase_index_[256];    // phase id -> phase_list_ index, -1 when absent
 };
 
 #endif // PHASEHANDLER_H
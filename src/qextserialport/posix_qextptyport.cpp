@@ -0,0 +1,118 @@
+/*!
+\class Posix_QextPtyPort
+\version 1.0.0
+
+Loopback serial port for testing without hardware.  The port itself is the slave side of a
+pseudo-terminal pair and behaves exactly like Posix_QextSerialPort, the master side is read by
+this class and handed out through the masterDataReceived() signal.
+*/
+
+#include <stdlib.h>
+#include <fcntl.h>
+#include <QSocketNotifier>
+#include "posix_qextptyport.h"
+
+/*! size of a single read from the master side. */
+#define PTY_MASTER_READ_SIZE 4096
+
+/*!
+\fn Posix_QextPtyPort::Posix_QextPtyPort(QextSerialBase::QueryMode mode)
+Constructs a loopback port.  The slave device name is only known after open().
+*/
+Posix_QextPtyPort::Posix_QextPtyPort(QextSerialBase::QueryMode mode)
+ : Posix_QextSerialPort(QString(), mode)
+{
+	masterFd = -1;
+	masterNotifier = NULL;
+	masterBuffer.resize(PTY_MASTER_READ_SIZE);
+}
+
+/*!
+\fn Posix_QextPtyPort::~Posix_QextPtyPort()
+Standard destructor.
+*/
+Posix_QextPtyPort::~Posix_QextPtyPort()
+{
+	if (isOpen())
+		close();
+}
+
+/*!
+\fn bool Posix_QextPtyPort::open(OpenMode mode)
+Allocates a pseudo-terminal pair and opens its slave side with the current settings.
+Returns false if the pair can not be allocated or the slave can not be opened.
+*/
+bool Posix_QextPtyPort::open(OpenMode mode)
+{
+	if (isOpen())
+		return true;
+
+	masterFd = posix_openpt(O_RDWR|O_NOCTTY);
+	if (masterFd == -1 || grantpt(masterFd) == -1 || unlockpt(masterFd) == -1) {
+		translateError(errno);
+		if (masterFd != -1)
+			::close(masterFd);
+		masterFd = -1;
+		return false;
+	}
+	fcntl(masterFd, F_SETFL, fcntl(masterFd, F_GETFL) | O_NONBLOCK);
+	setPortName(QString::fromLocal8Bit(ptsname(masterFd)));
+
+	if (!Posix_QextSerialPort::open(mode)) {
+		::close(masterFd);
+		masterFd = -1;
+		return false;
+	}
+	masterNotifier = new QSocketNotifier(masterFd, QSocketNotifier::Read, this);
+	connect(masterNotifier, SIGNAL(activated(int)), this, SLOT(masterNotifierActivated()));
+	return true;
+}
+
+/*!
+\fn void Posix_QextPtyPort::close()
+Closes both sides of the pair.
+*/
+void Posix_QextPtyPort::close()
+{
+	Posix_QextSerialPort::close();
+	delete masterNotifier;
+	masterNotifier = NULL;
+	if (masterFd != -1) {
+		::close(masterFd);
+		masterFd = -1;
+	}
+}
+
+/*!
+\fn int Posix_QextPtyPort::masterHandle() const
+Returns the descriptor of the master side, or -1 if the port is not open.
+*/
+int Posix_QextPtyPort::masterHandle() const
+{
+	return masterFd;
+}
+
+/*!
+\fn qint64 Posix_QextPtyPort::writeMaster(const char * data, qint64 len)
+Writes to the master side, the bytes become readable on the port.  Returns the number of
+bytes accepted by the pseudo-terminal, or -1 on error.
+*/
+qint64 Posix_QextPtyPort::writeMaster(const char * data, qint64 len)
+{
+	if (masterFd == -1)
+		return -1;
+	int n = ::write(masterFd, data, len);
+	if (n == -1 && errno == EAGAIN)
+		return 0;
+	return n;
+}
+
+void Posix_QextPtyPort::masterNotifierActivated()
+{
+	int n;
+	while ((n = ::read(masterFd, masterBuffer.data(), masterBuffer.size())) > 0)
+		emit masterDataReceived(QByteArray(masterBuffer.constData(), n));
+	/*EIO: slave side has been closed*/
+	if (n == -1 && errno == EIO)
+		masterNotifier->setEnabled(false);
+}
@@ -0,0 +1,41 @@
+#ifndef _POSIX_QEXTPTYPORT_H_
+#define _POSIX_QEXTPTYPORT_H_
+
+#include <QByteArray>
+#include "posix_qextserialport.h"
+
+class QSocketNotifier;
+
+/*!
+ * Serial port backed by a pseudo-terminal pair instead of a physical device.
+ * open() allocates the pair and opens the slave side like any other tty, the
+ * master side stands for the far end of the cable: bytes written to the port
+ * come out of masterDataReceived(), writeMaster() feeds the port's input.
+ */
+class Posix_QextPtyPort:public Posix_QextSerialPort
+{
+	Q_OBJECT
+
+	public:
+	    Posix_QextPtyPort(QextSerialBase::QueryMode mode = QextSerialBase::EventDriven);
+	    virtual ~Posix_QextPtyPort();
+
+	    virtual bool open(OpenMode mode);
+	    virtual void close();
+
+	    int masterHandle() const;
+	    qint64 writeMaster(const char * data, qint64 len);
+
+	signals:
+	    void masterDataReceived(const QByteArray & data);
+
+	private slots:
+	    void masterNotifierActivated();
+
+	private:
+	    int masterFd;
+	    QSocketNotifier* masterNotifier;
+	    QByteArray masterBuffer;
+};
+
+#endif
@@ -13,6 +13,9 @@ warnings) in the project.  Note that _TTY_NOWARN_ will also turn off portability
 */
 
 #include <stdio.h>
+#include <fcntl.h>
+#include <QSocketNotifier>
+#include <QThread>
 #include "posix_qextserialport.h"
 
 /*!
@@ -42,6 +45,7 @@ Posix_QextSerialPort::Posix_QextSerialPort()
 : QextSerialBase()
 {
     Posix_File=new QFile();
+    init();
 }
 
 /*!
@@ -65,6 +69,7 @@ Posix_QextSerialPort::Posix_QextSerialPort(const Posix_QextSerialPort& s)
     memcpy(&Posix_Timeout, &s.Posix_Timeout, sizeof(struct timeval));
     memcpy(&Posix_Copy_Timeout, &s.Posix_Copy_Timeout, sizeof(struct timeval));
     memcpy(&Posix_CommConfig, &s.Posix_CommConfig, sizeof(struct termios));
+    init();
 }
 
 /*!
@@ -141,10 +146,16 @@ Posix_QextSerialPort& Posix_QextSerialPort::operator=(const Posix_QextSerialPort
     return *this;
 }
 
+/*!
+\fn void Posix_QextSerialPort::init()
+Common part of the constructors. In EventDriven mode the notifiers are created by open(),
+the write queue is allocated here so that write() never allocates.
+*/
 void Posix_QextSerialPort::init()
 {
-	if (queryMode() == QextSerialBase::EventDriven)
-		qWarning("POSIX doesn't have event driven mechanism implemented yet");
+	readNotifier = NULL;
+	writeNotifier = NULL;
+	writeQueue = new QextSpscQueue(POSIX_WRITE_QUEUE_SIZE);
 }
 
 /*!
@@ -158,6 +169,7 @@ Posix_QextSerialPort::~Posix_QextSerialPort()
     }
     Posix_File->close();
     delete Posix_File;
+    delete writeQueue;
 }
 
 /*!
@@ -834,7 +846,17 @@ bool Posix_QextSerialPort::open(OpenMode mode)
         /*open the port*/
         Posix_File->setFileName(port);
         qDebug("Trying to open File");
-        if (Posix_File->open(QIODevice::ReadWrite|QIODevice::Unbuffered)) {
+        bool opened;
+        if (queryMode() == QextSerialBase::EventDriven) {
+            /*non-blocking descriptor, the event loop tells when it is readable or writable*/
+            int fd = ::open(QFile::encodeName(port).constData(), O_RDWR|O_NOCTTY|O_NONBLOCK);
+            opened = fd != -1 && Posix_File->open(fd, QIODevice::ReadWrite|QIODevice::Unbuffered, QFileDevice::AutoCloseHandle);
+            if (fd != -1 && !opened)
+                ::close(fd);
+        } else {
+            opened = Posix_File->open(QIODevice::ReadWrite|QIODevice::Unbuffered);
+        }
+        if (opened) {
             qDebug("Opened File succesfully");
             /*set open mode*/
             QIODevice::open(mode);
@@ -858,8 +880,16 @@ bool Posix_QextSerialPort::open(OpenMode mode)
             setParity(Settings.Parity);
             setStopBits(Settings.StopBits);
             setFlowControl(Settings.FlowControl);
-            setTimeout(Settings.Timeout_Sec, Settings.Timeout_Millisec);
+            setTimeout(Settings.Timeout_Millisec);
             tcsetattr(Posix_File->handle(), TCSAFLUSH, &Posix_CommConfig);
+
+            if (queryMode() == QextSerialBase::EventDriven) {
+                readNotifier = new QSocketNotifier(Posix_File->handle(), QSocketNotifier::Read, this);
+                connect(readNotifier, SIGNAL(activated(int)), this, SLOT(readNotifierActivated()));
+                writeNotifier = new QSocketNotifier(Posix_File->handle(), QSocketNotifier::Write, this);
+                writeNotifier->setEnabled(false);
+                connect(writeNotifier, SIGNAL(activated(int)), this, SLOT(writeNotifierActivated()));
+            }
         } else {
             qDebug("Could not open File! Error code : %d", Posix_File->error());
         }
@@ -876,6 +906,11 @@ is not currently open.
 void Posix_QextSerialPort::close()
 {
     LOCK_MUTEX();
+    delete readNotifier;
+    readNotifier = NULL;
+    delete writeNotifier;
+    writeNotifier = NULL;
+    writeQueue->clear();
     Posix_File->close();
     QIODevice::close();
     UNLOCK_MUTEX();
@@ -884,12 +919,15 @@ void Posix_QextSerialPort::close()
 /*!
 \fn void Posix_QextSerialPort::flush()
 Flushes all pending I/O to the serial port.  This function has no effect if the serial port
-associated with the class is not currently open.
+associated with the class is not currently open.  In EventDriven mode the write queue is
+handed to the tty as far as it accepts it without blocking.
 */
 void Posix_QextSerialPort::flush()
 {
     LOCK_MUTEX();
     if (isOpen()) {
+        if (queryMode() == QextSerialBase::EventDriven && QThread::currentThread() == thread())
+            drainWriteQueue();
         Posix_File->flush();
     }
     UNLOCK_MUTEX();
@@ -915,10 +953,22 @@ qint64 Posix_QextSerialPort::size() const
 \fn qint64 Posix_QextSerialPort::bytesAvailable()
 Returns the number of bytes waiting in the port's receive queue.  This function will return 0 if
 the port is not currently open, or -1 on error.  Error information can be retrieved by calling
-Posix_QextSerialPort::getLastError().
+Posix_QextSerialPort::getLastError().  In EventDriven mode the receive queue is queried
+directly, without waiting for data and without locking.
 */
 qint64 Posix_QextSerialPort::bytesAvailable()
 {
+    if (queryMode() == QextSerialBase::EventDriven) {
+        int bytesQueued;
+        if (!isOpen())
+            return 0;
+        if (ioctl(Posix_File->handle(), FIONREAD, &bytesQueued)==-1) {
+            translateError(errno);
+            return -1;
+        }
+        return bytesQueued + QIODevice::bytesAvailable();
+    }
+
     LOCK_MUTEX();
     if (isOpen()) {
         int bytesQueued;
@@ -1096,6 +1146,17 @@ is currently open (use isOpen() function to check if port is open).
 */
 qint64 Posix_QextSerialPort::readData(char * data, qint64 maxSize)
 {
+    if (queryMode() == QextSerialBase::EventDriven) {
+        /*non-blocking descriptor, nothing to read is not an error*/
+        int retVal=::read(Posix_File->handle(), data, maxSize);
+        if (retVal==-1) {
+            if (errno==EAGAIN || errno==EINTR)
+                return 0;
+            lastErr=E_READ_FAILED;
+        }
+        return retVal;
+    }
+
     LOCK_MUTEX();
     int retVal=0;
     retVal=Posix_File->read(data, maxSize);
@@ -1114,9 +1175,37 @@ of bytes actually written, or -1 on error.
 
 \warning before calling this function ensure that serial port associated with this class
 is currently open (use isOpen() function to check if port is open).
+
+In EventDriven mode whatever the tty does not accept at once is put into a lock-free queue which
+is drained when the descriptor becomes writable, and bytesWritten() is emitted from the event loop.
+Only one thread may write to the port in this mode.  Return value is less than maxSize only when
+the queue is full.
 */
 qint64 Posix_QextSerialPort::writeData(const char * data, qint64 maxSize)
 {
+    if (queryMode() == QextSerialBase::EventDriven) {
+        bool ownThread = QThread::currentThread() == thread();
+        qint64 done = 0;
+        if (ownThread && writeQueue->isEmpty()) {
+            int n=::write(Posix_File->handle(), data, maxSize);
+            if (n > 0) {
+                done = n;
+                QMetaObject::invokeMethod(this, "bytesWritten", Qt::QueuedConnection, Q_ARG(qint64, done));
+            } else if (n==-1 && errno!=EAGAIN && errno!=EINTR) {
+                lastErr=E_WRITE_FAILED;
+                return -1;
+            }
+        }
+        done += writeQueue->push(data + done, (int)(maxSize - done));
+        if (!writeQueue->isEmpty()) {
+            if (ownThread)
+                enableWriteNotifier();
+            else
+                QMetaObject::invokeMethod(this, "enableWriteNotifier", Qt::QueuedConnection);
+        }
+        return done;
+    }
+
     LOCK_MUTEX();
     int retVal=0;
     retVal=Posix_File->write(data, maxSize);
@@ -1126,3 +1215,56 @@ qint64 Posix_QextSerialPort::writeData(const char * data, qint64 maxSize)
     
     return retVal;
 }
+
+/*!
+\fn qint64 Posix_QextSerialPort::bytesToWrite() const
+Returns the number of bytes queued by write() in EventDriven mode and not yet written to the port.
+*/
+qint64 Posix_QextSerialPort::bytesToWrite() const
+{
+    return writeQueue->size();
+}
+
+/*!
+\fn void Posix_QextSerialPort::drainWriteQueue()
+Writes queued bytes until the queue is empty or the tty would block.  Consumer side of writeQueue,
+runs in the thread the port lives in.
+*/
+void Posix_QextSerialPort::drainWriteQueue()
+{
+    qint64 written = 0;
+    const char * data;
+    int len;
+    while ((len = writeQueue->peek(&data)) > 0) {
+        int n=::write(Posix_File->handle(), data, len);
+        if (n==-1 && errno==EINTR)
+            continue;
+        if (n <= 0) {
+            if (n==-1 && errno!=EAGAIN)
+                lastErr=E_WRITE_FAILED;
+            break;
+        }
+        writeQueue->pop(n);
+        written += n;
+    }
+    if (writeNotifier)
+        writeNotifier->setEnabled(!writeQueue->isEmpty());
+    if (written)
+        emit bytesWritten(written);
+}
+
+void Posix_QextSerialPort::readNotifierActivated()
+{
+    emit readyRead();
+}
+
+void Posix_QextSerialPort::writeNotifierActivated()
+{
+    drainWriteQueue();
+}
+
+void Posix_QextSerialPort::enableWriteNotifier()
+{
+    if (writeNotifier && !writeQueue->isEmpty())
+        writeNotifier->setEnabled(true);
+}
@@ -9,20 +9,32 @@
 #include <sys/ioctl.h>
 #include <sys/select.h>
 #include "qextserialbase.h"
+#include "qextspscqueue.h"
+
+class QSocketNotifier;
+
+/*! size of the event driven write queue. */
+#define POSIX_WRITE_QUEUE_SIZE 65536
 
 class Posix_QextSerialPort:public QextSerialBase 
 {
+	Q_OBJECT
+
 	private:
 	    /*!
 	     * This method is a part of constructor.
 	     */
 	    void init();
+	    void drainWriteQueue();
 
 	protected:
 	    QFile* Posix_File;
 	    struct termios Posix_CommConfig;
 	    struct timeval Posix_Timeout;
 	    struct timeval Posix_Copy_Timeout;
+	    QSocketNotifier* readNotifier;		///< EventDriven only.
+	    QSocketNotifier* writeNotifier;		///< EventDriven only, enabled while writeQueue is not empty.
+	    QextSpscQueue* writeQueue;			///< EventDriven only.
 	
 	    virtual qint64 readData(char * data, qint64 maxSize);
 	    virtual qint64 writeData(const char * data, qint64 maxSize);
@@ -58,6 +70,17 @@ class Posix_QextSerialPort:public QextSerialBase
 	    virtual void setRts(bool set=true);
 	    virtual ulong lineStatus();
 
+	    /*!
+	     * Return number of bytes queued by write() and not yet handed to the tty.
+	     * 
+	     * \note this function always returns 0 in polling mode.
+	     */
+	    virtual qint64 bytesToWrite() const;
+
+	private slots:
+	    void readNotifierActivated();
+	    void writeNotifierActivated();
+	    void enableWriteNotifier();
 };
 
 #endif
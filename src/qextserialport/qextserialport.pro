@@ -23,8 +23,11 @@ SOURCES                 = qextserialbase.cpp \
                           qextserialport.cpp \
                           qextserialenumerator.cpp
 
-unix:HEADERS           += posix_qextserialport.h
-unix:SOURCES           += posix_qextserialport.cpp
+unix:HEADERS           += posix_qextserialport.h \
+                          posix_qextptyport.h \
+                          qextspscqueue.h
+unix:SOURCES           += posix_qextserialport.cpp \
+                          posix_qextptyport.cpp
 unix:DEFINES           += _TTY_POSIX_
 
 
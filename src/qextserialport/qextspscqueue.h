@@ -0,0 +1,96 @@
+#ifndef _QEXTSPSCQUEUE_H_
+#define _QEXTSPSCQUEUE_H_
+
+#include <QAtomicInteger>
+#include <string.h>
+
+/*!
+ * Lock-free byte queue for exactly one producer thread and one consumer thread.
+ * The producer only moves tail, the consumer only moves head, so neither side
+ * ever takes a lock. Indices are unsigned and grow freely, wrapping around
+ * without changing tail - head, and are masked into the buffer, which is why
+ * the capacity is rounded up to a power of two.
+ */
+class QextSpscQueue
+{
+	public:
+		explicit QextSpscQueue(int capacity)
+		{
+			int size = 1;
+			while (size < capacity)
+				size <<= 1;
+			buffer = new char[size];
+			mask = size - 1;
+		}
+
+		~QextSpscQueue()
+		{
+			delete [] buffer;
+		}
+
+		/*!
+		 * Producer side. Copies at most \p len bytes into the queue.
+		 * \return number of bytes queued, less than \p len when the queue is full.
+		 */
+		int push(const char * data, int len)
+		{
+			quint32 t = tail.load();
+			quint32 h = head.loadAcquire();
+			int space = (mask + 1) - (int)(t - h);
+			if (len > space)
+				len = space;
+			int pos = t & mask;
+			int first = qMin(len, (mask + 1) - pos);
+			memcpy(buffer + pos, data, first);
+			memcpy(buffer, data + first, len - first);
+			tail.storeRelease(t + len);
+			return len;
+		}
+
+		/*!
+		 * Consumer side. Points \p data at the oldest queued bytes.
+		 * \return length of the contiguous block, 0 when the queue is empty.
+		 */
+		int peek(const char ** data) const
+		{
+			quint32 h = head.load();
+			quint32 t = tail.loadAcquire();
+			int pos = h & mask;
+			*data = buffer + pos;
+			return qMin((int)(t - h), (mask + 1) - pos);
+		}
+
+		/*!
+		 * Consumer side. Releases \p len bytes returned by peek().
+		 */
+		void pop(int len)
+		{
+			head.storeRelease(head.load() + len);
+		}
+
+		int size() const
+		{
+			return (int)(tail.loadAcquire() - head.loadAcquire());
+		}
+
+		bool isEmpty() const
+		{
+			return size() == 0;
+		}
+
+		/*!
+		 * Drops all queued bytes. Only safe while neither side is running.
+		 */
+		void clear()
+		{
+			head.storeRelease(tail.loadAcquire());
+		}
+
+	private:
+		char * buffer;
+		int mask;
+		QAtomicInteger<quint32> head;
+		QAtomicInteger<quint32> tail;
+};
+
+#endif
@@ -1,17 +1,110 @@
 #ifndef SERIALDATA_H
 #define SERIALDATA_H
 
+#include <QtGlobal>
+#include <string.h>
+
+/* Detector frame codec.
+ *   0xF1 | type | detector id | ms_time low | ms_time high | 0xED
+ * Frames are encoded into and decoded from caller buffers, nothing here
+ * allocates. Used by the traffic engine and by the loopback sink.
+*/
 class SerialData
 {
 public:
-    SerialData();
+    enum Layout
+    {
+        HeadPos = 0,
+        TypePos = 1,
+        IdPos = 2,
+        TimePos = 3,
+        TailPos = 5,
+        Size = 6
+    };
 
-public:
-    const static char head =  0xf1 + '\0';
-    const static char tail = 0xed + '\0';
-    char type;
-    char detector_id;
-    char ms_time[4];
+    enum Marker
+    {
+        Head = 0xf1,
+        Tail = 0xed
+    };
+
+    enum Type
+    {
+        LaneEnter = 0x01,
+        LaneLeave = 0x02,
+        WalkKey = 0x04,
+        Bus = 0x05
+    };
+
+    struct Frame
+    {
+        Type type;
+        unsigned char detector_id;
+        quint16 ms_time;
+    };
+
+    // detector id 1-48 lane, 49-56 walk key, 57-60 bus
+    static Q_DECL_CONSTEXPR inline bool isLaneDetector(int detector_id)
+    {
+        return detector_id >= 1 && detector_id <= 48;
+    }
+
+    static Q_DECL_CONSTEXPR inline Type typeOfDetector(int detector_id, bool leave = false)
+    {
+        return leave ? LaneLeave
+                     : isLaneDetector(detector_id) ? LaneEnter
+                     : detector_id <= 56 ? WalkKey
+                     : detector_id <= 60 ? Bus
+                     : LaneEnter;
+    }
+
+    // wire time: FrameClock milliseconds, wrapping at 16 bits
+    static Q_DECL_CONSTEXPR inline quint16 wireTime(qint64 usecs)
+    {
+        return (quint16)(usecs / 1000);
+    }
+
+    static inline void encode(char *buf, Type type, unsigned char detector_id, quint16 ms_time)
+    {
+        buf[HeadPos] = (char)Head;
+        buf[TypePos] = (char)type;
+        buf[IdPos] = (char)detector_id;
+        buf[TimePos] = (char)(ms_time & 0xff);
+        buf[TimePos + 1] = (char)(ms_time >> 8);
+        buf[TailPos] = (char)Tail;
+    }
+
+    template <int N>
+    static inline void encode(char (&buf)[N], Type type, unsigned char detector_id, quint16 ms_time)
+    {
+        Q_STATIC_ASSERT(N >= Size);
+        encode(&buf[0], type, detector_id, ms_time);
+    }
+
+    static inline bool isFrame(const char *buf)
+    {
+        return (unsigned char)buf[HeadPos] == Head && (unsigned char)buf[TailPos] == Tail;
+    }
+
+    static inline bool decode(const char *buf, Frame *frame)
+    {
+        if (!isFrame(buf))
+        {
+            return false;
+        }
+        frame->type = (Type)(unsigned char)buf[TypePos];
+        frame->detector_id = (unsigned char)buf[IdPos];
+        frame->ms_time = (quint16)((unsigned char)buf[TimePos] | ((unsigned char)buf[TimePos + 1] << 8));
+        return true;
+    }
+
+    static inline bool equal(const char *a, const char *b)
+    {
+        return memcmp(a, b, Size) == 0;
+    }
 };
 
+Q_STATIC_ASSERT(SerialData::TailPos == SerialData::Size - 1);
+Q_STATIC_ASSERT(SerialData::TimePos + 2 == SerialData::TailPos);
+
 #endif // SERIALDATA_H
@@ -0,0 +1,281 @@
+#include "sessionmanager.h"
+#include "synccommand.h"
+#include "command.h"
+#include "cytdecoder.h"
+#include "configcache.h"
+#include "tscimage.h"
+
+#include <QThread>
+
+SessionManager::SessionManager(int thread_count, QObject *parent) :
+    QObject(parent)
+{
+    config_cache_ = NULL;
+    if (thread_count < 0)
+    {
+        thread_count = qMax(1, QThread::idealThreadCount());
+    }
+    for (int i = 0; i < thread_count; i++)
+    {
+        QThread *thread = new QThread(this);
+        thread->start();
+        thread_list_.append(thread);
+    }
+}
+
+SessionManager::~SessionManager()
+{
+    closeAll();
+    for (int i = 0; i < thread_list_.size(); i++)
+    {
+        thread_list_.at(i)->quit();
+    }
+    for (int i = 0; i < thread_list_.size(); i++)
+    {
+        thread_list_.at(i)->wait();
+    }
+}
+
+SyncCommand *SessionManager::openSession(const QString &ip, unsigned int port)
+{
+    QString key = sessionKey(ip, port);
+    SyncCommand *cmd = key_map_.value(key, NULL);
+    if (cmd != NULL)
+    {
+        return cmd;
+    }
+    QThread *thread = leastLoadedThread();
+    cmd = new SyncCommand(thread == NULL ? this : NULL);
+    cmd->setSocketAddress(ip, port);
+    connect(cmd, SIGNAL(messageReceived(QByteArray)), this, SLOT(sessionMessageSlot(QByteArray)));
+    connect(cmd, SIGNAL(chunkReceived(char,QByteArray,bool)), this, SLOT(sessionChunkSlot(char,QByteArray,bool)));
+    connect(cmd, SIGNAL(connectedSignal()), this, SLOT(sessionConnectedSlot()));
+    connect(cmd, SIGNAL(disconnectedSignal()), this, SLOT(sessionDisconnectedSlot()));
+
+    Session session;
+    session.key = key;
+    session.thread = thread;
+    session.monitoring = false;
+    if (thread != NULL)
+    {
+        cmd->moveToThread(thread);
+        connect(thread, SIGNAL(finished()), cmd, SLOT(deleteLater()));
+    }
+    session_map_.insert(cmd, session);
+    key_map_.insert(key, cmd);
+
+    QMetaObject::invokeMethod(cmd, "openConnection", Qt::QueuedConnection);
+    return cmd;
+}
+
+void SessionManager::closeSession(SyncCommand *session)
+{
+    if (!session_map_.contains(session))
+    {
+        return;
+    }
+    key_map_.remove(session_map_.value(session).key);
+    session_map_.remove(session);
+    disconnect(session, 0, this, 0);
+    QMetaObject::invokeMethod(session, "closeConnection", Qt::QueuedConnection);
+    QMetaObject::invokeMethod(session, "deleteLater", Qt::QueuedConnection);
+}
+
+void SessionManager::closeAll()
+{
+    QList<SyncCommand *> list = session_map_.keys();
+    for (int i = 0; i < list.size(); i++)
+    {
+        closeSession(list.at(i));
+    }
+}
+
+SyncCommand *SessionManager::session(const QString &ip, unsigned int port) const
+{
+    return key_map_.value(sessionKey(ip, port), NULL);
+}
+
+QList<SyncCommand *> SessionManager::sessions() const
+{
+    return session_map_.keys();
+}
+
+int SessionManager::sessionCount() const
+{
+    return session_map_.size();
+}
+
+int SessionManager::threadCount() const
+{
+    return thread_list_.size();
+}
+
+void SessionManager::post(SyncCommand *session, const QByteArray &command, char reply_id)
+{
+    if (!session_map_.contains(session))
+    {
+        return;
+    }
+    QMetaObject::invokeMethod(session, "postCommand", Qt::QueuedConnection,
+                              Q_ARG(QByteArray, command), Q_ARG(char, reply_id));
+}
+
+void SessionManager::postAll(const QByteArray &command, char reply_id)
+{
+    QHash<SyncCommand *, Session>::const_iterator it = session_map_.constBegin();
+    for (; it != session_map_.constEnd(); ++it)
+    {
+        post(it.key(), command, reply_id);
+    }
+}
+
+void SessionManager::monitor(SyncCommand *session)
+{
+    if (!session_map_.contains(session) || session_map_.value(session).monitoring)
+    {
+        return;
+    }
+    session_map_[session].monitoring = true;
+    post(session, Command::BeginMonitor.c_str(), REPLY_NONE);
+}
+
+// no handler, the pieces are collected in sessionChunkSlot
+void SessionManager::requestConfig(SyncCommand *session)
+{
+    post(session, Command::GetConfigure.c_str(), CytDecoder::Config);
+}
+
+QByteArray SessionManager::config(SyncCommand *session) const
+{
+    QByteArray config = session_map_.value(session).config;
+    if (config.isEmpty() && config_cache_ != NULL && session_map_.contains(session))
+    {
+        config_cache_->lookup(session_map_.value(session).key, config);
+    }
+    return config;
+}
+
+DatabaseStore::Snapshot SessionManager::database(SyncCommand *session)
+{
+    if (!session_map_.contains(session))
+    {
+        return DatabaseStore::Snapshot(new MDatabase);
+    }
+    Session &entry = session_map_[session];
+    if (entry.database.isNull())
+    {
+        MDatabase *db = new MDatabase;
+        TscImage image;
+        if (image.load(config(session)))
+        {
+            image.copyTo(db);
+        }
+        entry.database = DatabaseStore::Snapshot(db);
+    }
+    return entry.database;
+}
+
+void SessionManager::setConfigCache(ConfigCache *cache)
+{
+    config_cache_ = cache;
+}
+
+bool SessionManager::isConfigFresh(SyncCommand *session, int max_age) const
+{
+    return config_cache_ != NULL && session_map_.contains(session)
+            && config_cache_->isFresh(session_map_.value(session).key, max_age);
+}
+
+void SessionManager::sessionMessageSlot(const QByteArray &message)
+{
+    SyncCommand *cmd = qobject_cast<SyncCommand *>(sender());
+    if (cmd == NULL || !session_map_.contains(cmd))
+    {
+        return;
+    }
+    emit messageReceived(cmd, message);
+}
+
+// the config arrives in pieces, an interrupted download goes on after the reconnect
+void SessionManager::sessionChunkSlot(char cmd_id, const QByteArray &chunk, bool last)
+{
+    Q_UNUSED(last);
+    SyncCommand *cmd = qobject_cast<SyncCommand *>(sender());
+    if (cmd == NULL || !session_map_.contains(cmd) || cmd_id != CytDecoder::Config)
+    {
+        return;
+    }
+    Session &session = session_map_[cmd];
+    ConfigDownload::State state = session.download.feed(chunk);
+    if (state == ConfigDownload::Receiving)
+    {
+        emit configProgress(cmd, session.download.received(), session.download.total());
+        return;
+    }
+    if (state != ConfigDownload::Complete)
+    {
+        session.download.reset();
+        emit configFailed(cmd, "config transfer broken");
+        return;
+    }
+    session.config = session.download.content();
+    session.database.clear();
+    QString error;
+    if (config_cache_ != NULL && !config_cache_->store(session.key, session.config, NULL, &error))
+    {
+        emit configFailed(cmd, error);
+        return;
+    }
+    emit configReceived(cmd);
+}
+
+void SessionManager::sessionConnectedSlot()
+{
+    SyncCommand *cmd = qobject_cast<SyncCommand *>(sender());
+    if (cmd != NULL && session_map_.contains(cmd))
+    {
+        if (session_map_.value(cmd).monitoring)
+        {
+            post(cmd, Command::BeginMonitor.c_str(), REPLY_NONE);
+        }
+        emit sessionConnected(cmd);
+    }
+}
+
+void SessionManager::sessionDisconnectedSlot()
+{
+    SyncCommand *cmd = qobject_cast<SyncCommand *>(sender());
+    if (cmd != NULL && session_map_.contains(cmd))
+    {
+        session_map_[cmd].download.interrupt();
+        emit sessionDisconnected(cmd);
+    }
+}
+
+QString SessionManager::sessionKey(const QString &ip, unsigned int port)
+{
+    return ConfigCache::controllerKey(ip, port);
+}
+
+QThread *SessionManager::leastLoadedThread() const
+{
+    if (thread_list_.isEmpty())
+    {
+        return NULL;
+    }
+    QHash<QThread *, int> load;
+    QHash<SyncCommand *, Session>::const_iterator it = session_map_.constBegin();
+    for (; it != session_map_.constEnd(); ++it)
+    {
+        load[it.value().thread]++;
+    }
+    QThread *best = thread_list_.first();
+    for (int i = 1; i < thread_list_.size(); i++)
+    {
+        if (load.value(thread_list_.at(i)) < load.value(best))
+        {
+            best = thread_list_.at(i);
+        }
+    }
+    return best;
+}
@@ -0,0 +1,98 @@
+#ifndef SESSIONMANAGER_H
+#define SESSIONMANAGER_H
+
+#include <QObject>
+#include <QList>
+#include <QHash>
+#include <QByteArray>
+#include <QString>
+#include "configdownload.h"
+#include "databasestore.h"
+
+class QThread;
+class SyncCommand;
+class ConfigCache;
+
+#define SESSION_THREAD_COUNT    4
+
+/* Owner of the signaler connections, one SyncCommand per controller.
+ * Every session has its own socket, reply parser, request queue and config.
+ * With worker threads the sessions are spread over that fixed pool, which
+ * only runs their event loops, a thread serves any number of sessions: use
+ * the manager or the SyncCommand slots and signals, which are queued across
+ * threads. Without worker threads (the gui) the sessions stay in the
+ * manager's thread and their request methods may be called directly.
+ *
+ * requestConfig() downloads the config of a session, resumed after a lost
+ * link; config() is its legacy image and database() the tables of it. With
+ * a ConfigCache set, downloaded configs are stored in it and both answer
+ * from it before the first download. isConfigFresh() is for callers that
+ * opt in to trusting a cached config for a while instead of downloading it.
+*/
+class SessionManager : public QObject
+{
+    Q_OBJECT
+public:
+    // thread_count 0: sessions in the caller's thread, < 0: one per core
+    explicit SessionManager(int thread_count = SESSION_THREAD_COUNT, QObject *parent = 0);
+    ~SessionManager();
+
+    SyncCommand *openSession(const QString &ip, unsigned int port);
+    void closeSession(SyncCommand *session);
+    void closeAll();
+
+    SyncCommand *session(const QString &ip, unsigned int port) const;
+    QList<SyncCommand *> sessions() const;
+    int sessionCount() const;
+    int threadCount() const;
+
+    void post(SyncCommand *session, const QByteArray &command, char reply_id);
+    void postAll(const QByteArray &command, char reply_id);
+    // BeginMonitor, sent again after every reconnect; the pushes come out of messageReceived
+    void monitor(SyncCommand *session);
+
+    void requestConfig(SyncCommand *session);
+    QByteArray config(SyncCommand *session) const;
+    // built on first use after each config, empty tables without one
+    DatabaseStore::Snapshot database(SyncCommand *session);
+
+    void setConfigCache(ConfigCache *cache);
+    bool isConfigFresh(SyncCommand *session, int max_age) const;
+
+signals:
+    void messageReceived(SyncCommand *session, const QByteArray &message);
+    void configProgress(SyncCommand *session, int received, int total);
+    void configReceived(SyncCommand *session);
+    // broken transfer, or the config could not be cached
+    void configFailed(SyncCommand *session, const QString &error);
+    void sessionConnected(SyncCommand *session);
+    void sessionDisconnected(SyncCommand *session);
+
+private slots:
+    void sessionMessageSlot(const QByteArray &message);
+    void sessionChunkSlot(char cmd_id, const QByteArray &chunk, bool last);
+    void sessionConnectedSlot();
+    void sessionDisconnectedSlot();
+
+private:
+    static QString sessionKey(const QString &ip, unsigned int port);
+    QThread *leastLoadedThread() const;
+
+private:
+    typedef struct SessionTag
+    {
+        QString key;
+        QThread *thread;        // NULL without worker threads
+        bool monitoring;
+        QByteArray config;      // last config file the signaler sent
+        ConfigDownload download;
+        DatabaseStore::Snapshot database;
+    }Session;
+
+    QList<QThread *> thread_list_;
+    QHash<SyncCommand *, Session> session_map_;
+    QHash<QString, SyncCommand *> key_map_;     // ip:port -> session
+    ConfigCache *config_cache_;                 // not owned, may be NULL
+};
+
+#endif // SESSIONMANAGER_H
@@ -0,0 +1,629 @@
+#include "simulatorcore.h"
+#include "mdatabase.h"
+#include "phasehandler.h"
+#include "framewriter.h"
+#include "frameclock.h"
+#include "arrivalgenerator.h"
+#include "capturefile.h"
+
+#include <QTimer>
+#include <QDebug>
+#include <QLoggingCategory>
+
+// per-vehicle trace of the dispatch, enable with "simulator.dispatch.debug=true"
+Q_LOGGING_CATEGORY(lcDispatch, "simulator.dispatch", QtWarningMsg)
+
+SimulatorCore::SimulatorCore(QObject *parent) :
+    QObject(parent)
+{
+    ctrl_mode_ = 0;
+    phase_ids_ = 0;
+    throttled_frames_ = 0;
+    merged_frames_ = 0;
+    writer_ = new FrameWriter(FRAME_WRITER_CAPACITY, this);
+    generator_ = new ArrivalGenerator(LANE_COUNT);
+    capture_ = NULL;
+    db_ = MDatabase::GetInstance();
+    phase_handler_ = new PhaseHandler;
+
+    send_msg_timer_ = new QTimer(this);
+    timer_ = new QTimer(this);
+    send_msg_timer_->setTimerType(Qt::PreciseTimer);
+    timer_->setTimerType(Qt::PreciseTimer);
+    connect(send_msg_timer_, SIGNAL(timeout()), this, SLOT(sendMsgTimerTimeOutSlot()));
+    connect(timer_, SIGNAL(timeout()), this, SLOT(timerTimeOutSlot()));
+
+    initTrafficDispatcher();
+}
+
+SimulatorCore::~SimulatorCore()
+{
+    if (phase_handler_ != NULL)
+    {
+        delete phase_handler_;
+        phase_handler_ = NULL;
+    }
+    delete generator_;
+    generator_ = NULL;
+    stopCapture();
+}
+
+void SimulatorCore::initDatabase(MDatabase *db)
+{
+    snapshot_.clear();
+    db_ = db;
+    phase_handler_->init_database((void*)db);
+    phase_handler_->init();
+}
+
+// the engine reads this snapshot until the next call, reloads publish a new one
+void SimulatorCore::initDatabase(const DatabaseStore::Snapshot &snapshot)
+{
+    snapshot_ = snapshot;
+    db_ = snapshot_.data();
+    phase_handler_->init(db_);
+}
+
+void SimulatorCore::setDevice(QIODevice *device)
+{
+    writer_->setDevice(device);
+}
+
+void SimulatorCore::setLaneDetectorIdList(const QList<int> &id_list)
+{
+    lane_detector_id_list_ = id_list;
+}
+
+void SimulatorCore::setCtrlMode(unsigned char ctrl_mode)
+{
+    ctrl_mode_ = ctrl_mode;
+}
+
+void SimulatorCore::setPhaseIds(unsigned int phase_ids)
+{
+    phase_ids_ = phase_ids;
+}
+
+// lanes with a flow configured here get generated traffic, see generatedDispatch
+ArrivalGenerator *SimulatorCore::arrivalGenerator() const
+{
+    return generator_;
+}
+
+FrameWriter *SimulatorCore::frameWriter() const
+{
+    return writer_;
+}
+
+unsigned char SimulatorCore::ctrlMode() const
+{
+    return ctrl_mode_;
+}
+
+unsigned int SimulatorCore::phaseId() const
+{
+    return phaseIdOfBits(phase_ids_);
+}
+
+void SimulatorCore::start(int interval_ms)
+{
+    generator_->reset(FrameClock::usecs());
+    for (int i = 0; i < leave_due_list_.size(); i++)
+    {
+        leave_due_list_[i] = -1;
+    }
+    dispatch();
+    send_msg_timer_->start(interval_ms);
+}
+
+void SimulatorCore::stop()
+{
+    send_msg_timer_->stop();
+    timer_->stop();
+    writer_->flush();
+}
+
+bool SimulatorCore::isRunning() const
+{
+    return send_msg_timer_->isActive();
+}
+
+// the running phase is only usable when exactly one phase is released
+unsigned int SimulatorCore::phaseIdOfBits(unsigned int phase_ids)
+{
+    unsigned int phase_id = 0;
+    for (unsigned int i = 1; i <= 32; i++)
+    {
+        if ((phase_ids & 0x01) == 0x01)
+        {
+            if (phase_id != 0)
+            {
+                return 0;
+            }
+            phase_id = i;
+        }
+        phase_ids = phase_ids >> 1;
+    }
+    return phase_id;
+}
+
+// every frame accepted for output from now on is recorded to path
+bool SimulatorCore::startCapture(const QString &path)
+{
+    stopCapture();
+    capture_ = new CaptureFile;
+    if (!capture_->create(path))
+    {
+        qDebug() << "create capture file failed:" << path << capture_->errorString();
+        stopCapture();
+        return false;
+    }
+    return true;
+}
+
+void SimulatorCore::stopCapture()
+{
+    if (capture_ != NULL)
+    {
+        delete capture_;
+        capture_ = NULL;
+    }
+}
+
+bool SimulatorCore::isCapturing() const
+{
+    return capture_ != NULL;
+}
+
+int SimulatorCore::queuedFrames() const
+{
+    return writer_->queuedBytes() / SerialData::Size;
+}
+
+// refused by the writer plus arrivals held back by backpressure
+qint64 SimulatorCore::droppedFrames() const
+{
+    return writer_->droppedFrames() + throttled_frames_;
+}
+
+qint64 SimulatorCore::mergedFrames() const
+{
+    return merged_frames_;
+}
+
+QString SimulatorCore::pacingSummary() const
+{
+    return QString("link %1 B/s, queued %2 dropped %3 merged %4 frames")
+            .arg(writer_->linkRate()).arg(queuedFrames()).arg(droppedFrames()).arg(mergedFrames());
+}
+
+void SimulatorCore::sendMsgTimerTimeOutSlot()
+{
+    if (generator_->isEnabled())
+    {
+        dispatch();
+        return;
+    }
+    if (timer_->isActive())
+    {
+        return;
+    }
+    qCDebug(lcDispatch) << "new car come";
+    dispatch();
+}
+
+/* 1. 检查当前车道是否在当前相位的所控制的通道中且为可通行状态
+ * 2. 如果可通行则放行，否则等待计时器清零，什么也不做。
+*/
+void SimulatorCore::timerTimeOutSlot()
+{
+    timer_->stop();
+    bool retry = false;
+    unsigned int phase_id = phaseId();
+    for (int i = 0; i < LANE_COUNT; i++)
+    {
+        int pre_idx =  pre_lane_idx_list_.at(i);
+        if (isChannelAccessible(phase_id, i+1) && pre_idx >= 0)
+        {
+            qCDebug(lcDispatch) << "Leave--(phase_id:" << phase_id << ", channel_id:" << i+1 << ") accessible" ;
+            if ((car_sent_list_.at(i) == Go) && need_leave_list_.at(i))
+            {
+                qCDebug(lcDispatch) << "Leave--close pre detector:" << pre_idx+1 << ",Color:" << colorPrintable(channel_detector_color_list_.at(pre_idx))
+                         << "false, light detector:" << pre_idx+1 << "Color: Red";
+                packComData(pre_lane_idx_list_.at(i), true);
+                if (!sendComData(true))
+                {
+                    retry = true;
+                    continue;
+                }
+                need_leave_list_[pre_lane_idx_list_.at(i)] = false;
+                emit showLaneDetectorSignal(pre_idx, channel_detector_color_list_.at(pre_idx), false);
+                emit showLaneDetectorSignal(pre_idx, Red, true);
+                channel_detector_color_list_[i] = Red;
+                car_sent_list_[i] = None;
+            }
+            else if ((car_sent_list_.at(i) == None) && !need_leave_list_.at(i))
+            {
+                qCDebug(lcDispatch) << "Leave--close only pre detector:" << pre_lane_idx_list_.at(i)+1 << ",Color:" << colorPrintable(channel_detector_color_list_.at(i)) << " false";
+                packComData(pre_lane_idx_list_.at(i));
+                if (!sendComData())
+                {
+                    retry = true;
+                    continue;
+                }
+                need_leave_list_[pre_lane_idx_list_.at(i)] = false;
+                emit showLaneDetectorSignal(pre_lane_idx_list_.at(i), channel_detector_color_list_.at(i), false);
+                channel_detector_color_list_[i] = Off;
+                car_sent_list_[i] = Other;
+            }
+        }
+    }
+    writer_->flush();
+    if (retry)
+    {
+        timer_->start(FRAME_FLUSH_DEADLINE_MS);
+    }
+}
+
+unsigned char SimulatorCore::getPhaseType(unsigned char phase_id)
+{
+    return db_->get_phase_type(phase_id);
+}
+
+// leave: lane detector leave frame (type 0x02) instead of enter
+void SimulatorCore::packComData(int lane_index, bool leave)
+{
+    int lane_id = lane_detector_id_list_.at(lane_index);
+    if (lane_id <= 60)
+    {
+        need_leave_list_[lane_index] = SerialData::isLaneDetector(lane_id);
+    }
+    SerialData::encode(com_frame_, SerialData::typeOfDetector(lane_id, leave), lane_id,
+                       SerialData::wireTime(FrameClock::usecs()));
+}
+
+/* frames of one dispatch pass are written together by the caller's flush.
+ * leave frames may use the room the writer keeps free, a lost one would
+ * leave the detector occupied. false when the writer refused the frame.
+*/
+bool SimulatorCore::sendComData(bool leave)
+{
+    if (!writer_->append(com_frame_, SerialData::Size, leave))
+    {
+        return false;
+    }
+    if (capture_ != NULL)
+    {
+        capture_->append(FrameClock::usecs(), com_frame_);
+    }
+    emit frameSentSignal(QByteArray::fromRawData(com_frame_, SerialData::Size));
+    return true;
+}
+
+/* 处理流程：
+ * 1. 检查当前所有车道上是否有车辆待发————有则发车，无则继续
+ * 2. 获取当前放行相位ID和当前相位所控制的通道
+ * 3. 检查当前系统中可通行通道上有无待放行的车辆：有则放行
+ * 4. 产生随机通道号并放行。
+*/
+bool SimulatorCore::dispatch()
+{
+    unsigned char phase_id = phaseId();
+    unsigned char phase_type = getPhaseType(phase_id);
+    bool status = false;
+    switch (ctrl_mode_)
+    {
+    case FullInduction:
+        status = trafficDispatch(phase_id);
+        break;
+    case MainHalfInduction:
+        if (phase_type == 0x020)        // elasticity phase
+        {
+            status = trafficDispatch(phase_id);
+        }
+        // fix phase(0x080): did not send com msg
+        break;
+    case SecondHalfInduction:
+        if (phase_type == 0x040)        // determined phase
+        {
+            status = trafficDispatch(phase_id);
+        }
+        // elasticity phase(0x020): did not send com msg
+        break;
+    case CrossStreet:
+        if (phase_type == 0x04)         // walkman phase
+        {
+            status = trafficDispatch(phase_id);
+        }
+        // motor phase(0x01): did not send com msg
+        break;
+    case BusFirst:
+    case SingleAdapt:
+    default:
+        status = trafficDispatch(phase_id);
+        break;
+    }
+    writer_->flush();
+    return status;
+}
+
+bool SimulatorCore::trafficDispatch(unsigned int phase_id)
+{
+    if (generator_->isEnabled())
+    {
+        return generatedDispatch(phase_id);
+    }
+    if (lcDispatch().isDebugEnabled())
+    {
+        qCDebug(lcDispatch) << "dispatch-car_sent_list:";
+        dumpEnumElementList(car_sent_list_);
+    }
+    for (int i = 0; i < LANE_COUNT; i++)
+    {
+        int pre_index = pre_lane_idx_list_.at(i);
+        LightColor color = Off;//channel_detector_color_list_.at(i);
+        if (Q_LIKELY(pre_index >= 0))
+        {
+            color = channel_detector_color_list_.at(pre_index);
+        }
+        switch (car_sent_list_.at(i))
+        {
+        case Come:
+            if (isChannelAccessible(phase_id, i+1))
+            {
+                // refused by the writer: stays Come and is tried again next tick
+                packComData(i);
+                if (!sendComData())
+                {
+                    break;
+                }
+                if (pre_index >= 0 && color != Off)
+                {
+                    emit showLaneDetectorSignal(pre_index, color, false);
+                    qCDebug(lcDispatch) << "dispatch-Come--close pre lane detector:" << pre_index+1 << ",Color:" << colorPrintable(color) << "false";
+                }
+                emit showLaneDetectorSignal(i, Green, true);
+                qCDebug(lcDispatch) << "dispatch-Come--light lane detector:" << i+1 << ",Color: Green true";
+                channel_detector_color_list_[i] = Green;
+                car_sent_list_[i] = need_leave_list_.at(i) ? Go : None;
+                pre_lane_idx_list_[i] = i;
+            }
+            break;
+        case Go:
+            if (isChannelAccessible(phase_id, i+1))
+            {
+                bool leave = need_leave_list_.at(i);
+                packComData(i, leave);
+                if (!sendComData(leave))
+                {
+                    break;
+                }
+                if (pre_index >= 0)
+                {
+                    emit showLaneDetectorSignal(pre_index, color, false);
+                    qCDebug(lcDispatch) << "Go--close detector:(lane id:" << pre_index+1 << ",Color:" << colorPrintable(color) << ") false";
+                }
+                emit showLaneDetectorSignal(i, Red, true);
+                qCDebug(lcDispatch) << "Go--show detector:(lane id:" << i+1 << ",Color:Red) true";
+                need_leave_list_[i] = false;
+                channel_detector_color_list_[i] = Red;
+                car_sent_list_[i] = None;
+                pre_lane_idx_list_[i] = i;
+            }
+            break;
+        case None:
+            if (pre_index >= 0 && color != Off)
+            {
+                emit showLaneDetectorSignal(pre_index, color, false);
+                car_sent_list_[pre_index] = Other;
+                qCDebug(lcDispatch) << "None--close detector:" << pre_index+1 << ",Color:" << colorPrintable(color) << "false";
+            }
+            break;
+        case Other:
+            break;
+        default:
+            break;
+        }
+    }
+    return carArrive(phase_id, generator_->uniformLane(LANE_COUNT));
+}
+
+bool SimulatorCore::carArrive(unsigned int phase_id, int lane_idx)
+{
+    qCDebug(lcDispatch) << "rand lane id:" << lane_idx+1;
+    if (car_sent_list_.at(lane_idx) == Go)
+    {
+        qCDebug(lcDispatch) << "lane" << lane_idx+1 << " exists a car (Green)";
+        return false;
+    }
+    // backpressure: no new vehicle while the line is behind
+    if (writer_->isCongested())
+    {
+        throttled_frames_++;
+        return false;
+    }
+    car_sent_list_[lane_idx] = Come;
+    packComData(lane_idx);
+    if (isChannelAccessible(phase_id, lane_idx+1))
+    {
+        if (!sendComData())
+        {
+            car_sent_list_[lane_idx] = Other;
+            return false;
+        }
+        emit showLaneDetectorSignal(lane_idx, Green, true);
+        qCDebug(lcDispatch) << "Come--show detector:(lane id:" << lane_idx+1 << ",Color: Green) true";
+        channel_detector_color_list_[lane_idx] = Green;
+        car_sent_list_[lane_idx] = need_leave_list_.at(lane_idx) ? Go : None;
+        pre_lane_idx_list_[lane_idx] = lane_idx;
+        if (need_leave_list_.at(lane_idx))
+        {
+            timer_->start(generator_->random().bounded(1000) + 1000);
+        }
+    }
+    else
+    {
+        qCDebug(lcDispatch) << "car on lane id:" << lane_idx+1 << "can not access this channel";
+        car_sent_list_[lane_idx] = Other;
+    }
+    return true;
+}
+
+/* Generated traffic: every vehicle is an enter frame at its arrival time and,
+ * on lane detectors, a leave frame one occupancy later. A vehicle arriving
+ * while the detector is still occupied merges with the previous one.
+*/
+bool SimulatorCore::generatedDispatch(unsigned int phase_id)
+{
+    qint64 now = FrameClock::usecs();
+    bool sent = false;
+    for (int i = 0; i < leave_due_list_.size(); i++)
+    {
+        if (leave_due_list_.at(i) >= 0 && leave_due_list_.at(i) <= now)
+        {
+            packComData(i, true);
+            if (!sendComData(true))
+            {
+                continue;   // still due, tried again next tick
+            }
+            leave_due_list_[i] = -1;
+            need_leave_list_[i] = false;
+            emit showLaneDetectorSignal(i, Green, false);
+            sent = true;
+        }
+    }
+
+    QList<int> lane_list;
+    generator_->takeArrivals(now, lane_list);
+    for (int n = 0; n < lane_list.size(); n++)
+    {
+        int i = lane_list.at(n);
+        if (i >= lane_detector_id_list_.size())
+        {
+            continue;
+        }
+        if (leave_due_list_.at(i) >= 0)
+        {
+            merged_frames_++;
+            continue;
+        }
+        // backpressure: leave frames above still go out, new vehicles wait for the line
+        if (writer_->isCongested())
+        {
+            throttled_frames_++;
+            continue;
+        }
+        if (!isChannelAccessible(phase_id, i+1))
+        {
+            continue;
+        }
+        packComData(i);
+        if (!sendComData())
+        {
+            continue;
+        }
+        emit showLaneDetectorSignal(i, Green, true);
+        if (need_leave_list_.at(i))
+        {
+            leave_due_list_[i] = now + generator_->occupancyUs(i);
+        }
+        else
+        {
+            emit showLaneDetectorSignal(i, Green, false);
+        }
+        sent = true;
+    }
+    return sent;
+}
+
+bool SimulatorCore::isChannelAccessible(unsigned int phase_id, unsigned char channel_id)
+{
+    QList<unsigned char> channel_id_list = phase_handler_->get_phase_ctrled_channel_list(phase_id);
+    if (channel_id_list.isEmpty())
+    {
+        return false;
+    }
+    if (!channel_id_list.contains(channel_id))
+    {
+        return false;
+    }
+    return true;
+}
+
+void SimulatorCore::initTrafficDispatcher()
+{
+    for (int i = 0; i < 16; i++)
+    {
+        car_sent_list_.append(Other);
+        channel_detector_color_list_.append(Off);
+        pre_lane_idx_list_.append(-1);
+        need_leave_list_.append(false);
+        leave_due_list_.append(-1);
+    }
+}
+
+QString SimulatorCore::colorPrintable(SimulatorCore::LightColor color)
+{
+    QString str;
+    switch(color)
+    {
+    case Red:
+        str = "Red";
+        break;
+    case Yellow:
+        str = "Yellow";
+        break;
+    case Green:
+        str = "Green";
+        break;
+    case Off:
+        str = "Off";
+        break;
+    case Invalid:
+        str = "Invalid";
+        break;
+    default:
+        str = "-";
+        break;
+    }
+    return str;
+}
+
+QString SimulatorCore::carStatusPrintable(SimulatorCore::CarStatus status)
+{
+    QString str;
+    switch (status)
+    {
+    case Come:
+        str = "Come";
+        break;
+    case Go:
+        str = "Go";
+        break;
+    case None:
+        str = "None";
+        break;
+    case Other:
+        str = "Other";
+        break;
+    default:
+        str = "-";
+        break;
+    }
+    return str;
+}
+
+void SimulatorCore::dumpEnumElementList(const QList<SimulatorCore::CarStatus> &list)
+{
+    int cnt = list.size();
+    if (cnt <= 0)
+    {
+        return;
+    }
+    QString str;
+    for (int i = 0; i < cnt; i++)
+    {
+        str += QString::number(i+1) + "-" + carStatusPrintable(list.at(i)) + " ";
+    }
+    qCDebug(lcDispatch) << str;
+}
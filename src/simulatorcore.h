@@ -0,0 +1,136 @@
+#ifndef SIMULATORCORE_H
+#define SIMULATORCORE_H
+
+#include <QObject>
+#include <QList>
+#include <QByteArray>
+#include "serialdata.h"
+#include "databasestore.h"
+
+class QIODevice;
+class QTimer;
+class PhaseHandler;
+class FrameWriter;
+class ArrivalGenerator;
+class CaptureFile;
+
+#define LANE_COUNT  12
+
+/* Widget-free traffic engine.
+ * Inputs are plain data (lane detector ids, control mode and running phase
+ * reported by the signaler), outputs are detector frames written to the
+ * attached device plus detector display signals for an optional UI.
+*/
+class SimulatorCore : public QObject
+{
+    Q_OBJECT
+    friend class SimulatorBench;
+public:
+    explicit SimulatorCore(QObject *parent = 0);
+    ~SimulatorCore();
+
+    enum LightColor
+    {
+        Red = 0,
+        Yellow,
+        Green,
+        Off,
+        Invalid
+    };
+
+    enum CarStatus
+    {
+        Come = 0, Go = 1, None = 2, Other = 3
+    };
+
+    // values of the work mode / control mode byte in CYT3 and CYT5
+    enum CtrlMode
+    {
+        FullInduction = 5,
+        MainHalfInduction = 6,
+        SecondHalfInduction = 7,
+        SingleAdapt = 8,
+        CrossStreet = 9,
+        BusFirst = 27
+    };
+
+    void initDatabase(MDatabase *db);
+    void initDatabase(const DatabaseStore::Snapshot &snapshot);
+    void setDevice(QIODevice *device);
+    void setLaneDetectorIdList(const QList<int> &id_list);
+    void setCtrlMode(unsigned char ctrl_mode);
+    void setPhaseIds(unsigned int phase_ids);
+    ArrivalGenerator *arrivalGenerator() const;
+    FrameWriter *frameWriter() const;
+
+    unsigned char ctrlMode() const;
+    unsigned int phaseId() const;
+
+    void start(int interval_ms);
+    void stop();
+    bool isRunning() const;
+    bool dispatch();
+
+    static unsigned int phaseIdOfBits(unsigned int phase_ids);
+
+    bool startCapture(const QString &path);
+    void stopCapture();
+    bool isCapturing() const;
+
+    // output pacing
+    int queuedFrames() const;
+    qint64 droppedFrames() const;
+    qint64 mergedFrames() const;
+    QString pacingSummary() const;
+
+signals:
+    // frame points into the engine, copy it if it is kept beyond the call
+    void frameSentSignal(const QByteArray &frame);
+    void showLaneDetectorSignal(int index, int color, bool show);
+
+private slots:
+    void sendMsgTimerTimeOutSlot();
+    void timerTimeOutSlot();
+
+private:
+    unsigned char getPhaseType(unsigned char phase_id);
+    void packComData(int lane_index, bool leave = false);
+    bool sendComData(bool leave = false);
+
+    // dispatch car
+    bool trafficDispatch(unsigned int phase_id);
+    bool carArrive(unsigned int phase_id, int lane_idx);
+    bool generatedDispatch(unsigned int phase_id);
+    bool isChannelAccessible(unsigned int phase_id, unsigned char channel_id);
+    void initTrafficDispatcher();
+
+    QString colorPrintable(LightColor color);
+    QString carStatusPrintable(CarStatus status);
+    void dumpEnumElementList(const QList<CarStatus> &list);
+
+private:
+    QList<CarStatus> car_sent_list_;    // index+1 present channel_id
+    QList<LightColor> channel_detector_color_list_; // index+1 present channel id
+    QList<bool> need_leave_list_;       // index+1 present channel_id
+    QList<int> pre_lane_idx_list_;
+    QList<int> lane_detector_id_list_;
+    QList<qint64> leave_due_list_;      // generated traffic: FrameClock us of the leave frame, -1 free
+
+    char com_frame_[SerialData::Size];
+    unsigned char ctrl_mode_;
+    unsigned int phase_ids_;
+    qint64 throttled_frames_;   // arrivals not generated while the writer is congested
+    qint64 merged_frames_;      // arrivals on a still occupied detector
+
+    QTimer *send_msg_timer_;
+    QTimer *timer_;     // car leave timer
+
+    FrameWriter *writer_;
+    ArrivalGenerator *generator_;
+    CaptureFile *capture_;      // NULL when not capturing
+    const MDatabase *db_;
+    DatabaseStore::Snapshot snapshot_;  // keeps db_ alive, NULL for a database set directly
+    PhaseHandler *phase_handler_;
+};
+
+#endif // SIMULATORCORE_H
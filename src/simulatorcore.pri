@@ -0,0 +1,79 @@
+# traffic engine, config database and controller sessions, no QtWidgets dependency.
+# shared by the gui, the headless console and the monitor targets.
+
+QT += network
+
+INCLUDEPATH += $$PWD $$PWD/qextserialport
+
+SOURCES += \
+    $$PWD/simulatorcore.cpp \
+    $$PWD/framewriter.cpp \
+    $$PWD/framesink.cpp \
+    $$PWD/frameclock.cpp \
+    $$PWD/fastrandom.cpp \
+    $$PWD/arrivalgenerator.cpp \
+    $$PWD/capturefile.cpp \
+    $$PWD/capturereplayer.cpp \
+    $$PWD/tracefile.cpp \
+    $$PWD/tracereplayer.cpp \
+    $$PWD/cytparser.cpp \
+    $$PWD/cytdecoder.cpp \
+    $$PWD/configdownload.cpp \
+    $$PWD/tscparam.cpp \
+    $$PWD/tscimage.cpp \
+    $$PWD/compactconfig.cpp \
+    $$PWD/configcache.cpp \
+    $$PWD/filereaderwriter.cpp \
+    $$PWD/mdatabase.cpp \
+    $$PWD/databasestore.cpp \
+    $$PWD/timingparam.cpp \
+    $$PWD/timesection.cpp \
+    $$PWD/phasetiming.cpp \
+    $$PWD/phaseparam.cpp \
+    $$PWD/phaseconflictparam.cpp \
+    $$PWD/detectorparam.cpp \
+    $$PWD/channelparam.cpp \
+    $$PWD/scheduleparam.cpp \
+    $$PWD/phasehandler.cpp \
+    $$PWD/synccommand.cpp \
+    $$PWD/sessionmanager.cpp \
+    $$PWD/command.cpp \
+    $$PWD/qextserialport/qextserialbase.cpp
+
+HEADERS += \
+    $$PWD/simulatorcore.h \
+    $$PWD/framewriter.h \
+    $$PWD/framesink.h \
+    $$PWD/frameclock.h \
+    $$PWD/fastrandom.h \
+    $$PWD/arrivalgenerator.h \
+    $$PWD/capturefile.h \
+    $$PWD/capturereplayer.h \
+    $$PWD/tracefile.h \
+    $$PWD/tracereplayer.h \
+    $$PWD/cytparser.h \
+    $$PWD/cytdecoder.h \
+    $$PWD/configdownload.h \
+    $$PWD/serialdata.h \
+    $$PWD/tscparam.h \
+    $$PWD/tscimage.h \
+    $$PWD/compactconfig.h \
+    $$PWD/configcache.h \
+    $$PWD/tsc.h \
+    $$PWD/filereaderwriter.h \
+    $$PWD/mdatabase.h \
+    $$PWD/databasestore.h \
+    $$PWD/timingparam.h \
+    $$PWD/timesection.h \
+    $$PWD/scheduleparam.h \
+    $$PWD/phasetiming.h \
+    $$PWD/phaseparam.h \
+    $$PWD/phaseconflictparam.h \
+    $$PWD/detectorparam.h \
+    $$PWD/channelparam.h \
+    $$PWD/phasehandler.h \
+    $$PWD/synccommand.h \
+    $$PWD/sessionmanager.h \
+    $$PWD/command.h \
+    $$PWD/macrostrings.h \
+    $$PWD/qextserialport/qextserialbase.h
@@ -0,0 +1,27 @@
+# widgets and the windows serial port.
+# shared by the gui and the benchmark target.
+
+SOURCES += \
+    $$PWD/qextserialport/win_qextserialport.cpp \
+    $$PWD/qextserialport/qextserialport.cpp \
+    $$PWD/roadbranchwidget.cpp \
+    $$PWD/mutility.cpp \
+    $$PWD/detectorideditwidget.cpp \
+    $$PWD/detectoriddelegate.cpp \
+    $$PWD/simulatorwidget.cpp \
+    $$PWD/xmlhelper.cpp \
+    $$PWD/signalerparam.cpp \
+    $$PWD/testdlg.cpp
+
+HEADERS += \
+    $$PWD/qextserialport/win_qextserialport.h \
+    $$PWD/qextserialport/qextserialport.h \
+    $$PWD/roadbranchwidget.h \
+    $$PWD/mutility.h \
+    $$PWD/detectorideditwidget.h \
+    $$PWD/utilmacros.h \
+    $$PWD/detectoriddelegate.h \
+    $$PWD/simulatorwidget.h \
+    $$PWD/xmlhelper.h \
+    $$PWD/signalerparam.h \
+    $$PWD/testdlg.h
@@ -1,11 +1,11 @@
 #include "simulatorwidget.h"
 #include "macrostrings.h"
-#include "serialdata.h"
 #include "mutility.h"
 #include "detectorideditwidget.h"
 #include "xmlhelper.h"
 #include "synccommand.h"
-#include "filereaderwriter.h"
+#include "sessionmanager.h"
+#include "simulatorcore.h"
 
 #include "testdlg.h"
 
@@ -18,6 +18,7 @@
 #include <QComboBox>
 #include <QGroupBox>
 #include <QSpinBox>
+#include <QCheckBox>
 #include <QLabel>
 #include <QLCDNumber>
 #include <QMessageBox>
@@ -26,9 +27,6 @@
 #include <QTimer>
 #include <QDebug>
 
-#define CONN_WAIT_MS    3000
-#define VERSION_CHECK_MS    5000
-
 #define SIGNALER_TIME_UPDATE(str) \
     signaler_time_label_->setText("<font size=4>" + str + "</font>");
 
@@ -39,38 +37,32 @@ SimulatorWidget::SimulatorWidget(QWidget *parent) :
     my_com_ = new Win_QextSerialPort("com1", my_com_setting_, QextSerialBase::EventDriven);
     detector_edit_dlg_ = new DetectorIdEditWidget(this);
 
-    curr_lane_idx_ = 0;
-    curr_lane_id_ = 0;
     serial_status_ = false;
-    send_msg_timer_ = new QTimer(this);
-    timer_ = new QTimer(this);
-    need_leave_ = false;
 
     port_ = 0;
-    sync_cmd_ = SyncCommand::GetInstance();
+    cfg_max_age_ = CONFIG_CACHE_MAX_AGE;
+    sync_cmd_ = NULL;
+    session_mgr_ = new SessionManager(0, this);
+    session_mgr_->setConfigCache(&cfg_cache_);
     conn_status_ = false;
-    ver_check_id_ = 0;
     is_inited_ = false;
-    ui_timer_id_ = 0;
-    is_uitimer_started_ = false;
 
     curr_stage_id_ = 0;
     total_stage_count_ = 0;
     count_down_secs_ = 0;
     count_down_light_ = 4;
 
-    conn_timer_ = new QTimer(this);
     count_down_timer_ = new QTimer(this);
     signaler_timer_ = new QTimer(this);
-    sec_count_ = 0;
 
     test_dlg_ = new TestDlg(this);
-    pre_lane_idx_ = 0;
 
     db_ptr_ = MDatabase::GetInstance();
-    phase_handler_ = new PhaseHandler;
+    core_ = new SimulatorCore(this);
+    core_->setDevice(my_com_);
 
     is_first_ = true;
+    lights_valid_ = false;
     is_first_send_ = true;
     is_first_end_ = true;
 
@@ -78,29 +70,17 @@ SimulatorWidget::SimulatorWidget(QWidget *parent) :
     initPage();
     initSignalSlots();
     initCtrlModeDesc();
-    initPreDetectorColorList();
-    initRedDetectorFlagList();
-    initTrafficDispatcher();
+    initReplyHandlers();
     setFixedSize(826+170,606);
     start_button_->setEnabled(false);
 }
 
 SimulatorWidget::~SimulatorWidget()
 {
-    if (timer_ != NULL)
-    {
-        delete timer_;
-        timer_ = NULL;
-    }
     if (db_ptr_ != NULL)
     {
         db_ptr_->DestroyInstance();
     }
-    if (phase_handler_ != NULL)
-    {
-        delete phase_handler_;
-        phase_handler_ = NULL;
-    }
 }
 
 void SimulatorWidget::initialize()
@@ -119,12 +99,18 @@ void SimulatorWidget::initialize()
     }
     ip_ = helper->ParseXmlNodeContent("ip");
     port_ = helper->ParseXmlNodeContent("port").toInt();
+    QString max_age = helper->ParseXmlNodeContent("configmaxage");
+    if (!max_age.isEmpty())
+    {
+        cfg_max_age_ = max_age.toInt();
+    }
     ip_lineedit_->setText(ip_);
     port_lineedit_->setText(QString::number(port_));
     QString str = date_time_.toString("yyyy-MM-dd hh:mm:ss");
     SIGNALER_TIME_UPDATE(str)
 
-    cfg_file_ = MUtility::getTempDir() + ip_ + ".dat";
+    cfg_cache_.open(MUtility::getTempDir() + "configcache/");
+    cfg_key_ = ConfigCache::controllerKey(ip_, port_);
 
     show();
 }
@@ -142,7 +128,7 @@ void SimulatorWidget::startSimulatorToggledSlot(bool checked)
         QMessageBox::information(this, STRING_TIP, STRING_UI_START_WITHOUT_CONN, STRING_OK);
         return;
     }
-    int phase_id = curr_phase_id_label_->text().trimmed().toInt();
+    unsigned int phase_id = core_->phaseId();
     if (checked && phase_id == 0)
     {
         start_button_->setChecked(!checked);
@@ -154,110 +140,36 @@ void SimulatorWidget::startSimulatorToggledSlot(bool checked)
         initMyComSetting();
         emit enableDetectorIdCmbSignal(false);
         timespan_spinbox_->setEnabled(false);
+        capture_checkbox_->setEnabled(false);
         start_button_->setText(STRING_UI_STOP);
-        if (!simualtorComdataDispatcher())
+        if (core_->isRunning())
         {
             return;
         }
+        if (capture_checkbox_->isChecked())
+        {
+            core_->startCapture(MUtility::getTempDir() + ip_ + QDateTime::currentDateTime().toString("_yyyyMMdd_hhmmss") + ".cap");
+        }
+        core_->setLaneDetectorIdList(road_branch_widget_->getLaneDetectorIdList());
         int secs = timespan_spinbox_->value();
-        send_msg_timer_->start(secs*1000);
-//        if (need_leave_)
-//        {
-//            timer_->start(qrand() % 1000 + 1000);
-//        }
-//        txt_edit_->insertPlainText(formatComData(com_array_)+"\n");
+        core_->start(secs*1000);
     }
     else
     {
         start_button_->setText(STRING_UI_START);
-        send_msg_timer_->stop();
-        timer_->stop();
+        core_->stop();
+        core_->stopCapture();
+        txt_edit_->insertPlainText(core_->pacingSummary() + "\n");
         enableComSetting(true);
         emit enableDetectorIdCmbSignal(true);
         timespan_spinbox_->setEnabled(true);
+        capture_checkbox_->setEnabled(true);
     }
 }
 
-void SimulatorWidget::sendMsgTimerTimeOutSlot()
+void SimulatorWidget::comDataSentSlot(const QByteArray &array)
 {
-    if (timer_->isActive())
-    {
-        return;
-    }
-    qDebug() << "new car come";
-    startSimulatorToggledSlot(true);
-}
-/* 1. 检查当前车道是否在当前相位的所控制的通道中且为可通行状态
- * 2. 如果可通行则放行，否则等待计时器清零，什么也不做。
-*/
-void SimulatorWidget::timerTimeOutSlot()
-{
-    timer_->stop();
-    unsigned int phase_id = curr_phase_id_label_->text().trimmed().toUInt();
-    for (int i = 0; i < 12; i++)
-    {
-        int pre_idx =  pre_lane_idx_list_.at(i);
-        if (isChannelAccessible(phase_id, i+1) && pre_idx >= 0)
-        {
-            qDebug() << "Leave--(phase_id:" << phase_id << ", channel_id:" << i+1 << ") accessible" ;
-            if ((car_sent_list_.at(i) == Go) && need_leave_list_.at(i))
-            {
-                qDebug() << "Leave--close pre detector:" << pre_idx+1 << ",Color:" << colorPrintable(channel_detector_color_list_.at(pre_idx))
-                         << "false, light detector:" << pre_idx+1 << "Color: Red";
-                packComData(pre_lane_idx_list_.at(i));
-                need_leave_list_[pre_lane_idx_list_.at(i)] = false;
-                com_array_[1] = 0x02 + '\0';
-                char ms[4] = {'\0'};
-                int secs = QDateTime::currentDateTime().toTime_t();
-                memcpy(ms, &secs, sizeof(secs));
-                com_array_[3] = ms[0];
-                com_array_[4] = ms[1];
-                txt_edit_->insertPlainText(formatComData(com_array_)+"\n");
-                emit showLaneDetectorSignal(pre_idx, channel_detector_color_list_.at(pre_idx), false);
-                emit showLaneDetectorSignal(pre_idx, RoadBranchWidget::Red, true);
-                channel_detector_color_list_[i] = Red;
-                car_sent_list_[i] = None;
-                my_com_->write(com_array_);
-            }
-            else if ((car_sent_list_.at(i) == None) && !need_leave_list_.at(i))
-            {
-                qDebug() << "Leave--close only pre detector:" << pre_lane_idx_list_.at(i)+1 << ",Color:" << colorPrintable(channel_detector_color_list_.at(i)) << " false";
-                packComData(pre_lane_idx_list_.at(i));
-                need_leave_list_[pre_lane_idx_list_.at(i)] = false;
-                txt_edit_->insertPlainText(formatComData(com_array_)+"\n");
-                emit showLaneDetectorSignal(pre_lane_idx_list_.at(i), channel_detector_color_list_.at(i), false);
-                channel_detector_color_list_[i] = Off;
-                car_sent_list_[i] = Other;
-                my_com_->write(com_array_);
-            }
-        }
-    }
-
-    /*
-    timer_->stop();
-    unsigned int phase_id = curr_phase_id_label_->text().trimmed().toInt();
-    QList<unsigned char> channel_id_list = phase_handler_->get_phase_ctrled_channel_list(phase_id);
-    if (channel_id_list.contains(pre_lane_idx_+1))
-    {
-        // TODO: send msg
-        packComData(pre_lane_idx_);
-        need_leave_ = false;
-        com_array_[1] = 0x02 + '\0';
-        char ms[4] = {'\0'};
-        int secs = QDateTime::currentDateTime().toTime_t();
-        memcpy(ms, &secs, sizeof(secs));
-        com_array_[3] = ms[0];
-        com_array_[4] = ms[1];
-        txt_edit_->insertPlainText(formatComData(com_array_)+"\n");
-        emit showLaneDetectorSignal(curr_lane_idx_, RoadBranchWidget::Green, false);
-        emit showLaneDetectorSignal(curr_lane_idx_, RoadBranchWidget::Red, true);
-        detector_red_flag_list_[curr_lane_idx_] = 0;
-        my_com_->write(com_array_);
-    }
-    else
-    {
-        return;
-    }*/
+    txt_edit_->insertPlainText(formatComData(array)+"\n");
 }
 
 void SimulatorWidget::openSerialTriggeredSlot(bool checked)
@@ -311,29 +223,25 @@ void SimulatorWidget::connectButtonClicked()
     ip_ = MUtility::trimmedAll(ip_);
     port_ = port_lineedit_->text().toInt();
     conn_tip_label_->clear();
-    if (conn_status_)
+    if (sync_cmd_ != NULL && sync_cmd_->connState() != SyncCommand::Unconnected)
     {
-        if (ver_check_id_ == 0 && is_first_end_)
+        if (sync_cmd_->isMonitoring())
         {
             sync_cmd_->StopMonitoring();
             is_first_end_ = false;
         }
         sync_cmd_->disconnectFromHost();
-        if (ver_check_id_ != 0)
-        {
-            killTimer(ver_check_id_);
-            ver_check_id_ = 0;
-            conn_status_ = false;
-        }
+        conn_status_ = false;
         conn_tip_label_->setText(STRING_NETWORK_DISCONNECTED);
         conn_button_->setText(STRING_UI_CONNECT);
         start_button_->setChecked(false);
     }
     else
     {
-        sync_cmd_->connectToHost(ip_, port_);
-        conn_timer_->start(CONN_WAIT_MS);
-        conn_button_->setEnabled(false);
+        // the link is kept up by sync_cmd_ until Disconnect is clicked
+        cfg_key_ = ConfigCache::controllerKey(ip_, port_);
+        openSession();
+        conn_button_->setText(STRING_UI_DISCONNECT);
         conn_tip_label_->setText(STRING_UI_CONNECT + "...");
     }
 
@@ -342,39 +250,66 @@ void SimulatorWidget::connectButtonClicked()
 #endif
 }
 
+// the session of ip_:port_, a session of another controller is closed
+void SimulatorWidget::openSession()
+{
+    if (sync_cmd_ != NULL && sync_cmd_ == session_mgr_->session(ip_, port_))
+    {
+        sync_cmd_->openConnection();
+        return;
+    }
+    if (sync_cmd_ != NULL)
+    {
+        disconnect(sync_cmd_, 0, this, 0);
+        disconnect(sync_cmd_, 0, conn_tip_label_, 0);
+        session_mgr_->closeSession(sync_cmd_);
+    }
+    sync_cmd_ = session_mgr_->openSession(ip_, port_);
+    test_dlg_->setSession(sync_cmd_);
+    connect(sync_cmd_, SIGNAL(connectedSignal()), this, SLOT(connectEstablishedSlot()));
+    connect(sync_cmd_, SIGNAL(disconnectedSignal()), this, SLOT(disconnectedSlot()));
+    connect(sync_cmd_, SIGNAL(connectErrorStrSignal(QString)), conn_tip_label_, SLOT(setText(QString)));
+    connect(sync_cmd_, SIGNAL(reconnectingSignal(int)), this, SLOT(reconnectingSlot(int)));
+}
+
 void SimulatorWidget::clearButtonClicked()
 {
     // TODO: clear traffic light status
     road_branch_widget_->closeLightSlot();
+    lights_valid_ = false;
 }
 
 void SimulatorWidget::connectEstablishedSlot()
 {
     conn_status_ = true;
-    conn_button_->setEnabled(true);
     conn_button_->setText(STRING_UI_DISCONNECT);
-    conn_timer_->stop();
-    sync_cmd_->ReadTscVersion(this, SLOT(onCmdGetVerIdSlot(QByteArray&)));
-    conn_tip_label_->setText(STRING_NETWORK_VERSION_CHECK);
-    if (ver_check_id_ == 0)
+    if (sync_cmd_->isMonitoring())
     {
-        ver_check_id_ = startTimer(VERSION_CHECK_MS);
+        // reconnected, sync_cmd_ has already asked for the pushes again
+        conn_tip_label_->setText(STRING_NETWORK_VERSION_RIGHT);
+        return;
     }
+    sync_cmd_->ReadTscVersion(this, SLOT(onCmdGetVerIdSlot(QByteArray&)));
+    conn_tip_label_->setText(STRING_NETWORK_VERSION_CHECK);
 }
 
 void SimulatorWidget::disconnectedSlot()
 {
-    if (ver_check_id_ != 0)
+    conn_status_ = false;
+    if (sync_cmd_->connState() != SyncCommand::Unconnected)
     {
-        killTimer(ver_check_id_);
-        ver_check_id_ = 0;
+        return;     // reconnectingSlot tells when the next attempt is made
     }
-    conn_status_ = false;
     conn_tip_label_->setText(STRING_NETWORK_DISCONNECTED);
     conn_button_->setText(STRING_UI_CONNECT);
     clear_status_button_->setEnabled(true);
 }
 
+void SimulatorWidget::reconnectingSlot(int msecs)
+{
+    conn_tip_label_->setText(STRING_NETWORK_RECONNECTING.arg((msecs + 999) / 1000));
+}
+
 void SimulatorWidget::connectErrorSlot(const QString &str)
 {
     conn_tip_label_->setText(str);
@@ -390,228 +325,112 @@ void SimulatorWidget::onCmdGetVerIdSlot(QByteArray &array)
         return;
     }
 
-    if (ver_check_id_ != 0)
-    {
-        killTimer(ver_check_id_);
-        ver_check_id_ = 0;
-    }
     conn_tip_label_->setText(STRING_NETWORK_VERSION_RIGHT);
 //    sync_cmb_->ReleaseSignalSlots();
-    cfg_array_.clear();
-    recv_array_.clear();
+    parser_.clear();
+    lights_valid_ = false;
     count_down_timer_->start(1000);
-    sync_cmd_->ReadSignalerConfigFile(this, SLOT(onCmdReadConfigFileSlot(QByteArray&)));
+    // the cached config shows at once, the download below revalidates it
+    if (cfg_cache_.contains(cfg_key_) && cfg_hash_ != cfg_cache_.hash(cfg_key_) && initTscParam())
+    {
+        updateScheduleInfo();
+    }
+    // opt-in: a config confirmed lately is trusted, pushes keep it current
+    if (!cfg_hash_.isEmpty() && session_mgr_->isConfigFresh(sync_cmd_, cfg_max_age_))
+    {
+        sync_cmd_->GetLightStatus(this, SLOT(onCmdParseParam(QByteArray&)));
+        return;
+    }
+    session_mgr_->requestConfig(sync_cmd_);
 }
 
-void SimulatorWidget::onCmdReadConfigFileSlot(QByteArray &array)
+void SimulatorWidget::configProgressSlot(SyncCommand *session, int received, int total)
 {
-    cfg_array_.append(array);
-    if (!cfg_array_.left(4).contains("CYT4"))
+    if (session != sync_cmd_ || total <= 0)
     {
-        cfg_array_.clear();
-        sync_cmd_->ReadEventLogFile(this, SLOT(onCmdReadConfigFileSlot(QByteArray&)));
         return;
     }
-    if (!cfg_array_.contains("END"))
+    conn_tip_label_->setText(STRING_NETWORK_CONFIG_PROGRESS.arg(received * 100 / total));
+}
+
+// downloaded or pushed, session_mgr_ has cached it
+void SimulatorWidget::configReceivedSlot(SyncCommand *session)
+{
+    if (session != sync_cmd_)
     {
         return;
     }
-    bool res = parseConfigContent(cfg_array_);
-    int ret = -1;
-    if (!res)
+    conn_tip_label_->setText(STRING_NETWORK_VERSION_RIGHT);
+    // an unchanged config stays loaded
+    if (cfg_hash_ != cfg_cache_.hash(cfg_key_) && initTscParam())
     {
-        ret = QMessageBox::question(this, STRING_TIP, STRING_NETWORK_CONFIG_RETRY, STRING_YES, STRING_NO);
-        if (ret == 0)
-        {
-            cfg_array_.clear();
-            sync_cmd_->ReadSignalerConfigFile(this, SLOT(onCmdReadConfigFileSlot(QByteArray&)));
-        }
-        else
-        {
-            cfg_array_.clear();
-            // TODO: update ui
-            if (initTscParam())
-            {
-                updateScheduleInfo();
-            }
-            return;
-        }
+        updateScheduleInfo();
     }
-    else
+    if (!sync_cmd_->isMonitoring())
     {
-        QFile file(cfg_file_);
-retry:  if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate))
-        {
-            ret = QMessageBox::question(this, STRING_TIP, STRING_NETWORK_CFG_TEMP_SAVE, STRING_YES, STRING_NO);
-            if (ret == 0)
-            {
-                goto retry;
-            }
-            else
-            {
-                QFile::remove(cfg_file_);
-            }
-        }
-        else
-        {
-            file.write(cfg_array_);
-            file.close();
-            // TODO: update schedule info
-            if (initTscParam())
-            {
-                updateScheduleInfo();
-            }
-            sync_cmd_->GetLightStatus(this, SLOT(onCmdParseParam(QByteArray&)));
-        }
+        sync_cmd_->GetLightStatus(this, SLOT(onCmdParseParam(QByteArray&)));
     }
 }
 
-void SimulatorWidget::onCmdParseParam(QByteArray &array)
+void SimulatorWidget::configFailedSlot(SyncCommand *session, const QString &error)
 {
-    recv_array_.append(array);
-    if (!checkPackage(recv_array_))
+    if (session != sync_cmd_)
     {
         return;
     }
-    if (!(recv_array_.left(3).contains("CYT") && recv_array_.contains("END")))
+    qDebug() << "config download failed:" << error;
+    int ret = QMessageBox::question(this, STRING_TIP, STRING_NETWORK_CONFIG_RETRY, STRING_YES, STRING_NO);
+    if (ret == 0)
     {
+        session_mgr_->requestConfig(sync_cmd_);
         return;
     }
-    bool status = false;
-    char cmd_id = '\0';
-    while (true)
+    // TODO: update ui
+    if (cfg_cache_.contains(cfg_key_) && cfg_hash_ != cfg_cache_.hash(cfg_key_) && initTscParam())
+    {
+        updateScheduleInfo();
+    }
+    if (!cfg_hash_.isEmpty() && !sync_cmd_->isMonitoring())
+    {
+        // monitor with the cached config
+        sync_cmd_->GetLightStatus(this, SLOT(onCmdParseParam(QByteArray&)));
+    }
+}
+
+void SimulatorWidget::onCmdParseParam(QByteArray &array)
+{
+    parser_.feed(array);
+    QByteArray message;
+    CytParser::Result result = CytParser::NeedMore;
+    while ((result = parser_.next(message)) != CytParser::NeedMore)
     {
-        if (recv_array_.size() < 4)
+        if (result == CytParser::ErrorReply)
         {
-            break;
+            checkPackage(message);
+            continue;
         }
-        if (!(recv_array_.contains("CYT") || recv_array_.contains("END")))
+        char cmd_id = CytParser::commandId(message);
+        ReplyHandler handler = reply_handler_map_.value(cmd_id, NULL);
+        if (handler == NULL)
         {
-            recv_array_.clear();
-            break;
+            continue;
         }
-        cmd_id = recv_array_.at(3);
-        switch (cmd_id)
+        if (!(this->*handler)(CytParser::payload(message)))
         {
-        case '0':
-            break;
-        case '1':
-            status = parseBeginMonitorContent(recv_array_);
-            if (!status)
-            {
-                QMessageBox::information(this, STRING_TIP, STRING_NETWORK_PARSE_ERROR + "(CYT1)", STRING_OK);
-            }
-            break;
-        case '2':
-            break;
-        case '3':
-            status = parseLightStatusContent(recv_array_);
-            if (!status)
-            {
-                QMessageBox::information(this, STRING_TIP, STRING_NETWORK_PARSE_ERROR + "(CYT3)", STRING_OK);
-            }
-            else if (is_first_)
-            {
-                sync_cmd_->GetTscTime();
-                if (!is_uitimer_started_)
-                {
-                    ui_timer_id_ = startTimer(3600*1000);
-                    is_uitimer_started_ = true;
-                }
-                is_first_ = false;
-            }
-            break;
-        case '4':
-            status = parseConfigContent(recv_array_);
-            if (status)
-            {
-                QFile file(cfg_file_+".tmp");
-                file.open(QIODevice::WriteOnly);
-                file.write(recv_array_);
-                file.close();
-                recv_array_.clear();
-            }
-            break;
-        case '5':
-            status = parseCountDownContent(recv_array_);
-            if (!status)
-            {
-                QMessageBox::information(this, STRING_OK, STRING_NETWORK_PARSE_ERROR + "(CYT5)", STRING_OK);
-            }
-            break;
-        case '6':
-            break;
-        case '7':
-            status = parseTSCTimeContent(recv_array_);
-            if (!status)
-            {
-                QMessageBox::information(this, STRING_TIP, "Parse tsc time failed.", STRING_OK);
-            }
-            else/* if (!is_inited_)*/
-            {
-                if (initTscParam())
-                {
-                    updateScheduleInfo();
-                }
-                signaler_timer_->start(1000);
-                sync_cmd_->StartMonitoring();
-                is_inited_ = true;
-            }
-            break;
-        case '8':
-            break;
-        case '9':
-            status = parseDetectorFlowContent(recv_array_);
-            break;
-        case 'A':
-            status = parseDetectorFaultContent(recv_array_);
-            break;
-        case 'B':
-            status = parseRealTimeFlowContent(recv_array_);
-            break;
-        case 'C':
-            status = parseDriverStatusContent(recv_array_);
-            break;
-        case 'D':
-            status = parseDriverRealtimeStatusContent(recv_array_);
-            break;
-        case 'E':
-            status = parseLightRealTimeStatusContent(recv_array_);
-            break;
-        case 'F':
-            status = parseAllLightOnContent(recv_array_);
-            if (!status)
-            {
-                QMessageBox::information(this, STRING_TIP, STRING_NETWORK_PARSE_ERROR + "(CYTF)", STRING_OK);
-            }
-            break;
-        default:
-            break;
+            QMessageBox::information(this, STRING_TIP, STRING_NETWORK_PARSE_ERROR + QString("(CYT%1)").arg(QChar(cmd_id)), STRING_OK);
         }
     }
 }
 
-void SimulatorWidget::connTimerTimeoutSlot()
-{
-    conn_timer_->stop();
-    if (sync_cmd_->isConnectionValid())
-    {
-        sync_cmd_->closeConnection();
-        conn_tip_label_->setText(STRING_NETWORK_HOST_UNREACHABLE);
-        conn_button_->setEnabled(true);
-    }
-}
-
 void SimulatorWidget::signalerTimerTimeoutSlot()
 {
     date_time_ = date_time_.addSecs(1);
     QString str = date_time_.toString("yyyy-MM-dd hh:mm:ss");
     SIGNALER_TIME_UPDATE(str)
-    sec_count_++;
-    if (sec_count_ % 3 == 0)
+    // the schedule can only change at an event start or at midnight
+    if (next_schedule_change_.isValid() && date_time_ >= next_schedule_change_)
     {
         updateScheduleInfo();
-        sec_count_ = 0;
     }
 }
 
@@ -643,24 +462,15 @@ void SimulatorWidget::countDownTimerTimeoutSlot()
 
 void SimulatorWidget::closeEvent(QCloseEvent *)
 {
-    if (timer_->isActive())
-    {
-        timer_->stop();
-    }
-    if (send_msg_timer_->isActive())
-    {
-        send_msg_timer_->stop();
-    }
-    if (!(ver_check_id_ == 0 && conn_status_ == false))
-    {
-        sync_cmd_->StopMonitoring();
-    }
-    else
+    core_->stop();
+    if (sync_cmd_ != NULL)
     {
-        killTimer(ver_check_id_);
-        ver_check_id_ = 0;
+        if (sync_cmd_->isMonitoring())
+        {
+            sync_cmd_->StopMonitoring();
+        }
+        sync_cmd_->disconnectFromHost();
     }
-    sync_cmd_->disconnectFromHost();
     XmlHelper *helper = XmlHelper::GetInstance();
     ip_ = MUtility::trimmedAll(ip_lineedit_->text());
     QString str = port_lineedit_->text().trimmed();
@@ -669,18 +479,6 @@ void SimulatorWidget::closeEvent(QCloseEvent *)
     helper->DestroyInstance();
 }
 
-void SimulatorWidget::timerEvent(QTimerEvent *)
-{
-    if (ver_check_id_ != 0)
-    {
-        connectEstablishedSlot();
-    }
-    if (ui_timer_id_ != 0)
-    {
-        sync_cmd_->GetTscTime();
-    }
-}
-
 void SimulatorWidget::initPage()
 {
     initComSettingLayout();
@@ -712,24 +510,22 @@ void SimulatorWidget::initSignalSlots()
     connect(this, SIGNAL(showLightSignal(int, int)), road_branch_widget_, SLOT(laneIndexSlot(int, int)));
 //    connect(this, SIGNAL(closeLightSignal()), road_branch_widget_, SLOT(closeLightSlot()));
     connect(this, SIGNAL(enableDetectorIdCmbSignal(bool)), road_branch_widget_, SLOT(enableDetectorIdCmbSlot(bool)));
-    connect(send_msg_timer_, SIGNAL(timeout()), this, SLOT(sendMsgTimerTimeOutSlot()));
-    connect(timer_, SIGNAL(timeout()), this, SLOT(timerTimeOutSlot()));
+    connect(core_, SIGNAL(frameSentSignal(QByteArray)), this, SLOT(comDataSentSlot(QByteArray)));
     connect(open_close_button_, SIGNAL(toggled(bool)), this, SLOT(openSerialTriggeredSlot(bool)));
 
     connect(detector_cfg_button_, SIGNAL(clicked()), this, SLOT(detectorEditButtonClicked()));
     connect(conn_button_, SIGNAL(clicked()), this, SLOT(connectButtonClicked()));
     connect(clear_status_button_, SIGNAL(clicked()), this, SLOT(clearButtonClicked()));
 
-    connect(sync_cmd_, SIGNAL(connectedSignal()), this, SLOT(connectEstablishedSlot()));
-//    connect(sync_cmd_, SIGNAL(connectErrorStrSignal(QString)), this, SLOT(connectErrorSlot(QString)));
-    connect(sync_cmd_, SIGNAL(disconnectedSignal()), this, SLOT(disconnectedSlot()));
-    connect(sync_cmd_, SIGNAL(connectErrorStrSignal(QString)), conn_tip_label_, SLOT(setText(QString)));
-
-    connect(conn_timer_, SIGNAL(timeout()), this, SLOT(connTimerTimeoutSlot()));
+    // the signals of sync_cmd_ are connected in openSession
+    connect(session_mgr_, SIGNAL(configProgress(SyncCommand*,int,int)), this, SLOT(configProgressSlot(SyncCommand*,int,int)));
+    connect(session_mgr_, SIGNAL(configReceived(SyncCommand*)), this, SLOT(configReceivedSlot(SyncCommand*)));
+    connect(session_mgr_, SIGNAL(configFailed(SyncCommand*,QString)), this, SLOT(configFailedSlot(SyncCommand*,QString)));
     connect(signaler_timer_, SIGNAL(timeout()), this, SLOT(signalerTimerTimeoutSlot()));
     connect(count_down_timer_, SIGNAL(timeout()), this, SLOT(countDownTimerTimeoutSlot()));
 
     connect(this, SIGNAL(showLaneDetectorSignal(int,int,bool)), road_branch_widget_, SLOT(showDetectorSlot(int,int,bool)));
+    connect(core_, SIGNAL(showLaneDetectorSignal(int,int,bool)), road_branch_widget_, SLOT(showDetectorSlot(int,int,bool)));
 
     // just for unit testing use
     connect(test_dlg_, SIGNAL(showChannelLightSignal(int,int)), road_branch_widget_, SLOT(laneIndexSlot(int,int)));
@@ -744,6 +540,7 @@ void SimulatorWidget::initComSettingLayout()
     timespan_spinbox_ = new QSpinBox;
     timespan_spinbox_->setRange(3, 65535);
     timespan_spinbox_->setValue(2);
+    capture_checkbox_ = new QCheckBox(STRING_UI_CAPTURE);
     start_button_ = new QPushButton(STRING_UI_START);
     start_button_->setCheckable(true);
     open_close_button_ = new QPushButton(STRING_UI_OPEN + STRING_UI_SERIALPORT);
@@ -839,6 +636,7 @@ void SimulatorWidget::initComSettingLayout()
     QVBoxLayout *start_vlayout = new QVBoxLayout;
     start_vlayout->addWidget(txt_edit_);
     start_vlayout->addLayout(timespan_hlayout);
+    start_vlayout->addWidget(capture_checkbox_);
     start_vlayout->addLayout(open_hlayout);
     start_grp->setLayout(start_vlayout);
 
@@ -974,18 +772,39 @@ void SimulatorWidget::initCtrlModeDesc()
     }
 }
 
+// framing of the binary replies and the handler of every reply that is used
+void SimulatorWidget::initReplyHandlers()
+{
+    CytDecoder::registerFraming(parser_);
+
+    reply_handler_map_.insert(CytDecoder::BeginMonitor, &SimulatorWidget::parseBeginMonitorContent);
+    reply_handler_map_.insert(CytDecoder::LightStatus, &SimulatorWidget::parseLightStatusContent);
+    reply_handler_map_.insert(CytDecoder::Config, &SimulatorWidget::parseConfigContent);
+    reply_handler_map_.insert(CytDecoder::CountDown, &SimulatorWidget::parseCountDownContent);
+    reply_handler_map_.insert(CytDecoder::TscTime, &SimulatorWidget::parseTSCTimeContent);
+    reply_handler_map_.insert(CytDecoder::DetectorFlow, &SimulatorWidget::parseDetectorFlowContent);
+    reply_handler_map_.insert(CytDecoder::DetectorFault, &SimulatorWidget::parseDetectorFaultContent);
+    reply_handler_map_.insert(CytDecoder::RealTimeFlow, &SimulatorWidget::parseRealTimeFlowContent);
+    reply_handler_map_.insert(CytDecoder::DriverStatus, &SimulatorWidget::parseDriverStatusContent);
+    reply_handler_map_.insert(CytDecoder::DriverRealtimeStatus, &SimulatorWidget::parseDriverRealtimeStatusContent);
+    reply_handler_map_.insert(CytDecoder::LightRealTimeStatus, &SimulatorWidget::parseLightRealTimeStatusContent);
+    reply_handler_map_.insert(CytDecoder::AllLightOn, &SimulatorWidget::parseAllLightOnContent);
+}
+
 bool SimulatorWidget::initTscParam()
 {
-    FileReaderWriter reader;
-    bool res = reader.ReadFile(cfg_file_.toStdString().c_str(), tsc_param_);
-    if (!res)
+    // one image serves the schedule info and fills the database
+    cfg_hash_.clear();
+    if (!cfg_cache_.contains(cfg_key_) || !tsc_image_.open(cfg_cache_.path(cfg_key_)))
     {
         QMessageBox::information(this, STRING_TIP, STRING_UI_OPEN_CONFIG + STRING_FAILED, STRING_OK);
         return false;
     }
-    reader.ReadFile(db_ptr_, cfg_file_.toStdString().c_str());
-    phase_handler_->init_database((void*)db_ptr_);
-    phase_handler_->init();
+    cfg_hash_ = cfg_cache_.hash(cfg_key_);
+    // a new snapshot each load, readers of the previous one are not disturbed
+    MDatabase *db = new MDatabase;
+    tsc_image_.copyTo(db);
+    core_->initDatabase(db_store_.publish(db));
     return true;
 }
 
@@ -996,32 +815,32 @@ void SimulatorWidget::updateScheduleInfo()
     QDate curr_date = date_time_.date();
     QTime curr_time = date_time_.time();
     int m = 0;
-    for (m = 0; m < tsc_param_.sched_table_.FactScheduleNum; m++)
+    for (m = 0; m < tsc_image_.schedule().FactScheduleNum; m++)
     {
-        if ((tsc_param_.sched_table_.ScheduleList[m].ScheduleMonth & (0x01 << curr_date.month())) == 0)
+        if ((tsc_image_.schedule().ScheduleList[m].ScheduleMonth & (0x01 << curr_date.month())) == 0)
         {
             continue;
         }
         if (curr_date.dayOfWeek() == 7)
         {
-            if ((tsc_param_.sched_table_.ScheduleList[m].ScheduleWeek & (0x01 << 1)) == 0)
+            if ((tsc_image_.schedule().ScheduleList[m].ScheduleWeek & (0x01 << 1)) == 0)
             {
                 continue;
             }
         }
         else
         {
-            if ((tsc_param_.sched_table_.ScheduleList[m].ScheduleDay & (0x01 << curr_date.day())) == 0)
+            if ((tsc_image_.schedule().ScheduleList[m].ScheduleDay & (0x01 << curr_date.day())) == 0)
             {
                 continue;
             }
         }
-        if ((tsc_param_.sched_table_.ScheduleList[m].ScheduleDay & (0x01 << curr_date.day())) == 0)
+        if ((tsc_image_.schedule().ScheduleList[m].ScheduleDay & (0x01 << curr_date.day())) == 0)
         {
             continue;
         }
-        sched_id = tsc_param_.sched_table_.ScheduleList[m].ScheduleId;
-        time_section_id = tsc_param_.sched_table_.ScheduleList[m].TimeSectionId;
+        sched_id = tsc_image_.schedule().ScheduleList[m].ScheduleId;
+        time_section_id = tsc_image_.schedule().ScheduleList[m].TimeSectionId;
         sched_id_label_->setText(QString::number(sched_id));
         break;
     }   //:~ schedule id
@@ -1030,16 +849,16 @@ void SimulatorWidget::updateScheduleInfo()
     int n = 0;
     unsigned char pattern_id = 0;
 //    ctrl_mode_label_->setText(" -");
-    for (m = 0; m < tsc_param_.time_section_table_.FactTimeSectionNum; m++)
+    for (m = 0; m < tsc_image_.timeSection().FactTimeSectionNum; m++)
     {
-        if (tsc_param_.time_section_table_.TimeSectionList[m][0].TimeSectionId != time_section_id)
+        if (tsc_image_.timeSection().TimeSectionList[m][0].TimeSectionId != time_section_id)
         {
             continue;
         }
-        for (n = 0; n < tsc_param_.time_section_table_.FactEventNum; n++)
+        for (n = 0; n < tsc_image_.timeSection().FactEventNum; n++)
         {
-            unsigned char start_hour = tsc_param_.time_section_table_.TimeSectionList[m][n].StartHour;
-            unsigned char start_min = tsc_param_.time_section_table_.TimeSectionList[m][n].StartMinute;
+            unsigned char start_hour = tsc_image_.timeSection().TimeSectionList[m][n].StartHour;
+            unsigned char start_min = tsc_image_.timeSection().TimeSectionList[m][n].StartMinute;
             if (start_hour > curr_time.hour() || (start_hour == curr_time.hour() && start_min > curr_time.minute()))
             {
                 if (n == 0)
@@ -1051,32 +870,32 @@ void SimulatorWidget::updateScheduleInfo()
                 }
                 else
                 {
-                    unsigned char event_id = tsc_param_.time_section_table_.TimeSectionList[m][n-1].EventId;
-                    start_hour = tsc_param_.time_section_table_.TimeSectionList[m][n-1].StartHour;
-                    start_min = tsc_param_.time_section_table_.TimeSectionList[m][n-1].StartMinute;
-//                    unsigned char ctrl_mode = tsc_param_.time_section_table_.TimeSectionList[m][n-1].ControlMode;
+                    unsigned char event_id = tsc_image_.timeSection().TimeSectionList[m][n-1].EventId;
+                    start_hour = tsc_image_.timeSection().TimeSectionList[m][n-1].StartHour;
+                    start_min = tsc_image_.timeSection().TimeSectionList[m][n-1].StartMinute;
+//                    unsigned char ctrl_mode = tsc_image_.timeSection().TimeSectionList[m][n-1].ControlMode;
                     QString str;
                     event_id_label_->setText(str.sprintf("%d", event_id));
                     str.sprintf("%02d:%02d", start_hour, start_min);
                     start_time_label_->setText(str);
 //                    str = ctrl_mode_desc_map_.value(ctrl_mode); //EventLogDescriptor::GetInstance()->get_ctrl_mode_desc(ctrl_mode);
 //                    ctrl_mode_label_->setText(str);
-                    pattern_id = tsc_param_.time_section_table_.TimeSectionList[m][n-1].PatternId;
+                    pattern_id = tsc_image_.timeSection().TimeSectionList[m][n-1].PatternId;
                 }
                 break;
             }
-            if (tsc_param_.time_section_table_.TimeSectionList[m][n+1].EventId == 0)
+            if (tsc_image_.timeSection().TimeSectionList[m][n+1].EventId == 0)
             {
-                unsigned char event_id = tsc_param_.time_section_table_.TimeSectionList[m][n].EventId;
+                unsigned char event_id = tsc_image_.timeSection().TimeSectionList[m][n].EventId;
                 str.sprintf("%d", event_id);
                 event_id_label_->setText(str);
-                start_hour = tsc_param_.time_section_table_.TimeSectionList[m][n].StartHour;
-                start_min = tsc_param_.time_section_table_.TimeSectionList[m][n].StartMinute;
+                start_hour = tsc_image_.timeSection().TimeSectionList[m][n].StartHour;
+                start_min = tsc_image_.timeSection().TimeSectionList[m][n].StartMinute;
                 str.sprintf("%02d:%02d", start_hour, start_min);
                 start_time_label_->setText(str);
-                unsigned char ctrl_mode = tsc_param_.time_section_table_.TimeSectionList[m][n].ControlMode;
+                unsigned char ctrl_mode = tsc_image_.timeSection().TimeSectionList[m][n].ControlMode;
                 str = ctrl_mode_desc_map_.value(ctrl_mode);//EventLogDescriptor::GetInstance()->get_ctrl_mode_desc(ctrl_mode);
-                pattern_id = tsc_param_.time_section_table_.TimeSectionList[m][n].PatternId;
+                pattern_id = tsc_image_.timeSection().TimeSectionList[m][n].PatternId;
                 break;
             }
         }
@@ -1084,27 +903,27 @@ void SimulatorWidget::updateScheduleInfo()
     }   //:~ event id, start time, control mode desc
 
     unsigned char time_config_id = 0;
-    for (m = 0; m < tsc_param_.timing_plan_table_.FactPatternNum; m++)
+    for (m = 0; m < tsc_image_.pattern().FactPatternNum; m++)
     {
-        if (tsc_param_.timing_plan_table_.PatternList[m].PatternId == pattern_id)
+        if (tsc_image_.pattern().PatternList[m].PatternId == pattern_id)
         {
-            unsigned short circle_time = tsc_param_.timing_plan_table_.PatternList[m].CycleTime;
+            unsigned short circle_time = tsc_image_.pattern().PatternList[m].CycleTime;
             str.sprintf("%d", circle_time);
             cycle_time_label_->setText(str);
-            time_config_id = tsc_param_.timing_plan_table_.PatternList[m].TimeConfigId;
+            time_config_id = tsc_image_.pattern().PatternList[m].TimeConfigId;
         }
     }
     unsigned char stage_count = 0;
-    for (m = 0; m < tsc_param_.stage_timing_table_.FactTimeConfigNum; m++)
+    for (m = 0; m < tsc_image_.timeConfig().FactTimeConfigNum; m++)
     {
-        if (tsc_param_.stage_timing_table_.TimeConfigList[m][0].TimeConfigId != time_config_id)
+        if (tsc_image_.timeConfig().TimeConfigList[m][0].TimeConfigId != time_config_id)
         {
             continue;
         }
-        for (n = 0; n < tsc_param_.stage_timing_table_.FactStageNum; n++)
+        for (n = 0; n < tsc_image_.timeConfig().FactStageNum; n++)
         {
-//            stage_phase_buff[n] = tsc_param_.stage_timing_table_.TimeConfigList[m][n].PhaseId;
-            if (tsc_param_.stage_timing_table_.TimeConfigList[m][n+1].TimeConfigId == 0)
+//            stage_phase_buff[n] = tsc_image_.timeConfig().TimeConfigList[m][n].PhaseId;
+            if (tsc_image_.timeConfig().TimeConfigList[m][n+1].TimeConfigId == 0)
             {
                 stage_count = n+1;
                 break;
@@ -1116,20 +935,38 @@ void SimulatorWidget::updateScheduleInfo()
     str.sprintf("%d / %d", curr_stage_id_, total_stage_count_);
     stage_id_label_->setText(str);
     //:~ stage id
+
+    next_schedule_change_ = nextScheduleChange(time_section_id);
 }
 
-unsigned char SimulatorWidget::getPhaseType(unsigned char phase_id)
+// start of the next event of the time section, or the next midnight when the schedule may change
+QDateTime SimulatorWidget::nextScheduleChange(unsigned char time_section_id) const
 {
-    unsigned phase_type = 0;
-    for (int i = 0; i < tsc_param_.phase_table_.FactPhaseNum; i++)
+    QDateTime next(date_time_.date().addDays(1), QTime(0, 0));
+    int curr_min = date_time_.time().hour() * 60 + date_time_.time().minute();
+    for (int m = 0; m < tsc_image_.timeSection().FactTimeSectionNum; m++)
     {
-        if (phase_id == tsc_param_.phase_table_.PhaseList[i].PhaseId)
+        if (tsc_image_.timeSection().TimeSectionList[m][0].TimeSectionId != time_section_id)
+        {
+            continue;
+        }
+        for (int n = 0; n < tsc_image_.timeSection().FactEventNum; n++)
         {
-            phase_type = tsc_param_.phase_table_.PhaseList[i].PhaseType;
-            break;
+            const TimeSectionList_t &event = tsc_image_.timeSection().TimeSectionList[m][n];
+            if (event.EventId == 0)
+            {
+                break;
+            }
+            int start_min = event.StartHour * 60 + event.StartMinute;
+            if (start_min > curr_min)
+            {
+                QDateTime start(date_time_.date(), QTime(event.StartHour, event.StartMinute));
+                next = qMin(next, start);
+            }
         }
+        break;
     }
-    return phase_type;
+    return next;
 }
 
 bool SimulatorWidget::checkLaneId()
@@ -1144,40 +981,6 @@ bool SimulatorWidget::checkLaneId()
     return true;
 }
 
-void SimulatorWidget::packComData(int lane_index)
-{
-    com_array_.clear();
-    SerialData com_data;
-    QList<int> detector_id_list = road_branch_widget_->getLaneDetectorIdList();
-//    qDebug() << "detector_id_list:" << detector_id_list << endl
-//             << "curr_lane_index:" << lane_index;
-    curr_lane_id_ = detector_id_list.at(lane_index);
-    if (curr_lane_id_ >= 1 && curr_lane_id_ <= 48)
-    {
-        com_data.type = 0x01 + '\0';
-        need_leave_list_[lane_index] = true;
-    }
-    else if (curr_lane_id_ <= 56)
-    {
-        com_data.type = 0x04 + '\0';
-        need_leave_list_[lane_index] = false;
-    }
-    else if (curr_lane_id_ <= 60)
-    {
-        com_data.type = 0x05 + '\0';
-        need_leave_list_[lane_index] = false;
-    }
-    com_data.detector_id = curr_lane_id_ + '\0';
-    int secs = QDateTime::currentDateTime().toTime_t();
-    memcpy(com_data.ms_time, &secs, 4);
-
-    com_array_.append(com_data.head);
-    com_array_.append(com_data.type);
-    com_array_.append(com_data.detector_id);
-    com_array_.append(com_data.ms_time,2);
-    com_array_.append(com_data.tail);
-}
-
 void SimulatorWidget::initMyComSetting()
 {
     QString port_name = port_cmb_->currentText();
@@ -1287,156 +1090,80 @@ void SimulatorWidget::enableComSetting(bool enable)
     parity_cmb_->setEnabled(enable);
 }
 
-void SimulatorWidget::initPreDetectorColorList()
-{
-    for (int i = 0; i < 16; i++)
-    {
-        pre_detector_color_list_.append(RoadBranchWidget::Red);
-    }
-}
-
-void SimulatorWidget::initRedDetectorFlagList()
-{
-    for (int i = 0; i < 16; i++)
-    {
-        detector_red_flag_list_.append(0);
-    }
-}
-
-bool SimulatorWidget::checkPackage(QByteArray &array)
+void SimulatorWidget::checkPackage(const QByteArray &reply)
 {
-    if (array.contains("DETECTDATAER"))
+    if (reply == "DETECTDATAER")
     {
         QMessageBox::information(this, STRING_TIP, STRING_UI_DETECTOR_RETURN_NULL, STRING_OK);
-        int index = array.indexOf("DETECTDATAER");
-        array.remove(index, QString("DETECTDATAER").size()+1);
-        return false;
     }
-    if (array.contains("DRIVEINFOER"))
+    else if (reply == "DRIVEINFOER")
     {
         QMessageBox::information(this, STRING_TIP, STRING_UI_DRIVER_RETURN_NULL, STRING_OK);
-        int index = array.indexOf("DRIVEINFOER");
-        array.remove(index, QString("DRIVEINFOER").size()+1);
-        return false;
     }
-    return true;
 }
 
-bool SimulatorWidget::parseConfigContent(QByteArray &array)
+// config pushed while monitoring revalidates the cached one, a changed config is loaded
+bool SimulatorWidget::parseConfigContent(const QByteArray &payload)
 {
-    if (array.isEmpty())
+    QByteArray content;
+    if (!CytDecoder::decodeConfig(payload, content))
     {
-        QMessageBox::information(this, STRING_TIP, STRING_UI_CONFIG_NULL, STRING_OK);
         return false;
     }
-    QString tail(array.right(3));
-    if (!(array.left(4).contains("CYT4") && array.right(3).contains("END")))
+    if (cfg_cache_.store(cfg_key_, content) && cfg_hash_ != cfg_cache_.hash(cfg_key_) && initTscParam())
     {
-        array.clear();
-        return false;
-    }
-    array.remove(0,4);
-    unsigned char temp[4] = {'\0'};
-    memcpy(temp, array.data(), 4);
-    unsigned int len = 0;
-    memcpy(&len, temp, 4);
-    array.remove(0,4);
-    int idx = array.indexOf(tail);
-    array.remove(idx, 3);
-    len -= (4+3+4);
-    if (len != (unsigned int)array.size())
-    {
-        array.clear();
-        return false;
+        updateScheduleInfo();
     }
     return true;
 }
 
-bool SimulatorWidget::parseBeginMonitorContent(QByteArray &array)
+bool SimulatorWidget::parseBeginMonitorContent(const QByteArray &payload)
 {
-    array.remove(0,4);
-    int idx = array.indexOf("END");
-    array.remove(idx, 3);
-    if ((unsigned int)array.size() < sizeof(begin_monitor_info_))
+    if (!CytDecoder::decode(payload, begin_monitor_info_))
     {
-        array.remove(0,2);
         return false;
     }
-    memcpy(&begin_monitor_info_, array.data(), sizeof(begin_monitor_info_));
-    array.remove(0,2);
     // TODO: update lane light and sidewalk light
     int id = begin_monitor_info_.channel_id;
     // if id > 16, did not emit signal
     emit showLightSignal(id, Off);   // close pre-light
     emit showLightSignal(id, begin_monitor_info_.status);
+    lights_valid_ = false;
 
     return true;
 }
 
-bool SimulatorWidget::parseLightStatusContent(QByteArray &array)
+bool SimulatorWidget::parseLightStatusContent(const QByteArray &payload)
 {
-    array.remove(0,4);
-    char array_sz = '\0';
-    char num_1 = '\0';
-    memcpy(&array_sz, array.data(), 1);
-    array_sz -= '0';
-    array.remove(0,1);
-    memcpy(&num_1, array.data(), 1);
-    RYGArray ryg;
-    for (int i = 0; i < array_sz; i++)
-    {
-        array.remove(0,1);
-        memcpy(&ryg, array.data(), 3);
-        light_status_info_.lights[i] = ryg;
-        array.remove(0,3);
-    }
-    memcpy(&light_status_info_.work_mode, array.data(), 1);
-    array.remove(0,1);
-    memcpy(&light_status_info_.plan_id, array.data(),1);
-    array.remove(0,1);
-    memcpy(&light_status_info_.phase_id, array.data(), 4);
-    array.remove(0,4);
-    int idx = array.indexOf("END");
-    array.remove(idx, 3);
+    if (!CytDecoder::decode(payload, light_status_info_))
+    {
+        return false;
+    }
 
+    bool mode_changed = !is_first_ && channel_status_bak_.work_mode != light_status_info_.work_mode;
     channel_status_info_.work_mode = light_status_info_.work_mode;
     channel_status_info_.stage_id = light_status_info_.plan_id;
     channel_status_info_.phase_id = light_status_info_.phase_id;
-    channel_status_info_.channel_vec.clear();
-    unsigned char red_tmp = 0, yellow_tmp = 0, green_tmp = 0;
-    for (int i = 0; i < 4; i++)
+    CytDecoder::toPlanes(light_status_info_, channel_status_info_.planes);
+
+    // only the channels whose color changed are repainted
+    quint32 changed = CytDecoder::changedChannels(channel_status_bak_.planes, channel_status_info_.planes);
+    if (!lights_valid_)
     {
-        for (int j = 0; j < 8; j++)
-        {
-            red_tmp = light_status_info_.lights[i].red;
-            yellow_tmp = light_status_info_.lights[i].yellow;
-            green_tmp = light_status_info_.lights[i].green;
-            if ((red_tmp & (0x01 << j)) != 0x00)
-            {
-                channel_status_info_.channel_vec.append(Red);
-            }
-            else if ((yellow_tmp & (0x01 << j)) != 0x00)
-            {
-                channel_status_info_.channel_vec.append(Yellow);
-            }
-            else if ((green_tmp & (0x01 << j)) != 0x00)
-            {
-                channel_status_info_.channel_vec.append(Green);
-            }
-            else
-            {
-                channel_status_info_.channel_vec.append(Off);
-            }
-        }
+        changed = 0xffffffff;
+        lights_valid_ = true;
     }
-
-    // TODO: update ui
-    for (int i = 0; i < channel_status_info_.channel_vec.size(); i++)
+    for (int id = 1; changed != 0; id++, changed >>= 1)
     {
-        emit showLightSignal(i+1, channel_status_info_.channel_vec.at(i));
+        if (changed & 0x01)
+        {
+            emit showLightSignal(id, CytDecoder::channelColor(channel_status_info_.planes, id));
+        }
     }
     QString txt = ctrl_mode_desc_map_.value(channel_status_info_.work_mode);
     ctrl_mode_label_->setText(txt);
+    core_->setCtrlMode(channel_status_info_.work_mode);
+    core_->setPhaseIds(channel_status_info_.phase_id);
 
     // back up channel status info
     channel_status_bak_ = channel_status_info_;
@@ -1448,24 +1175,34 @@ bool SimulatorWidget::parseLightStatusContent(QByteArray &array)
     str = phaseBitsDesc(channel_status_bak_.phase_id);
     curr_phase_id_label_->setText(str);
 
+    if ((is_first_ || mode_changed) && sync_cmd_ != NULL)
+    {
+        // the controller changed state, take its clock and recompute the schedule
+        sync_cmd_->GetTscTime();
+        is_first_ = false;
+    }
     return true;
 }
 
-bool SimulatorWidget::parseCountDownContent(QByteArray &array)
+bool SimulatorWidget::parseCountDownContent(const QByteArray &payload)
 {
-    array.remove(0,4);
-    int idx = array.indexOf("END");
-    array.remove(idx, 3);
-    memcpy(&count_down_info_, array.data(), sizeof(count_down_info_));
-    array.remove(0,8);
+    if (!CytDecoder::decode(payload, count_down_info_))
+    {
+        return false;
+    }
 
-    // TODO: update schedule info
+    if (count_down_info_.ctrl_mode != core_->ctrlMode() && sync_cmd_ != NULL)
+    {
+        sync_cmd_->GetTscTime();
+    }
     QString str;
     curr_stage_id_ = count_down_info_.stage_id;
     str.sprintf("%d / %d", curr_stage_id_, total_stage_count_);
     stage_id_label_->setText(str);
     curr_phase_id_label_->setText(phaseBitsDesc(count_down_info_.phase_ids));
     ctrl_mode_label_->setText(ctrl_mode_desc_map_.value(count_down_info_.ctrl_mode));
+    core_->setCtrlMode(count_down_info_.ctrl_mode);
+    core_->setPhaseIds(count_down_info_.phase_ids);
 
     count_down_secs_ = count_down_info_.light_time;
     count_down_light_ = count_down_info_.light_corlor;
@@ -1501,21 +1238,13 @@ bool SimulatorWidget::parseCountDownContent(QByteArray &array)
     return true;
 }
 
-bool SimulatorWidget::parseTSCTimeContent(QByteArray &array)
+bool SimulatorWidget::parseTSCTimeContent(const QByteArray &payload)
 {
-    array.remove(0,4);
-    int idx = array.indexOf("END");
-    array.remove(idx, 3);
-    if (array.size() < 4)
+    unsigned int seconds = 0;
+    if (!CytDecoder::decodeTscTime(payload, seconds))
     {
-        array.remove(0, array.size());
         return false;
     }
-    unsigned char temp[4] = {'\0'};
-    memcpy(temp, array.data(), 4);
-    array.remove(0,4);
-    unsigned int seconds = 0;
-    memcpy(&seconds, temp, sizeof(seconds));
     if (seconds >= 60*60*8)
     {
         seconds -= 60*60*8;
@@ -1524,199 +1253,70 @@ bool SimulatorWidget::parseTSCTimeContent(QByteArray &array)
     QString str = date_time_.toString("yyyy-MM-dd hh:mm:ss");
     SIGNALER_TIME_UPDATE(str);
 
+    // the parameters were loaded with the config, only the clock is new here
+    updateScheduleInfo();
+    signaler_timer_->start(1000);
+    if (sync_cmd_ != NULL && !sync_cmd_->isMonitoring())
+    {
+        sync_cmd_->StartMonitoring();
+    }
+    is_inited_ = true;
     return true;
 }
 
-bool SimulatorWidget::parseAllLightOnContent(QByteArray &array)
+bool SimulatorWidget::parseAllLightOnContent(const QByteArray &payload)
 {
-    array.remove(0,4);
     unsigned char light_color = 0;
-    memcpy(&light_color, array.data(), 1);
-    int idx = array.indexOf("END");
-    if (idx != 1)
+    if (!CytDecoder::decodeAllLightOn(payload, light_color))
     {
-        array.remove(0, idx);
         return false;
     }
-    array.remove(0,4);
     // TODO: update ui
     // set lane and sidewalk light the same color
     for (int i = 1; i < 16+1; i++)
     {
         emit showLightSignal(i, light_color);
     }
+    lights_valid_ = false;
 
     return true;
 }
 
-bool SimulatorWidget::parseDetectorFlowContent(QByteArray &array)
+bool SimulatorWidget::parseDetectorFlowContent(const QByteArray &payload)
 {
-    array.remove(0,4);
-    int idx = array.indexOf("END");
-    array.remove(idx, 3);
-    array.remove(0,4);
+    Q_UNUSED(payload);
     return true;
 }
 
-bool SimulatorWidget::parseDetectorFaultContent(QByteArray &array)
+bool SimulatorWidget::parseDetectorFaultContent(const QByteArray &payload)
 {
-    array.remove(0,4);
-    int idx = array.indexOf("END");
-    array.remove(0, idx+3);
+    Q_UNUSED(payload);
     return true;
 }
 
-bool SimulatorWidget::parseDriverStatusContent(QByteArray &array)
+bool SimulatorWidget::parseDriverStatusContent(const QByteArray &payload)
 {
-    array.remove(0,4);
-    int idx = array.indexOf("END");
-    array.remove(0, idx+3);
+    Q_UNUSED(payload);
     return true;
 }
 
-bool SimulatorWidget::parseRealTimeFlowContent(QByteArray &array)
+bool SimulatorWidget::parseRealTimeFlowContent(const QByteArray &payload)
 {
-    array.remove(0,4);
-    array.remove(0,4);
+    Q_UNUSED(payload);
     return true;
 }
 
-bool SimulatorWidget::parseDriverRealtimeStatusContent(QByteArray &array)
+bool SimulatorWidget::parseDriverRealtimeStatusContent(const QByteArray &payload)
 {
-    array.remove(0,4);
-    int idx = array.indexOf("END");
-    array.remove(0, idx+3);
+    Q_UNUSED(payload);
     return true;
 }
 
-bool SimulatorWidget::parseLightRealTimeStatusContent(QByteArray &array)
+bool SimulatorWidget::parseLightRealTimeStatusContent(const QByteArray &payload)
 {
-    array.remove(0,4);
-    int idx = array.indexOf("END");
-    array.remove(0, idx+3);
+    Q_UNUSED(payload);
     return true;
 }
-/* 处理流程：
- * 1. 检查当前所有车道上是否有车辆待发————有则发车，无则继续
- * 2. 获取当前放行相位ID和当前相位所控制的通道
- * 3. 检查当前系统中可通行通道上有无待放行的车辆：有则放行
- * 4. 产生随机通道号并放行。
-*/
-bool SimulatorWidget::simualtorComdataDispatcher()
-{
-    QString ctrl_mode = ctrl_mode_label_->text().trimmed();
-    unsigned char phase_id = curr_phase_id_label_->text().toInt();
-    unsigned char phase_type = getPhaseType(phase_id);
-    if (ctrl_mode == STRING_CTRL_FULL_INDUCTION)
-    {
-        return trafficDispatch(phase_id);
-    }
-    else if (ctrl_mode == STRING_CTRL_MAIN_HALF_INDUCTION)
-    {
-        if (phase_type == 0x020)        // elasticity phase
-        {
-            // send com msg
-            return trafficDispatch(phase_id);
-        }
-        else if (phase_type == 0x080)   // fix phase
-        {
-            // TODO: did not send com msg
-            ;
-        }
-    }
-    else if (ctrl_mode == STRING_CTRL_SECOND_HALF_INDUC)
-    {
-        if (phase_type == 0x020)    // elasticity phase
-        {
-            // TODO: did not send com msg
-            ;
-        }
-        else if (phase_type == 0x040)   // determined phase
-        {
-            // TODO: send com msg
-            return trafficDispatch(phase_id);
-        }
-    }
-    else if (ctrl_mode == STRING_CTRL_CROSS_STREET)
-    {
-        if (phase_type == 0x01)     // motor phase
-        {
-            // TODO: did not send com msg
-            ;
-        }
-        else if (phase_type == 0x04)    // walkman phase
-        {
-            // TODO: send com msg
-            return trafficDispatch(phase_id);
-        }
-    }
-    else if (ctrl_mode == STRING_CTRL_BUS_FIRST)
-    {
-        // TODO: send com msg
-        return trafficDispatch(phase_id);
-    }
-    else if (ctrl_mode == STRING_CTRL_SINGLE_ADAPT)
-    {
-        // TODO: send com msg
-        return trafficDispatch(phase_id);
-    }
-    else
-    {
-        return trafficDispatch(phase_id);
-    }
-    return false;
-}
-
-void SimulatorWidget::comDataDispatch(int phase_id)
-{
-    QList<unsigned char> channel_id_list = phase_handler_->get_phase_ctrled_channel_list(phase_id);/* road_branch_widget_->getLaneDetectorIdList();*/
-    int sz = channel_id_list.size();
-    if (sz <= 0) {return;}
-    QTime t = QTime::currentTime();
-    qsrand(t.msec() + t.second()*1000);
-    int lane_idx = qrand() % 12;
-    if (!channel_id_list.contains(lane_idx+1))
-    {
-        return;
-    }
-    qDebug() << "before pack com data (list_size:" << sz << "lane_idx:" << lane_idx << ")";
-    packComData(lane_idx);
-    qDebug() << "get_lane_index:" << lane_idx;
-    for (int i = 0; i < channel_id_list.size(); i++)
-    {
-        if (detector_red_flag_list_.at(i) == 1)
-        {
-            packComData(i);
-            updateDetectorStatus(lane_idx);
-            detector_red_flag_list_[i] = 0;
-        }
-    }
-    updateDetectorStatus(lane_idx);
-}
-
-void SimulatorWidget::updateDetectorStatus(int detector_index)
-{
-    if (need_leave_)
-    {
-        detector_red_flag_list_[detector_index] = 1;
-    }
-    else
-    {
-        detector_red_flag_list_[detector_index] = 0;
-    }
-    my_com_->write(com_array_);
-    if (detector_red_flag_list_.at(pre_lane_idx_) == 0)
-    {
-        emit showLaneDetectorSignal(pre_lane_idx_, RoadBranchWidget::Green, false);
-    }
-    else
-    {
-        emit showLaneDetectorSignal(curr_lane_idx_, RoadBranchWidget::Red, false);
-    }
-    emit showLaneDetectorSignal(detector_index, RoadBranchWidget::Green, true);
-    pre_lane_idx_ = detector_index;
-    curr_lane_idx_ = detector_index;
-}
 
 QString SimulatorWidget::phaseBitsDesc(unsigned int phase_ids)
 {
@@ -1735,261 +1335,3 @@ QString SimulatorWidget::phaseBitsDesc(unsigned int phase_ids)
     }
     return str.left(str.size() - 1);
 }
-
-bool SimulatorWidget::trafficDispatch(unsigned int phase_id)
-{
-    qDebug() << "dispatch-car_sent_list:";
-    dumpEnumElementList(car_sent_list_);
-    for (int i = 0; i < 12; i++)
-    {
-        int pre_index = pre_lane_idx_list_.at(i);
-        LightColor color = Off;//channel_detector_color_list_.at(i);
-        if (Q_LIKELY(pre_index >= 0))
-        {
-            color = channel_detector_color_list_.at(pre_index);
-        }
-        switch (car_sent_list_.at(i))
-        {
-        case Come:
-            if (isChannelAccessible(phase_id, i+1))
-            {
-                // TODO: dispatch car
-                if (pre_index >= 0 && color != Off)
-                {
-                    emit showLaneDetectorSignal(pre_index, color, false);
-                    qDebug() << "dispatch-Come--close pre lane detector:" << pre_index+1 << ",Color:" << colorPrintable(color) << "false";
-                }
-                emit showLaneDetectorSignal(i, RoadBranchWidget::Green, true);
-                qDebug() << "dispatch-Come--light lane detector:" << i+1 << ",Color: Green true";
-                packComData(i);
-                my_com_->write(com_array_);
-                txt_edit_->insertPlainText(formatComData(com_array_)+"\n");
-                channel_detector_color_list_[i] = Green;
-                car_sent_list_[i] = need_leave_list_.at(i) ? Go : None;
-                pre_lane_idx_list_[i] = i;
-            }
-            break;
-        case Go:
-            if (isChannelAccessible(phase_id, i+1))
-            {
-                // TODO: dispatch car
-                if (pre_index >= 0)
-                {
-                    emit showLaneDetectorSignal(pre_index, color, false);
-                    qDebug() << "Go--close detector:(lane id:" << pre_index+1 << ",Color:" << colorPrintable(color) << ") false";
-                }
-                emit showLaneDetectorSignal(i, RoadBranchWidget::Red, true);
-                qDebug() << "Go--show detector:(lane id:" << i+1 << ",Color:Red) true";
-                if (need_leave_list_.at(i))
-                {
-                    packComData(i);
-                    com_array_[1] = 0x02 + '\0';
-                    char ms[4] = {'\0'};
-                    int secs = QDateTime::currentDateTime().toTime_t();
-                    memcpy(ms, &secs, sizeof(secs));
-                    com_array_[3] = ms[0];
-                    com_array_[4] = ms[1];
-                    need_leave_list_[i] = false;
-                }
-                else
-                {
-                    packComData(i);
-                }
-                my_com_->write(com_array_);
-                txt_edit_->insertPlainText(formatComData(com_array_)+"\n");
-                need_leave_list_[i] = false;
-                channel_detector_color_list_[i] = Red;
-                car_sent_list_[i] = None;
-                pre_lane_idx_list_[i] = i;
-            }
-            break;
-        case None:
-            if (pre_index >= 0 && color != Off)
-            {
-                emit showLaneDetectorSignal(pre_index, color, false);
-                car_sent_list_[pre_index] = Other;
-                qDebug() << "None--close detector:" << pre_index+1 << ",Color:" << colorPrintable(color) << "false";
-            }
-            break;
-        case Other:
-            break;
-        default:
-            break;
-        }
-    }
-    // generate rand lane index
-    QTime t = QTime::currentTime();
-    qsrand(t.msec() + t.second()*1000);
-    int lane_idx = qrand() % 12;
-    qDebug() << "rand lane id:" << lane_idx+1;
-    if (car_sent_list_.at(lane_idx) == Go)
-    {
-        qDebug() << "lane" << lane_idx+1 << " exists a car (Green)";
-        return false;
-    }
-    car_sent_list_[lane_idx] = Come;
-    packComData(lane_idx);
-    switch (car_sent_list_.at(lane_idx))
-    {
-    case Come:
-        if (isChannelAccessible(phase_id, lane_idx+1))
-        {
-            road_branch_widget_->showDetectorSlot(lane_idx, RoadBranchWidget::Green, true);
-            qDebug() << "Come--show detector:(lane id:" << lane_idx+1 << ",Color: Green) true";
-            channel_detector_color_list_[lane_idx] = Green;
-            car_sent_list_[lane_idx] = need_leave_list_.at(lane_idx) ? Go : None;
-            pre_lane_idx_list_[lane_idx] = lane_idx;
-            txt_edit_->insertPlainText(formatComData(com_array_)+"\n");
-            my_com_->write(com_array_);
-            if (need_leave_list_.at(lane_idx))
-            {
-                timer_->start(qrand()%1000+1000);
-            }
-        }
-        else
-        {
-            qDebug() << "car on lane id:" << lane_idx+1 << "can not access this channel";
-            car_sent_list_[lane_idx] = Other;
-        }
-        break;
-    case Go:
-        break;
-    case None:
-        break;
-    default:
-        break;
-    }
-    return true;
-}
-
-bool SimulatorWidget::isChannelAccessible(unsigned int phase_id, unsigned char channel_id)
-{
-    QList<unsigned char> channel_id_list = phase_handler_->get_phase_ctrled_channel_list(phase_id);
-    if (channel_id_list.isEmpty())
-    {
-        return false;
-    }
-    if (!channel_id_list.contains(channel_id))
-    {
-        return false;
-    }
-    return true;
-}
-
-void SimulatorWidget::randTraffic()
-{
-    QTime t = QTime::currentTime();
-    qsrand(t.msec() + t.second()*1000);
-    int lane_idx = qrand() % 12;
-//    qDebug() << "rand lane_idx:" << lane_idx;
-    packComData(lane_idx);
-    my_com_->write(com_array_);
-}
-
-void SimulatorWidget::initTrafficDispatcher()
-{
-    for (int i = 0; i < 16; i++)
-    {
-        car_sent_list_.append(Other);
-        channel_detector_color_list_.append(Off);
-        pre_lane_idx_list_.append(-1);
-        need_leave_list_.append(false);
-    }
-}
-
-void SimulatorWidget::dumpComData()
-{
-    SerialData com_data;
-    com_data.type = com_array_.at(1);
-    com_data.detector_id = com_array_.at(2);
-    com_data.ms_time[0] = com_array_.at(3);
-    com_data.ms_time[1] = com_array_.at(4);
-
-    int ts = 0;
-    memcpy(&ts, com_data.ms_time,4);
-    QString head = QString("0x%1").arg(int(com_data.head),0,16);
-    QString tail = QString("0x%1").arg(int(com_data.tail),0,16);
-    qDebug() << "head:" << head
-             << "type:" << com_data.type - '\0'
-             << "lane_id:" << com_data.detector_id - '\0'
-             << "timespan:" << ts
-             << "tail:" << tail
-             << endl;
-}
-
-void SimulatorWidget::test()
-{
-    QFile file("test.dat");
-    if (!file.open(QIODevice::WriteOnly))
-    {
-        return;
-    }
-    file.write(com_array_);
-    file.close();
-}
-
-QString SimulatorWidget::colorPrintable(SimulatorWidget::LightColor color)
-{
-    QString str;
-    switch(color)
-    {
-    case Red:
-        str = "Red";
-        break;
-    case Yellow:
-        str = "Yellow";
-        break;
-    case Green:
-        str = "Green";
-        break;
-    case Off:
-        str = "Off";
-        break;
-    case Invalid:
-        str = "Invalid";
-        break;
-    default:
-        str = "-";
-        break;
-    }
-    return str;
-}
-
-QString SimulatorWidget::carStatusPrintable(SimulatorWidget::CarStatus status)
-{
-    QString str;
-    switch (status)
-    {
-    case Come:
-        str = "Come";
-        break;
-    case Go:
-        str = "Go";
-        break;
-    case None:
-        str = "None";
-        break;
-    case Other:
-        str = "Other";
-        break;
-    default:
-        str = "-";
-        break;
-    }
-    return str;
-}
-
-void SimulatorWidget::dumpEnumElementList(const QList<SimulatorWidget::CarStatus> &list)
-{
-    int cnt = list.size();
-    if (cnt <= 0)
-    {
-        return;
-    }
-    QString str;
-    for (int i = 0; i < cnt; i++)
-    {
-        str += QString::number(i+1) + "-" + carStatusPrintable(list.at(i)) + " ";
-    }
-    qDebug() << str;
-}
@@ -7,9 +7,11 @@
 #include <QDateTime>
 #include "roadbranchwidget.h"
 #include "win_qextserialport.h"
-#include "tscparam.h"
+#include "tscimage.h"
 #include "mdatabase.h"
-#include "phasehandler.h"
+#include "databasestore.h"
+#include "cytdecoder.h"
+#include "configcache.h"
 
 class QTextEdit;
 class QTextBrowser;
@@ -17,55 +19,23 @@ class QPushButton;
 class QLineEdit;
 class QComboBox;
 class QSpinBox;
+class QCheckBox;
 class QLabel;
 class QGroupBox;
 class QLCDNumber;
 class QTimer;
 class DetectorIdEditWidget;
 class SyncCommand;
+class SessionManager;
+class SimulatorCore;
 
 class TestDlg;
 
 
-typedef struct BeginMonitorTag
-{
-    unsigned char channel_id;
-    unsigned char status;
-}BeginMonitorInfo;
-
-typedef struct CountDownTag
-{
-    unsigned char ctrl_mode;
-    unsigned char stage_id;
-    unsigned char light_corlor;
-    unsigned char light_time;
-    unsigned int phase_ids;
-}CountDownInfo;
-
-typedef struct RedYellowGreenTag
-{
-    unsigned char red;
-    unsigned char yellow;
-    unsigned char green;
-
-    RedYellowGreenTag() :
-        red(0), yellow(0), green(0)
-    {}
-
-}RYGArray;
-
-typedef struct LightStatusTag
-{
-    RYGArray lights[4];
-    unsigned char work_mode;
-    unsigned char plan_id;
-    unsigned int phase_id;
-}LightStatusInfo;
-
-
 class SimulatorWidget : public QWidget
 {
     Q_OBJECT
+    friend class SimulatorBench;
 public:
     explicit SimulatorWidget(QWidget *parent = 0);
     ~SimulatorWidget();
@@ -88,8 +58,7 @@ signals:
 
 public slots:
     void startSimulatorToggledSlot(bool);
-    void sendMsgTimerTimeOutSlot();
-    void timerTimeOutSlot();
+    void comDataSentSlot(const QByteArray &array);
     void openSerialTriggeredSlot(bool);
 
     void detectorEditButtonClicked();
@@ -99,18 +68,19 @@ public slots:
     void connectEstablishedSlot();
     void disconnectedSlot();
     void connectErrorSlot(const QString&);
+    void reconnectingSlot(int msecs);
 
     void onCmdGetVerIdSlot(QByteArray &array);
-    void onCmdReadConfigFileSlot(QByteArray &array);
     void onCmdParseParam(QByteArray &array);
+    void configProgressSlot(SyncCommand *session, int received, int total);
+    void configReceivedSlot(SyncCommand *session);
+    void configFailedSlot(SyncCommand *session, const QString &error);
 
-    void connTimerTimeoutSlot();
     void signalerTimerTimeoutSlot();
     void countDownTimerTimeoutSlot();
 
 protected:
     void closeEvent(QCloseEvent *);
-    void timerEvent(QTimerEvent *);
 
 private:
     void initPage();
@@ -119,103 +89,70 @@ private:
     void initRoadbranchLayout();
     void initScheduleInfoLayout();
 
+    void openSession();
     void initCtrlModeDesc();
+    void initReplyHandlers();
     bool initTscParam();
     void updateScheduleInfo();
-    unsigned char getPhaseType(unsigned char phase_id);
+    QDateTime nextScheduleChange(unsigned char time_section_id) const;
     bool checkLaneId();
-    void packComData(int lane_index);
     void initMyComSetting();
     QString formatComData(const QByteArray &array);
     void enableComSetting(bool enable);
-    void initPreDetectorColorList();
-    void initRedDetectorFlagList();
-
-    bool checkPackage(QByteArray &array);
-    bool parseConfigContent(QByteArray &array);
-    bool parseBeginMonitorContent(QByteArray &array);
-    bool parseLightStatusContent(QByteArray &array);
-    bool parseCountDownContent(QByteArray &array);
-    bool parseTSCTimeContent(QByteArray &array);
-    bool parseAllLightOnContent(QByteArray &array);
-
-    bool parseDetectorFlowContent(QByteArray &array);
-    bool parseDetectorFaultContent(QByteArray &array);
-    bool parseDriverStatusContent(QByteArray &array);
-    bool parseRealTimeFlowContent(QByteArray &array);
-    bool parseDriverRealtimeStatusContent(QByteArray &array);
-    bool parseLightRealTimeStatusContent(QByteArray &array);
-
-    bool simualtorComdataDispatcher();
-    void comDataDispatch(int phase_id);
-    void updateDetectorStatus(int detector_index);
-    QString phaseBitsDesc(unsigned int phase_ids);
 
-    // dispatch car
-    bool trafficDispatch(unsigned int phase_id);
-    bool isChannelAccessible(unsigned int phase_id, unsigned char channel_id);
-    void randTraffic();
-    void initTrafficDispatcher();
-
-    enum CarStatus
-    {
-        Come = 0, Go = 1, None = 2, Other = 3
-    };
-    QList<CarStatus> car_sent_list_;    // index+1 present channel_id
-    QList<LightColor> channel_detector_color_list_; // index+1 present channel id
-    QList<bool> need_leave_list_;       // index+1 present channel_id
+    // payload: a framed message without its CYT<id> head and END tail
+    void checkPackage(const QByteArray &reply);
+    bool parseConfigContent(const QByteArray &payload);
+    bool parseBeginMonitorContent(const QByteArray &payload);
+    bool parseLightStatusContent(const QByteArray &payload);
+    bool parseCountDownContent(const QByteArray &payload);
+    bool parseTSCTimeContent(const QByteArray &payload);
+    bool parseAllLightOnContent(const QByteArray &payload);
+
+    bool parseDetectorFlowContent(const QByteArray &payload);
+    bool parseDetectorFaultContent(const QByteArray &payload);
+    bool parseDriverStatusContent(const QByteArray &payload);
+    bool parseRealTimeFlowContent(const QByteArray &payload);
+    bool parseDriverRealtimeStatusContent(const QByteArray &payload);
+    bool parseLightRealTimeStatusContent(const QByteArray &payload);
 
-    void dumpComData();
-    void test();
-    QString colorPrintable(LightColor color);
-    QString carStatusPrintable(CarStatus status);
-    void dumpEnumElementList(const QList<CarStatus> &list);
+    QString phaseBitsDesc(unsigned int phase_ids);
 
 private:
     struct PortSettings my_com_setting_;
 
-    QByteArray com_array_;
-    int curr_lane_idx_;
-    int curr_lane_id_;
-    RoadBranchWidget::LightColor curr_color_;
     bool serial_status_;
-
-    QTimer *send_msg_timer_;
-    QTimer *timer_;
-    bool need_leave_;
     QList<int> lane_id_list_;
 
     QString ip_;
     int port_;
-    QString cfg_file_;
+    QString cfg_key_;       // controller of the connection in cfg_cache_
+    QString cfg_hash_;      // config in tsc_image_
+    int cfg_max_age_;       // s a cached config is trusted without a download
     bool conn_status_;
-    int ver_check_id_;  // version check timer id
     bool is_inited_;    // tsc time update flag
-    int ui_timer_id_;   // used for signaler time
-    bool is_uitimer_started_;
 
-    SyncCommand *sync_cmd_;
-    TSCParam tsc_param_;
-    QByteArray recv_array_;
-    QByteArray cfg_array_;
+    SessionManager *session_mgr_;
+    SyncCommand *sync_cmd_;     // session of ip_:port_, NULL before the first connect
+    TscImage tsc_image_;
+    CytParser parser_;     // replies of onCmdParseParam
+    ConfigCache cfg_cache_;
 
-    QTimer *conn_timer_;
     QTimer *signaler_timer_, *count_down_timer_;
     QDateTime date_time_;
+    QDateTime next_schedule_change_;    // signaler time the schedule info is recomputed at
 
     unsigned char curr_stage_id_;
     unsigned char total_stage_count_;
     unsigned char count_down_secs_;
     unsigned char count_down_light_;
 
-    unsigned char sec_count_;
-
     BeginMonitorInfo begin_monitor_info_;
     CountDownInfo count_down_info_;
     LightStatusInfo light_status_info_;
     typedef struct ChannelStatusInfoTag
     {
-        QVector<LightColor> channel_vec;
+        LightPlanes planes;
         unsigned char work_mode;
         unsigned char stage_id;
         unsigned int phase_id;
@@ -225,15 +162,15 @@ private:
     ChannelStatusInfo channel_status_bak_;  // used for revert lights' status
 
     QMap<unsigned char, QString> ctrl_mode_desc_map_;
+    typedef bool (SimulatorWidget::*ReplyHandler)(const QByteArray &payload);
+    QMap<char, ReplyHandler> reply_handler_map_;    // command id -> handler
     QList<int> phase_id_list_;
-    int pre_lane_idx_;
-    QList<RoadBranchWidget::LightColor> pre_detector_color_list_;
-    QList<int> pre_lane_idx_list_;
-    QList<int> detector_red_flag_list_;
 
     MDatabase *db_ptr_;
-    PhaseHandler *phase_handler_;
+    DatabaseStore db_store_;    // config the engine runs on
+    SimulatorCore *core_;
     bool is_first_;
+    bool lights_valid_;     // false: the lights shown may differ from channel_status_bak_
     bool is_first_send_;
     bool is_first_end_;
 
@@ -241,6 +178,7 @@ private:
     QComboBox *port_cmb_, *baud_rate_cmb_, *data_bit_cmb_, *stop_cmb_, *parity_cmb_;
     QTextEdit *txt_edit_;
     QSpinBox *timespan_spinbox_;
+    QCheckBox *capture_checkbox_;   // record emitted frames to temp/<ip>_<time>.cap
     QPushButton *open_close_button_, *start_button_;
     QLabel *open_tip_label_;
 
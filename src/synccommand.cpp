@@ -1,24 +1,9 @@
 #include "synccommand.h"
 #include "command.h"
 #include "macrostrings.h"
-
-#define SOCKET_WAIT_MS 30000
-
-SyncCommand *SyncCommand::instance_ = NULL;
-
-SyncCommand *SyncCommand::GetInstance()
-{
-    if (instance_ == NULL)
-    {
-        instance_ = new SyncCommand;
-    }
-    return instance_;
-}
-
-void SyncCommand::DistroyInstance()
-{
-    this->~SyncCommand();
-}
+#include "cytdecoder.h"
+#include "frameclock.h"
+#include "tracefile.h"
 
 QTcpSocket *SyncCommand::getSocket()
 {
@@ -41,30 +26,50 @@ unsigned int SyncCommand::getSocketPort() const
     return port_;
 }
 
+// returns at once, the link is then kept up until disconnectFromHost()
 void SyncCommand::connectToHost(const QString &ip, unsigned int port)
 {
     ip_ = ip;
     port_ = port;
-    socket_->connectToHost(ip, port);
+    auto_reconnect_ = true;
+    reconnect_ms_ = RECONNECT_MIN_TIME;
+    jitter_random_.seed(FastRandom::streamSeed(qHash(ip_), port_) ^ (quintptr)this);
+    reconnect_timer_->stop();
+    StartConnect();
 }
 
-bool SyncCommand::syncConnectToHost(const QString &ip, unsigned port)
+SyncCommand::ConnState SyncCommand::connState() const
 {
-    ip_ = ip;
-    port_ = port;
-    socket_->connectToHost(ip, port);
-    if (!socket_->waitForConnected(SOCKET_WAIT_MS))
-    {
-        OnConnectError(socket_->error());
-        return false;
-    }
-    return true;
+    return conn_state_;
+}
+
+bool SyncCommand::isMonitoring() const
+{
+    return monitoring_;
+}
+
+// connects to the address given by setSocketAddress
+void SyncCommand::openConnection()
+{
+    connectToHost(ip_, port_);
+}
+
+// request without handler, the reply only comes out of messageReceived or chunkReceived
+void SyncCommand::postCommand(const QByteArray &command, char reply_id)
+{
+    QueueRequest(command, reply_id, NULL, -1, reply_id != REPLY_NONE ? REQUEST_RETRY_COUNT : 0);
 }
 
 void SyncCommand::closeConnection()
 {
+    auto_reconnect_ = false;
+    reconnect_timer_->stop();
+    connect_timer_->stop();
+    heartbeat_timer_->stop();
+    SetConnState(Unconnected);
 //    socket_->close();
     socket_->abort();
+    ClearRequests();
 }
 
 bool SyncCommand::isConnectionValid() const
@@ -74,97 +79,100 @@ bool SyncCommand::isConnectionValid() const
 
 void SyncCommand::disconnectFromHost()
 {
+    auto_reconnect_ = false;
+    reconnect_timer_->stop();
+    connect_timer_->stop();
+    heartbeat_timer_->stop();
+    SetConnState(Unconnected);
     socket_->disconnectFromHost();
 }
 
 void SyncCommand::ReadSignalerConfigFile(QObject *target, const std::string &slot)
 {
     InitParseHandler(target, slot);
-    qint64 sz = socket_->write(Command::GetConfigure.c_str());
-    qDebug() << Command::GetConfigure.c_str() << " bytes:" << sz;
+    PostRequest(Command::GetConfigure.c_str(), CytDecoder::Config);
 }
 
 void SyncCommand::ReadSignalerTime(QObject *target, const std::string &slot)
 {
     InitParseHandler(target, slot);
-    qint64 sz = socket_->write(Command::GetTSCtime.c_str());
-    qDebug() << Command::GetTSCtime.c_str() << " bytes:" << sz;
+    PostRequest(Command::GetTSCtime.c_str(), CytDecoder::TscTime);
 }
 
 void SyncCommand::ReadSignalerNetworkInfo(QObject *target, const std::string &slot)
 {
     InitParseHandler(target, slot);
-    qint64 sz = socket_->write(Command::GetNetAddress.c_str());
-    qDebug() << Command::GetNetAddress.c_str() << " bytes:" << sz;
+    PostRequest(Command::GetNetAddress.c_str(), CytDecoder::NetAddress);
 }
 
 void SyncCommand::ReadEventLogFile(QObject *target, const std::string &slot)
 {
     InitParseHandler(target, slot);
-    qint64 sz = socket_->write(Command::GetEventInfo.c_str());
-    qDebug() << Command::GetEventInfo.c_str() << " bytes:" << sz;
+    PostRequest(Command::GetEventInfo.c_str(), REPLY_NONE);
 }
 
 // const std::string &param: represent for log_id and log_time string
 void SyncCommand::ClearEventLog(const std::string &param, QObject *target, const std::string &slot)
 {
     InitParseHandler(target, slot);
-    qint64 sz = socket_->write((Command::ClearEventInfo + param).c_str());
-    qDebug() << (Command::ClearEventInfo + param).c_str() << " bytes:" << sz;
+    PostRequest((Command::ClearEventInfo + param).c_str(), REPLY_NONE);
 }
 
 void SyncCommand::ClearEventLog(const std::string &param)
 {
     if (target_obj_ != NULL && !slot_.empty())
     {
-        qint64 sz = socket_->write((Command::ClearEventInfo + param).c_str());
-        qDebug() << (Command::ClearEventInfo + param).c_str() << "bytes:" << sz;
+        PostRequest((Command::ClearEventInfo + param).c_str(), REPLY_NONE);
     }
 }
 
 void SyncCommand::StartMonitoring(QObject *target, const std::string &slot)
 {
     InitParseHandler(target, slot);
-    qint64 sz = socket_->write(Command::BeginMonitor.c_str());
-    qDebug() << Command::BeginMonitor.c_str() << " bytes:" << sz;
+    StartMonitoring();
 }
 
+// pushes go to the current handler from now on, also after a reconnect
 void SyncCommand::StartMonitoring()
 {
     if (target_obj_ != NULL && !slot_.empty())
     {
-        qint64 sz = socket_->write(Command::BeginMonitor.c_str());
-        qDebug() << Command::BeginMonitor.c_str() << " bytes:" << sz;
+        monitor_obj_ = target_obj_;
+        monitor_method_ = target_method_;
+        monitoring_ = true;
+        PostRequest(Command::BeginMonitor.c_str(), REPLY_NONE);
     }
 }
 
 void SyncCommand::StopMonitoring(QObject *target, const std::string &slot)
 {
     InitParseHandler(target, slot);
-    qint64 sz = socket_->write(Command::EndMonitor.c_str());
-    qDebug() << Command::EndMonitor.c_str() << " bytes:" << sz;
+    monitoring_ = false;
+    monitor_obj_ = NULL;
+    monitor_method_ = -1;
+    PostRequest(Command::EndMonitor.c_str(), REPLY_NONE);
 }
 
 void SyncCommand::StopMonitoring()
 {
     UnRegParseHandler();
-    qint64 sz = socket_->write(Command::EndMonitor.c_str());
-    qDebug() << Command::EndMonitor.c_str() << " bytes:" << sz;
+    monitoring_ = false;
+    monitor_obj_ = NULL;
+    monitor_method_ = -1;
+    PostRequest(Command::EndMonitor.c_str(), REPLY_NONE);
 }
 
 void SyncCommand::GetLightStatus(QObject *target, const std::string &slot)
 {
     InitParseHandler(target, slot);
-    qint64 sz = socket_->write(Command::GetLampStatus.c_str());
-    qDebug() << Command::GetLampStatus.c_str() << " bytes:" << sz;
+    PostRequest(Command::GetLampStatus.c_str(), CytDecoder::LightStatus);
 }
 
 void SyncCommand::GetLightStatus()
 {
     if (target_obj_ != NULL && !slot_.empty())
     {
-        qint64 sz = socket_->write(Command::GetLampStatus.c_str());
-        qDebug() << Command::GetLampStatus.c_str() << " bytes:" << sz;
+        PostRequest(Command::GetLampStatus.c_str(), CytDecoder::LightStatus);
     }
 }
 
@@ -172,56 +180,49 @@ void SyncCommand::GetTscTime()
 {
     if (target_obj_ != NULL && !slot_.empty())
     {
-        qint64 sz = socket_->write(Command::GetTSCtime.c_str());
-        qDebug() << Command::GetTSCtime.c_str() << " bytes:" << sz;
+        PostRequest(Command::GetTSCtime.c_str(), CytDecoder::TscTime);
     }
 }
 
 void SyncCommand::GetDetectorFlowData(QObject *target, const std::string &slot)
 {
     InitParseHandler(target, slot);
-    qint64 sz = socket_->write(Command::GetDetectInfo.c_str());
-    qDebug() << Command::GetDetectInfo.c_str() << " bytes:" << sz;
+    PostRequest(Command::GetDetectInfo.c_str(), CytDecoder::DetectorFlow);
 }
 
 void SyncCommand::GetDetectorFlowData()
 {
     if (target_obj_ != NULL && !slot_.empty())
     {
-        qint64 sz = socket_->write(Command::GetDetectInfo.c_str());
-        qDebug() << Command::GetDetectInfo.c_str() << " bytes:" << sz;
+        PostRequest(Command::GetDetectInfo.c_str(), CytDecoder::DetectorFlow);
     }
 }
 
 void SyncCommand::ClearDetectorFlowInfo(QObject *target, const std::string &slot)
 {
     InitParseHandler(target, slot);
-    qint64 sz = socket_->write(Command::ClearDetectInfo.c_str());
-    qDebug() << Command::ClearDetectInfo.c_str() << " bytes:" << sz;
+    PostRequest(Command::ClearDetectInfo.c_str(), REPLY_NONE);
 }
 
 void SyncCommand::ClearDetectorFlowInfo()
 {
     if (target_obj_ != NULL && !slot_.empty())
     {
-        qint64 sz = socket_->write(Command::ClearDetectInfo.c_str());
-        qDebug() << Command::ClearDetectInfo.c_str() << " bytes:" << sz;
+        PostRequest(Command::ClearDetectInfo.c_str(), REPLY_NONE);
     }
 }
 
 void SyncCommand::GetDriverBoardInfo(QObject *target, const std::string &slot)
 {
     InitParseHandler(target, slot);
-    qint64 sz = socket_->write(Command::GetDriverInfo.c_str());
-    qDebug() << Command::GetDriverInfo.c_str() << " bytes:" << sz;
+    PostRequest(Command::GetDriverInfo.c_str(), CytDecoder::DriverStatus);
 }
 
 void SyncCommand::GetDriverBoardInfo()
 {
     if (target_obj_ != NULL && !slot_.empty())
     {
-        qint64 sz = socket_->write(Command::GetDriverInfo.c_str());
-        qDebug() << Command::GetDriverInfo.c_str() << " bytes:" << sz;
+        PostRequest(Command::GetDriverInfo.c_str(), CytDecoder::DriverStatus);
     }
 }
 
@@ -235,8 +236,7 @@ void SyncCommand::SyncSignalerTime(unsigned int seconds, QObject *target, const
     InitParseHandler(target, slot);
     char temp[11] = {'C','Y','T','7','\0','\0','\0','\0','E','N','D'};
     memcpy(temp+4, &seconds, sizeof(seconds));
-    qint64 sz = socket_->write(temp);
-    qDebug() << temp << " bytes:" << sz;
+    PostRequest(QByteArray(temp, sizeof(temp)), REPLY_NONE);
 }
 
 void SyncCommand::ConfigNetwork(const QStringList &net_info, QObject *target, const std::string &slot)
@@ -244,8 +244,7 @@ void SyncCommand::ConfigNetwork(const QStringList &net_info, QObject *target, co
     InitParseHandler(target, slot);
     QString cmd_str("CYT8,DHCP=\"%1\",DefaultGateway=\"%2\",IPAddress=\"%3\",SubnetMask=\"%4\",END");
     cmd_str = cmd_str.arg(net_info.at(0)).arg(net_info.at(1)).arg(net_info.at(2)).arg(net_info.at(3));
-    qint64 sz = socket_->write(cmd_str.toStdString().c_str());
-    qDebug() << cmd_str << " bytes:" << sz;
+    PostRequest(cmd_str.toLatin1(), REPLY_NONE);
 }
 
 void SyncCommand::ConnectConfigNetworkHandler(QObject *target, const std::string &slot)
@@ -256,31 +255,39 @@ void SyncCommand::ConnectConfigNetworkHandler(QObject *target, const std::string
 void SyncCommand::SetConfiguration(QObject *target, const std::string &slot)
 {
     InitParseHandler(target, slot);
-    qint64 sz = socket_->write(Command::SetConfigure.c_str());
-    qDebug() << Command::SetConfigure.c_str() << " bytes:" << sz;
+    PostRequest(Command::SetConfigure.c_str(), REPLY_NONE);
 }
 
 void SyncCommand::SendConfigData(const QByteArray &byte_array, QObject *target, const std::string &slot)
 {
     InitParseHandler(target, slot);
-    qint64 sz = socket_->write(byte_array);
-    qDebug() << "Send signaler config file bytes:" << sz;
+    PostRequest(byte_array, REPLY_NONE);
 }
 
 void SyncCommand::ReadTscVersion(QObject *target, const std::string &slot)
 {
     InitParseHandler(target, slot);
-    qint64 sz = socket_->write(Command::GetVerId.c_str());
-    qDebug() << Command::GetVerId.c_str() << " bytes:" << sz;
+    PostRequest(Command::GetVerId.c_str(), CytDecoder::VersionId);
 }
 
 void SyncCommand::OnConnectEstablished()
 {
+    connect_timer_->stop();
+    reconnect_ms_ = RECONNECT_MIN_TIME;
+    last_rx_ms_ = FrameClock::msecs();
+    heartbeat_timer_->start();
+    SetConnState(Connected);
     emit connectedSignal();
+    if (monitoring_)
+    {
+        // resubscribe, the pushes still go to the monitoring handler
+        QueueRequest(Command::BeginMonitor.c_str(), REPLY_NONE, NULL, -1, 0);
+    }
 }
 
 void SyncCommand::OnDisconnected()
 {
+    LinkLost();
     emit disconnectedSignal();
 }
 
@@ -288,6 +295,86 @@ void SyncCommand::OnConnectError(QAbstractSocket::SocketError err)
 {
     emit connectErrorSignal();
     emit connectErrorStrSignal(socket_err_desc_.value(err));
+    LinkLost();
+}
+
+void SyncCommand::connectTimeoutSlot()
+{
+    if (conn_state_ != Connecting)
+    {
+        return;
+    }
+    emit connectErrorStrSignal(socket_err_desc_.value(QAbstractSocket::SocketTimeoutError));
+    LinkLost();
+}
+
+void SyncCommand::reconnectTimeoutSlot()
+{
+    if (conn_state_ == WaitReconnect && auto_reconnect_)
+    {
+        StartConnect();
+    }
+}
+
+// anything received counts as a heartbeat, a silent link is asked for its version
+void SyncCommand::heartbeatTimeoutSlot()
+{
+    qint64 silent_ms = FrameClock::msecs() - last_rx_ms_;
+    if (silent_ms >= HEARTBEAT_TIME * HEARTBEAT_MISSES)
+    {
+        qDebug() << ip_ << "no heartbeat for" << silent_ms << "ms";
+        emit connectErrorStrSignal(socket_err_desc_.value(QAbstractSocket::SocketTimeoutError));
+        LinkLost();
+    }
+    else if (silent_ms >= HEARTBEAT_TIME)
+    {
+        QueueRequest(Command::GetVerId.c_str(), CytDecoder::VersionId, NULL, -1, 0);     // probes are not resent
+    }
+}
+
+void SyncCommand::StartConnect()
+{
+    ClearRequests();
+    // a disconnect caused here is not a lost link
+    socket_->blockSignals(true);
+    socket_->abort();
+    socket_->blockSignals(false);
+    SetConnState(Connecting);
+    socket_->connectToHost(ip_, port_);
+    connect_timer_->start(CONNECT_WAIT_TIME);
+}
+
+// the link is gone, try again later unless the user closed it
+void SyncCommand::LinkLost()
+{
+    if (conn_state_ != Connecting && conn_state_ != Connected)
+    {
+        return;
+    }
+    connect_timer_->stop();
+    heartbeat_timer_->stop();
+    ClearRequests();
+    if (!auto_reconnect_)
+    {
+        SetConnState(Unconnected);
+        return;
+    }
+    SetConnState(WaitReconnect);
+    socket_->abort();
+    int delay = reconnect_ms_ + jitter_random_.bounded(reconnect_ms_ / 4 + 1);  // jitter, controllers do not reconnect in step
+    reconnect_ms_ = qMin(reconnect_ms_ * 2, RECONNECT_MAX_TIME);
+    reconnect_timer_->start(delay);
+    emit reconnectingSignal(delay);
+}
+
+void SyncCommand::SetConnState(ConnState state)
+{
+    if (conn_state_ == state)
+    {
+        return;
+    }
+    conn_state_ = state;
+    emit connStateChanged(state);
 }
 
 void SyncCommand::parseReply()
@@ -306,7 +393,57 @@ void SyncCommand::parseReply()
 void SyncCommand::socketReadyReadSlot()
 {
     sock_array_ = socket_->readAll();
-    emit readyRead(sock_array_);
+    last_rx_ms_ = FrameClock::msecs();
+    if (trace_ != NULL)
+    {
+        trace_->append(FrameClock::usecs(), sock_array_);
+    }
+    replayData(sock_array_);
+}
+
+void SyncCommand::replayData(const QByteArray &data)
+{
+    parser_.feed(data);
+    QByteArray message;
+    CytParser::Result result = CytParser::NeedMore;
+    while ((result = parser_.next(message)) != CytParser::NeedMore)
+    {
+        if (result == CytParser::Chunk || result == CytParser::LastChunk)
+        {
+            emit chunkReceived(parser_.streamId(), message, result == CytParser::LastChunk);
+            DispatchReply(parser_.streamId(), message, result == CytParser::LastChunk);
+            continue;
+        }
+        char reply_id = CytParser::commandId(message);
+        if (result == CytParser::ErrorReply)
+        {
+            // the signaler answers a request it has no data for with bare text
+            reply_id = (message == "DETECTDATAER") ? CytDecoder::DetectorFlow : CytDecoder::DriverStatus;
+        }
+        emit readyRead(message);
+        emit messageReceived(message);
+        DispatchReply(reply_id, message);
+    }
+}
+
+void SyncCommand::requestTimerTimeoutSlot()
+{
+    qint64 now = FrameClock::msecs();
+    for (int i = in_flight_list_.size() - 1; i >= 0; i--)
+    {
+        if (now - in_flight_list_.at(i).sent_ms >= REPLY_WAIT_TIME)
+        {
+            Request req = in_flight_list_.takeAt(i);
+            if (req.retries > 0)
+            {
+                req.retries--;
+                request_queue_.prepend(req);
+                continue;
+            }
+            qDebug() << req.command.left(16) << "no reply, dropped";
+        }
+    }
+    WriteRequest();
 }
 
 void SyncCommand::GenConnectErrDesc()
@@ -338,6 +475,30 @@ SyncCommand::SyncCommand(QObject *parent) :
 {
     socket_ = new QTcpSocket(this);
     target_obj_ = NULL;
+    target_method_ = -1;
+    monitor_obj_ = NULL;
+    monitor_method_ = -1;
+    monitoring_ = false;
+    trace_ = NULL;
+    CytDecoder::registerFraming(parser_);
+    parser_.setStreamed(CytDecoder::Config, true);
+    request_timer_ = new QTimer(this);
+    request_timer_->setInterval(REPLY_WAIT_TIME / 4);
+    connect(request_timer_, SIGNAL(timeout()), this, SLOT(requestTimerTimeoutSlot()));
+
+    conn_state_ = Unconnected;
+    auto_reconnect_ = false;
+    reconnect_ms_ = RECONNECT_MIN_TIME;
+    last_rx_ms_ = 0;
+    connect_timer_ = new QTimer(this);
+    connect_timer_->setSingleShot(true);
+    connect(connect_timer_, SIGNAL(timeout()), this, SLOT(connectTimeoutSlot()));
+    reconnect_timer_ = new QTimer(this);
+    reconnect_timer_->setSingleShot(true);
+    connect(reconnect_timer_, SIGNAL(timeout()), this, SLOT(reconnectTimeoutSlot()));
+    heartbeat_timer_ = new QTimer(this);
+    heartbeat_timer_->setInterval(HEARTBEAT_TIME);
+    connect(heartbeat_timer_, SIGNAL(timeout()), this, SLOT(heartbeatTimeoutSlot()));
 //    connect(socket_, SIGNAL(readyRead()), this, SLOT(parseReply()));
     connect(socket_, SIGNAL(connected()), this, SLOT(OnConnectEstablished()));
     connect(socket_, SIGNAL(error(QAbstractSocket::SocketError)), this, SLOT(OnConnectError(QAbstractSocket::SocketError)));
@@ -349,32 +510,172 @@ SyncCommand::SyncCommand(QObject *parent) :
 
 SyncCommand::~SyncCommand()
 {
+    stopTrace();
     delete socket_;
     socket_ = NULL;
 }
 
-
-void SyncCommand::RegParseHandler()
+bool SyncCommand::startTrace(const QString &path)
 {
-    if ((target_obj_ != NULL) && (!slot_.empty()))
+    stopTrace();
+    trace_ = new TraceFile;
+    if (!trace_->create(path))
     {
-        connect(this, SIGNAL(readyRead(QByteArray&)), target_obj_, slot_.c_str());
+        qDebug() << "create trace file failed:" << path << trace_->errorString();
+        stopTrace();
+        return false;
     }
+    return true;
 }
 
-void SyncCommand::UnRegParseHandler()
+void SyncCommand::stopTrace()
 {
-    if ((target_obj_ != NULL) && (!slot_.empty()))
+    if (trace_ != NULL)
     {
-        disconnect(this, SIGNAL(readyRead(QByteArray&)), target_obj_, slot_.c_str());
+        delete trace_;
+        trace_ = NULL;
     }
 }
 
+bool SyncCommand::isTracing() const
+{
+    return trace_ != NULL;
+}
+
+
+void SyncCommand::RegParseHandler()
+{
+    target_method_ = MethodIndex(target_obj_, slot_);
+}
+
+void SyncCommand::UnRegParseHandler()
+{
+    target_obj_ = NULL;
+    slot_.clear();
+    target_method_ = -1;
+}
+
+// handler of the next requests and of the messages nobody asked for
 void SyncCommand::InitParseHandler(QObject *target, const std::string &slot)
 {
     UnRegParseHandler();
     target_obj_ = target;
     slot_ = slot;
     RegParseHandler();
-    socket_->readAll();
+}
+
+/* Queues a command for the current handler. A request expecting reply_id
+ * stays in flight until a message of that type arrives, so requests for
+ * different data do not wait on each other. A command still waiting to be
+ * written is not queued twice.
+*/
+void SyncCommand::PostRequest(const QByteArray &command, char reply_id)
+{
+    QueueRequest(command, reply_id, target_obj_, target_method_, target_obj_ != NULL ? REQUEST_RETRY_COUNT : 0);
+}
+
+void SyncCommand::QueueRequest(const QByteArray &command, char reply_id, QObject *target, int method, int retries)
+{
+    for (int i = 0; i < request_queue_.size(); i++)
+    {
+        const Request &req = request_queue_.at(i);
+        if (req.command == command && req.target == target && req.method == method)
+        {
+            return;
+        }
+    }
+    Request req;
+    req.command = command;
+    req.reply_id = reply_id;
+    req.target = target;
+    req.method = method;
+    req.sent_ms = 0;
+    req.retries = retries;
+    request_queue_.append(req);
+    WriteRequest();
+}
+
+void SyncCommand::WriteRequest()
+{
+    while (!request_queue_.isEmpty() && in_flight_list_.size() < MAX_REQUESTS_IN_FLIGHT)
+    {
+        Request req = request_queue_.takeFirst();
+        qint64 sz = socket_->write(req.command);
+        qDebug() << req.command.left(16) << " bytes:" << sz;
+        if (req.reply_id != REPLY_NONE && sz > 0)
+        {
+            req.sent_ms = FrameClock::msecs();
+            in_flight_list_.append(req);
+        }
+    }
+    if (in_flight_list_.isEmpty())
+    {
+        request_timer_->stop();
+    }
+    else if (!request_timer_->isActive())
+    {
+        request_timer_->start();
+    }
+}
+
+// the oldest request waiting for this type gets the reply, anything else was pushed
+// and goes to the monitoring handler, or the current one when not monitoring
+// a request stays in flight until the last piece of a streamed reply
+void SyncCommand::DispatchReply(char reply_id, QByteArray &message, bool complete)
+{
+    for (int i = 0; i < in_flight_list_.size(); i++)
+    {
+        if (in_flight_list_.at(i).reply_id == reply_id)
+        {
+            if (!complete)
+            {
+                in_flight_list_[i].sent_ms = FrameClock::msecs();     // still arriving, no timeout
+                InvokeHandler(in_flight_list_.at(i).target, in_flight_list_.at(i).method, message);
+                return;
+            }
+            Request req = in_flight_list_.takeAt(i);
+            WriteRequest();
+            InvokeHandler(req.target, req.method, message);
+            return;
+        }
+    }
+    if (monitor_obj_ != NULL)
+    {
+        InvokeHandler(monitor_obj_, monitor_method_, message);
+        return;
+    }
+    InvokeHandler(target_obj_, target_method_, message);
+}
+
+void SyncCommand::InvokeHandler(QObject *target, int method, QByteArray &message)
+{
+    if (target == NULL || method < 0)
+    {
+        return;
+    }
+    target->metaObject()->method(method).invoke(target, Qt::DirectConnection, Q_ARG(QByteArray&, message));
+}
+
+void SyncCommand::ClearRequests()
+{
+    request_queue_.clear();
+    in_flight_list_.clear();
+    request_timer_->stop();
+    parser_.clear();
+}
+
+// slot is a SLOT() string, its first char is the method code
+int SyncCommand::MethodIndex(QObject *target, const std::string &slot)
+{
+    if (target == NULL || slot.size() < 2)
+    {
+        return -1;
+    }
+    QByteArray sig = QMetaObject::normalizedSignature(slot.c_str() + 1);
+    int idx = target->metaObject()->indexOfMethod(sig.constData());
+    if (idx < 0)
+    {
+        qDebug() << "no handler" << sig;
+    }
+    return idx;
 }
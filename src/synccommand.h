@@ -4,6 +4,12 @@
 #include <QtCore>
 #include <QTcpSocket>
 #include <QMap>
+#include <QList>
+#include <QPointer>
+#include "cytparser.h"
+#include "fastrandom.h"
+
+class TraceFile;
 
 #define CONNECT_WAIT_TIME   (2000)
 #define WRITE_WAIT_TIME     (30000)
@@ -11,14 +17,39 @@
 #define VERSION_CHECK_TIME  (3000)
 
 #define REPLY_HEAD_FIX      ("CYT")
-
+#define REPLY_WAIT_TIME     (3000)      // a request without reply is dropped after this
+#define REPLY_NONE          ('\0')      // request that is not answered, never in flight
+#define MAX_REQUESTS_IN_FLIGHT  (4)
+#define REQUEST_RETRY_COUNT (2)         // resends of a request that got no reply
+#define RECONNECT_MIN_TIME  (1000)
+#define RECONNECT_MAX_TIME  (60000)     // backoff doubles up to this
+#define HEARTBEAT_TIME      (5000)      // a link silent this long is probed
+#define HEARTBEAT_MISSES    (3)         // silent periods before the link is taken as dead
+
+/* One signaler connection: socket, reply parser and request queue.
+ * connectToHost() never blocks. A refused, timed out or lost connection is
+ * retried with exponential backoff until disconnectFromHost(); a silent link
+ * is probed with GetVerId and dropped when the probes stay unanswered.
+ * Monitoring is resumed by itself after a reconnect.
+ * SessionManager creates one per controller; one running in a worker
+ * thread is talked to only through the slots and signals.
+*/
 class SyncCommand : public QObject
 {
     Q_OBJECT
 
 public:
-    static SyncCommand *GetInstance();
-    void DistroyInstance();
+    explicit SyncCommand(QObject *parent = 0);
+    ~SyncCommand();
+
+    enum ConnState
+    {
+        Unconnected = 0,
+        Connecting,
+        Connected,
+        WaitReconnect
+    };
+
     QTcpSocket *getSocket();
 
     void setSocketAddress(const QString &ip, unsigned int port);
@@ -26,8 +57,8 @@ public:
     unsigned int getSocketPort() const;
 
     void connectToHost(const QString &ip, unsigned int port);
-    bool syncConnectToHost(const QString &ip, unsigned port);
-    void closeConnection();
+    ConnState connState() const;
+    bool isMonitoring() const;
     bool isConnectionValid() const;
     void InitParseHandler(QObject *target, const std::string &slot);
     void ReleaseSignalSlots();
@@ -63,16 +94,33 @@ public:
     void GetDriverBoardInfo(QObject *target, const std::string &slot);
     void GetDriverBoardInfo();
 
+    // every socket read goes to a trace file, see TraceReplayer
+    bool startTrace(const QString &path);
+    void stopTrace();
+    bool isTracing() const;
+
 signals:
     void connectedSignal();
     void connectErrorSignal();
     void connectErrorStrSignal(const QString&);
     void disconnectedSignal();
+    void connStateChanged(int state);
+    void reconnectingSignal(int msecs);     // next attempt after msecs
 
     void readyRead(QByteArray &content);
     void readyRead();
+    // every framed message, also across threads
+    void messageReceived(const QByteArray &message);
+    // piece of a streamed reply (the config), last is set for its tail
+    void chunkReceived(char cmd_id, const QByteArray &chunk, bool last);
 
 public slots:
+    void openConnection();
+    void closeConnection();
+    void postCommand(const QByteArray &command, char reply_id);
+    // handles data as if read from the socket, for trace replays
+    void replayData(const QByteArray &data);
+
     void OnConnectEstablished();
     void OnDisconnected();
     void OnConnectError(QAbstractSocket::SocketError);
@@ -80,17 +128,25 @@ public slots:
 private slots:
     void parseReply();
     void socketReadyReadSlot();
+    void requestTimerTimeoutSlot();
+    void connectTimeoutSlot();
+    void reconnectTimeoutSlot();
+    void heartbeatTimeoutSlot();
 
 private:
+    void PostRequest(const QByteArray &command, char reply_id);
+    void QueueRequest(const QByteArray &command, char reply_id, QObject *target, int method, int retries);
     void WriteRequest();
+    void DispatchReply(char reply_id, QByteArray &message, bool complete = true);
+    void InvokeHandler(QObject *target, int method, QByteArray &message);
+    void ClearRequests();
+    void StartConnect();
+    void LinkLost();
+    void SetConnState(ConnState state);
     void RegParseHandler();
     void UnRegParseHandler();
     void GenConnectErrDesc();
-
-private:
-    SyncCommand(QObject *parent = 0);
-    ~SyncCommand();
-    static SyncCommand *instance_;
+    static int MethodIndex(QObject *target, const std::string &slot);
 
 private:
     QTcpSocket *socket_;
@@ -100,6 +156,37 @@ private:
 
     QObject *target_obj_;
     std::string slot_;
+    int target_method_;     // method index of slot_ in target_obj_
+    QObject *monitor_obj_;  // handler of the monitoring pushes
+    int monitor_method_;
+    bool monitoring_;
+
+    // a queued command and the handler its reply goes to
+    typedef struct RequestTag
+    {
+        QByteArray command;
+        char reply_id;
+        QPointer<QObject> target;
+        int method;
+        qint64 sent_ms;
+        int retries;
+    }Request;
+
+    CytParser parser_;
+    QList<Request> request_queue_;
+    QList<Request> in_flight_list_;
+    QTimer *request_timer_;
+
+    ConnState conn_state_;
+    bool auto_reconnect_;       // set by connectToHost, cleared by an explicit disconnect
+    int reconnect_ms_;
+    FastRandom jitter_random_;  // seeded per controller, sessions back off apart
+    qint64 last_rx_ms_;
+    QTimer *connect_timer_;
+    QTimer *reconnect_timer_;
+    QTimer *heartbeat_timer_;
+
+    TraceFile *trace_;      // NULL when not tracing
 
     QMap<QAbstractSocket::SocketError, QString> socket_err_desc_;
 };
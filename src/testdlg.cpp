@@ -2,11 +2,14 @@
 #include "macrostrings.h"
 #include "roadbranchwidget.h"
 #include "mutility.h"
+#include "synccommand.h"
+#include "tracereplayer.h"
 
 #include <QPushButton>
 #include <QComboBox>
 #include <QGridLayout>
-#include <QDir>
+
+#define TRACE_FILE_NAME     "protocol.trc"
 
 #define DETECTOR_TEST_MACRO(signal) \
     int id = channel_id_cmb_->currentText().toInt(); \
@@ -34,6 +37,8 @@
 TestDlg::TestDlg(QWidget *parent) :
     QDialog(parent)
 {
+    replayer_ = new TraceReplayer(this);
+    sync_cmd_ = NULL;
     initPage();
     initSignalSlots();
 }
@@ -43,6 +48,11 @@ void TestDlg::setPtr(RoadBranchWidget *ptr)
     widget_ = ptr;
 }
 
+void TestDlg::setSession(SyncCommand *session)
+{
+    sync_cmd_ = session;
+}
+
 void TestDlg::OnOKButtonClicked()
 {
     LIGHT_TEST_MACRO(showChannelLightSignal(id, color))
@@ -92,39 +102,39 @@ void TestDlg::OnCancelSDetectorButtonClicked()
     DETECTOR_TEST_MACRO(showSidewalkDetectorSignal(index, color, false))
 }
 
+// records the socket reads of the gui connection
 void TestDlg::OnGenDataButtonClicked()
 {
-    QString dir = MUtility::getTempDir();
-    QString postfix = "test.dat";
-    QDir file_dir;
-    file_dir.setPath(dir);
-    QStringList fd_list = file_dir.entryList(QDir::Files, QDir::NoSort);
-    int sz = fd_list.size();
-    QFile file_w(MUtility::getConfigDir()+"result.dat");
-    file_w.open(QIODevice::WriteOnly | QIODevice::Append);
-    for (int i = 1; i <= sz; i++)
+    if (sync_cmd_ == NULL)
     {
-        QFile file(dir + QString::number(i) + postfix);
-        file.open(QIODevice::ReadOnly);
-        QByteArray data_arr = file.readAll();
-        data_arr.indexOf("CYT");
-        int tail_idx = data_arr.indexOf("END");
-        QByteArray first_line = data_arr.left(tail_idx+3);
-        file_w.write(first_line);
-        file.close();
+        return;
+    }
+    if (sync_cmd_->isTracing())
+    {
+        sync_cmd_->stopTrace();
+        gen_data_button_->setText("record trace");
+        return;
+    }
+    if (sync_cmd_->startTrace(MUtility::getTempDir() + TRACE_FILE_NAME))
+    {
+        gen_data_button_->setText("stop trace");
     }
-    file_w.close();
 }
 
+// plays the recorded reads back with their original spacing
 void TestDlg::OnReadDataButtonClicked()
 {
-    QString dir = MUtility::getConfigDir() + "result.dat";
-    QFile file(dir);
-    if (!file.open(QIODevice::ReadOnly))
+    if (!replayer_->open(MUtility::getTempDir() + TRACE_FILE_NAME))
     {
         return;
     }
-    QByteArray array = file.readAll();
+    replayer_->setSpeed(1);
+    replayer_->start();
+}
+
+void TestDlg::traceDataReadSlot(const QByteArray &data)
+{
+    QByteArray array(data.constData(), data.size());
     emit sendNetworkByteArray(array);
 }
 
@@ -137,8 +147,8 @@ void TestDlg::initPage()
     sidewalk_detector_button_ = new QPushButton("Sidewalk");
     cancel_sidewalk_d_button_ = new QPushButton("S cancel");
 
-    gen_data_button_ = new QPushButton("test data");
-    read_test_button_ = new QPushButton("read data");
+    gen_data_button_ = new QPushButton("record trace");
+    read_test_button_ = new QPushButton("replay trace");
 
     color_cmb_ = new QComboBox;
     color_cmb_->addItem("Red");
@@ -181,4 +191,5 @@ void TestDlg::initSignalSlots()
 
     connect(gen_data_button_, SIGNAL(clicked()), this, SLOT(OnGenDataButtonClicked()));
     connect(read_test_button_, SIGNAL(clicked()), this, SLOT(OnReadDataButtonClicked()));
+    connect(replayer_, SIGNAL(dataRead(QByteArray)), this, SLOT(traceDataReadSlot(QByteArray)));
 }
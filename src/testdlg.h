@@ -7,6 +7,8 @@ class QPushButton;
 class QLineEdit;
 class QComboBox;
 class RoadBranchWidget;
+class TraceReplayer;
+class SyncCommand;
 
 class TestDlg : public QDialog
 {
@@ -14,6 +16,7 @@ class TestDlg : public QDialog
 public:
     explicit TestDlg(QWidget *parent = 0);
     void setPtr(RoadBranchWidget *ptr);
+    void setSession(SyncCommand *session);
 
 signals:
     void showChannelLightSignal(int channel_id, int color);
@@ -32,6 +35,7 @@ public slots:
 
     void OnGenDataButtonClicked();
     void OnReadDataButtonClicked();
+    void traceDataReadSlot(const QByteArray &data);
 
 private:
     void initPage();
@@ -45,6 +49,8 @@ private:
     QComboBox *channel_id_cmb_;
 
     RoadBranchWidget *widget_;
+    SyncCommand *sync_cmd_;     // connection of the gui, NULL until one is opened
+    TraceReplayer *replayer_;
 };
 
 #endif // TESTDLG_H
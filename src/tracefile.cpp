@@ -0,0 +1,147 @@
+#include "tracefile.h"
+
+#include <string.h>
+
+TraceFile::TraceFile()
+{
+    map_ = NULL;
+    total_bytes_ = 0;
+    writing_ = false;
+}
+
+TraceFile::~TraceFile()
+{
+    close();
+}
+
+bool TraceFile::create(const QString &path)
+{
+    close();
+    file_.setFileName(path);
+    if (!file_.open(QIODevice::WriteOnly | QIODevice::Truncate))
+    {
+        return false;
+    }
+    char header[TRACE_HEADER_SIZE] = {'\0'};
+    memcpy(header, TRACE_MAGIC, 8);
+    if (file_.write(header, TRACE_HEADER_SIZE) != TRACE_HEADER_SIZE)
+    {
+        file_.close();
+        return false;
+    }
+    writing_ = true;
+    return true;
+}
+
+bool TraceFile::append(qint64 time_us, const char *data, int len)
+{
+    if (!writing_ || len < 0)
+    {
+        return false;
+    }
+    char head[TRACE_RECORD_HEAD];
+    quint32 length = len;
+    memcpy(head, &time_us, sizeof(time_us));
+    memcpy(head + sizeof(time_us), &length, sizeof(length));
+    total_bytes_ += len;
+    return file_.write(head, TRACE_RECORD_HEAD) == TRACE_RECORD_HEAD
+            && file_.write(data, len) == len;
+}
+
+bool TraceFile::append(qint64 time_us, const QByteArray &data)
+{
+    return append(time_us, data.constData(), data.size());
+}
+
+bool TraceFile::openRead(const QString &path)
+{
+    close();
+    file_.setFileName(path);
+    if (!file_.open(QIODevice::ReadOnly))
+    {
+        return false;
+    }
+    qint64 size = file_.size();
+    if (size < TRACE_HEADER_SIZE)
+    {
+        file_.close();
+        return false;
+    }
+    map_ = file_.map(0, size);
+    if (map_ == NULL)
+    {
+        file_.close();
+        return false;
+    }
+    if (memcmp(map_, TRACE_MAGIC, 8) != 0)
+    {
+        close();
+        return false;
+    }
+    qint64 pos = TRACE_HEADER_SIZE;
+    while (pos + TRACE_RECORD_HEAD <= size)
+    {
+        quint32 length = 0;
+        memcpy(&length, map_ + pos + sizeof(qint64), sizeof(length));
+        if (pos + TRACE_RECORD_HEAD + length > size)
+        {
+            break;
+        }
+        offset_list_.append(pos);
+        total_bytes_ += length;
+        pos += TRACE_RECORD_HEAD + length;
+    }
+    return true;
+}
+
+int TraceFile::count() const
+{
+    return offset_list_.size();
+}
+
+qint64 TraceFile::time(int index) const
+{
+    qint64 time_us = 0;
+    memcpy(&time_us, map_ + offset_list_.at(index), sizeof(time_us));
+    return time_us;
+}
+
+QByteArray TraceFile::data(int index) const
+{
+    const uchar *rec = map_ + offset_list_.at(index);
+    quint32 length = 0;
+    memcpy(&length, rec + sizeof(qint64), sizeof(length));
+    return QByteArray::fromRawData((const char *)rec + TRACE_RECORD_HEAD, length);
+}
+
+// payload bytes of all records, written or read
+qint64 TraceFile::totalBytes() const
+{
+    return total_bytes_;
+}
+
+void TraceFile::close()
+{
+    if (map_ != NULL)
+    {
+        file_.unmap((uchar *)map_);
+        map_ = NULL;
+    }
+    if (file_.isOpen())
+    {
+        file_.close();
+    }
+    offset_list_.clear();
+    total_bytes_ = 0;
+    writing_ = false;
+}
+
+bool TraceFile::isOpen() const
+{
+    return file_.isOpen();
+}
+
+QString TraceFile::errorString() const
+{
+    return file_.errorString();
+}
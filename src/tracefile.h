@@ -0,0 +1,48 @@
+#ifndef TRACEFILE_H
+#define TRACEFILE_H
+
+#include <QFile>
+#include <QString>
+#include <QByteArray>
+#include <QVector>
+
+#define TRACE_MAGIC             "SIMTRC01"
+#define TRACE_HEADER_SIZE       16
+#define TRACE_RECORD_HEAD       12      // time_us (qint64) + length (quint32)
+
+/* Append-only trace of the bytes read from a signaler socket.
+ * Header: magic[8], reserved (8 bytes). Every socket read is one record:
+ * FrameClock time in us, length, then the bytes as read, with no padding
+ * and in native byte order. Reading maps the file and indexes the record
+ * offsets once; a torn last record is ignored.
+*/
+class TraceFile
+{
+public:
+    TraceFile();
+    ~TraceFile();
+
+    bool create(const QString &path);
+    bool append(qint64 time_us, const char *data, int len);
+    bool append(qint64 time_us, const QByteArray &data);
+
+    bool openRead(const QString &path);
+    int count() const;
+    qint64 time(int index) const;
+    // shares the mapped data, valid until close()
+    QByteArray data(int index) const;
+    qint64 totalBytes() const;
+
+    void close();
+    bool isOpen() const;
+    QString errorString() const;
+
+private:
+    QFile file_;
+    const uchar *map_;
+    QVector<qint64> offset_list_;   // record offsets in the mapped file
+    qint64 total_bytes_;
+    bool writing_;
+};
+
+#endif // TRACEFILE_H
@@ -0,0 +1,103 @@
+#include "tracereplayer.h"
+#include "cytparser.h"
+#include "frameclock.h"
+
+#include <QTimer>
+
+TraceReplayer::TraceReplayer(QObject *parent) :
+    QObject(parent)
+{
+    timer_ = new QTimer(this);
+    timer_->setSingleShot(true);
+    timer_->setTimerType(Qt::PreciseTimer);
+    connect(timer_, SIGNAL(timeout()), this, SLOT(replayTimeoutSlot()));
+    speed_ = 1;
+    next_ = 0;
+    start_us_ = 0;
+    base_us_ = 0;
+}
+
+bool TraceReplayer::open(const QString &path)
+{
+    stop();
+    next_ = 0;
+    return file_.openRead(path);
+}
+
+void TraceReplayer::setSpeed(double speed)
+{
+    speed_ = speed > 0 ? speed : 0;
+}
+
+int TraceReplayer::count() const
+{
+    return file_.count();
+}
+
+int TraceReplayer::position() const
+{
+    return next_;
+}
+
+void TraceReplayer::start()
+{
+    next_ = 0;
+    if (file_.count() == 0)
+    {
+        emit finished();
+        return;
+    }
+    base_us_ = file_.time(0);
+    start_us_ = FrameClock::usecs();
+    replayTimeoutSlot();
+}
+
+void TraceReplayer::stop()
+{
+    timer_->stop();
+}
+
+bool TraceReplayer::isRunning() const
+{
+    return timer_->isActive();
+}
+
+int TraceReplayer::feedParser(const TraceFile &trace, CytParser &parser)
+{
+    int count = 0;
+    QByteArray message;
+    for (int i = 0; i < trace.count(); i++)
+    {
+        parser.feed(trace.data(i));
+        CytParser::Result result = CytParser::NeedMore;
+        while ((result = parser.next(message)) != CytParser::NeedMore)
+        {
+            if (result != CytParser::Chunk)
+            {
+                count++;
+            }
+        }
+    }
+    return count;
+}
+
+void TraceReplayer::replayTimeoutSlot()
+{
+    qint64 elapsed = (qint64)((FrameClock::usecs() - start_us_) * speed_);
+    while (next_ < file_.count())
+    {
+        if (speed_ > 0 && file_.time(next_) - base_us_ > elapsed)
+        {
+            break;
+        }
+        emit dataRead(file_.data(next_));
+        next_++;
+    }
+    if (next_ >= file_.count())
+    {
+        emit finished();
+        return;
+    }
+    qint64 due = file_.time(next_) - base_us_ - elapsed;
+    timer_->start(qMax(1, (int)(due / speed_ / 1000)));
+}
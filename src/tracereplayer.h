@@ -0,0 +1,51 @@
+#ifndef TRACEREPLAYER_H
+#define TRACEREPLAYER_H
+
+#include <QObject>
+#include <QByteArray>
+#include "tracefile.h"
+
+class QTimer;
+class CytParser;
+
+/* Plays a protocol trace back as the socket reads it was recorded from.
+ * speed 1 keeps the recorded spacing, N replays N times faster and 0 emits
+ * every read at once. feedParser() is the max speed path without signals,
+ * for throughput numbers and regression runs of the framer.
+*/
+class TraceReplayer : public QObject
+{
+    Q_OBJECT
+public:
+    explicit TraceReplayer(QObject *parent = 0);
+
+    bool open(const QString &path);
+    void setSpeed(double speed);
+    int count() const;
+    int position() const;
+
+    void start();
+    void stop();
+    bool isRunning() const;
+
+    // feeds every read into parser, returns the number of framed messages
+    static int feedParser(const TraceFile &trace, CytParser &parser);
+
+signals:
+    // data shares the trace mapping, copy it if it is kept beyond the call
+    void dataRead(const QByteArray &data);
+    void finished();
+
+private slots:
+    void replayTimeoutSlot();
+
+private:
+    TraceFile file_;
+    QTimer *timer_;
+    double speed_;
+    int next_;
+    qint64 start_us_;   // FrameClock at start()
+    qint64 base_us_;    // trace time of the first record
+};
+
+#endif // TRACEREPLAYER_H
@@ -0,0 +1,243 @@
+#include "tscimage.h"
+#include "mdatabase.h"
+#include "compactconfig.h"
+
+#include <string.h>
+
+static const int table_size_list[TscImage::TableCount] =
+{
+    sizeof(TSCHeader_t),
+    sizeof(Unit_t),
+    sizeof(Schedule_t),
+    sizeof(TimeSection_t),
+    sizeof(Pattern_t),
+    sizeof(TimeConfig_t),
+    sizeof(Phase_t),
+    sizeof(PhaseError_t),
+    sizeof(Channel_t),
+    sizeof(ChannelHint_t),
+    sizeof(Detector_t)
+};
+
+// read by a closed image
+static const TSCParam empty_param;
+
+TscImage::TscImage()
+{
+    map_ = NULL;
+    data_ = NULL;
+}
+
+TscImage::~TscImage()
+{
+    close();
+}
+
+bool TscImage::open(const QString &path)
+{
+    close();
+    file_.setFileName(path);
+    if (!file_.open(QIODevice::ReadOnly))
+    {
+        error_ = file_.errorString();
+        return false;
+    }
+    if (CompactConfig::isCompact(file_.peek(COMPACT_HEADER_SIZE).constData(), COMPACT_HEADER_SIZE))
+    {
+        QByteArray compact = file_.readAll();
+        file_.close();
+        if (!CompactConfig::decode(compact.constData(), compact.size(), decoded_, &error_))
+        {
+            decoded_.clear();
+            return false;
+        }
+        data_ = (const uchar *)decoded_.constData();
+        error_.clear();
+        return true;
+    }
+    if (file_.size() != imageSize())
+    {
+        error_ = QString("image of %1 bytes, %2 expected").arg(file_.size()).arg(imageSize());
+        file_.close();
+        return false;
+    }
+    map_ = file_.map(0, imageSize());
+    if (map_ == NULL)
+    {
+        error_ = file_.errorString();
+        file_.close();
+        return false;
+    }
+    data_ = map_;
+    error_.clear();
+    return true;
+}
+
+bool TscImage::load(const QByteArray &data)
+{
+    close();
+    if (CompactConfig::isCompact(data.constData(), data.size()))
+    {
+        if (!CompactConfig::decode(data.constData(), data.size(), decoded_, &error_))
+        {
+            decoded_.clear();
+            return false;
+        }
+    }
+    else if (data.size() != imageSize())
+    {
+        error_ = QString("image of %1 bytes, %2 expected").arg(data.size()).arg(imageSize());
+        return false;
+    }
+    else
+    {
+        decoded_ = data;
+    }
+    data_ = (const uchar *)decoded_.constData();
+    error_.clear();
+    return true;
+}
+
+void TscImage::close()
+{
+    if (map_ != NULL)
+    {
+        file_.unmap((uchar *)map_);
+        map_ = NULL;
+    }
+    if (file_.isOpen())
+    {
+        file_.close();
+    }
+    decoded_.clear();
+    data_ = NULL;
+}
+
+bool TscImage::isOpen() const
+{
+    return data_ != NULL;
+}
+
+QString TscImage::errorString() const
+{
+    return error_;
+}
+
+const char *TscImage::tableData(Table table) const
+{
+    if (data_ == NULL)
+    {
+        return NULL;
+    }
+    return (const char *)data_ + tableOffset(table);
+}
+
+int TscImage::tableSize(Table table)
+{
+    return table_size_list[table];
+}
+
+int TscImage::tableOffset(Table table)
+{
+    int offset = 0;
+    for (int i = 0; i < table; i++)
+    {
+        offset += table_size_list[i];
+    }
+    return offset;
+}
+
+int TscImage::imageSize()
+{
+    return tableOffset(TableCount);
+}
+
+const Schedule_t &TscImage::schedule() const
+{
+    const char *data = alignedTable(Schedule, Q_ALIGNOF(Schedule_t));
+    return data != NULL ? *(const Schedule_t *)data : empty_param.sched_table_;
+}
+
+const TimeSection_t &TscImage::timeSection() const
+{
+    const char *data = alignedTable(TimeSection, Q_ALIGNOF(TimeSection_t));
+    return data != NULL ? *(const TimeSection_t *)data : empty_param.time_section_table_;
+}
+
+const Pattern_t &TscImage::pattern() const
+{
+    const char *data = alignedTable(Pattern, Q_ALIGNOF(Pattern_t));
+    return data != NULL ? *(const Pattern_t *)data : empty_param.timing_plan_table_;
+}
+
+const TimeConfig_t &TscImage::timeConfig() const
+{
+    const char *data = alignedTable(TimeConfig, Q_ALIGNOF(TimeConfig_t));
+    return data != NULL ? *(const TimeConfig_t *)data : empty_param.stage_timing_table_;
+}
+
+void TscImage::copyTo(TSCParam &param) const
+{
+    if (data_ == NULL)
+    {
+        param = empty_param;
+        return;
+    }
+    memcpy(&param.tsc_header_, tableData(Header), tableSize(Header));
+    memcpy(&param.unit_param_, tableData(Unit), tableSize(Unit));
+    memcpy(&param.sched_table_, tableData(Schedule), tableSize(Schedule));
+    memcpy(&param.time_section_table_, tableData(TimeSection), tableSize(TimeSection));
+    memcpy(&param.timing_plan_table_, tableData(Pattern), tableSize(Pattern));
+    memcpy(&param.stage_timing_table_, tableData(TimeConfig), tableSize(TimeConfig));
+    memcpy(&param.phase_table_, tableData(Phase), tableSize(Phase));
+    memcpy(&param.phase_conflict_table_, tableData(PhaseError), tableSize(PhaseError));
+    memcpy(&param.channel_table_, tableData(Channel), tableSize(Channel));
+    memcpy(&param.channel_hint_table_, tableData(ChannelHint), tableSize(ChannelHint));
+    memcpy(&param.detector_table_, tableData(Detector), tableSize(Detector));
+}
+
+void TscImage::copyTo(MDatabase *db) const
+{
+    if (data_ == NULL)
+    {
+        return;
+    }
+    memcpy(&db->get_tsc_header(), tableData(Header), tableSize(Header));
+    memcpy(&db->get_unit_table(), tableData(Unit), tableSize(Unit));
+    memcpy(&db->get_schedule(), tableData(Schedule), tableSize(Schedule));
+    memcpy(&db->get_timesection(), tableData(TimeSection), tableSize(TimeSection));
+    memcpy(&db->get_timingplan(), tableData(Pattern), tableSize(Pattern));
+    memcpy(&db->get_timeconfig(), tableData(TimeConfig), tableSize(TimeConfig));
+    memcpy(&db->get_phase(), tableData(Phase), tableSize(Phase));
+    memcpy(&db->get_phase_err(), tableData(PhaseError), tableSize(PhaseError));
+    memcpy(&db->get_channel(), tableData(Channel), tableSize(Channel));
+    memcpy(&db->get_channel_hint(), tableData(ChannelHint), tableSize(ChannelHint));
+    memcpy(&db->get_detector(), tableData(Detector), tableSize(Detector));
+    db->rebuild_index();
+}
+
+QByteArray TscImage::pack(const TSCParam &param)
+{
+    QByteArray image;
+    image.reserve(imageSize());
+    image.append((const char *)&param.tsc_header_, tableSize(Header));
+    image.append((const char *)&param.unit_param_, tableSize(Unit));
+    image.append((const char *)&param.sched_table_, tableSize(Schedule));
+    image.append((const char *)&param.time_section_table_, tableSize(TimeSection));
+    image.append((const char *)&param.timing_plan_table_, tableSize(Pattern));
+    image.append((const char *)&param.stage_timing_table_, tableSize(TimeConfig));
+    image.append((const char *)&param.phase_table_, tableSize(Phase));
+    image.append((const char *)&param.phase_conflict_table_, tableSize(PhaseError));
+    image.append((const char *)&param.channel_table_, tableSize(Channel));
+    image.append((const char *)&param.channel_hint_table_, tableSize(ChannelHint));
+    image.append((const char *)&param.detector_table_, tableSize(Detector));
+    return image;
+}
+
+// NULL when closed; the fixed table layout keeps these offsets aligned
+const char *TscImage::alignedTable(Table table, int align) const
+{
+    Q_ASSERT(tableOffset(table) % align == 0);
+    Q_UNUSED(align);
+    return tableData(table);
+}
@@ -0,0 +1,78 @@
+#ifndef TSCIMAGE_H
+#define TSCIMAGE_H
+
+#include <QFile>
+#include <QString>
+#include <QByteArray>
+#include "tscparam.h"
+
+class MDatabase;
+
+/* Read-only view of a controller config image (.dat).
+ * The file is the tables of TSCParam written back to back without padding.
+ * open() maps it once and checks its size, the tables are then read in
+ * place. The schedule tables the gui walks start at offsets that suit their
+ * alignment and are handed out as references into the mapping; copyTo()
+ * fills a TSCParam or MDatabase with one memcpy per table.
+ * A file in the compact form (see CompactConfig) is decoded into memory
+ * instead, the views read the same. An image that is not open reads as
+ * empty tables. Close it before the file is replaced, windows does not
+ * rename over a mapped file.
+*/
+class TscImage
+{
+public:
+    TscImage();
+    ~TscImage();
+
+    enum Table
+    {
+        Header = 0,
+        Unit,
+        Schedule,
+        TimeSection,
+        Pattern,
+        TimeConfig,
+        Phase,
+        PhaseError,
+        Channel,
+        ChannelHint,
+        Detector,
+        TableCount
+    };
+
+    bool open(const QString &path);
+    // image or compact config already in memory, a legacy image is not copied
+    bool load(const QByteArray &data);
+    void close();
+    bool isOpen() const;
+    QString errorString() const;
+
+    const char *tableData(Table table) const;
+    static int tableSize(Table table);
+    static int tableOffset(Table table);
+    static int imageSize();
+
+    const Schedule_t &schedule() const;
+    const TimeSection_t &timeSection() const;
+    const Pattern_t &pattern() const;
+    const TimeConfig_t &timeConfig() const;
+
+    void copyTo(TSCParam &param) const;
+    void copyTo(MDatabase *db) const;
+
+    // the legacy image of param, as the controller takes it
+    static QByteArray pack(const TSCParam &param);
+
+private:
+    const char *alignedTable(Table table, int align) const;
+
+private:
+    QFile file_;
+    const uchar *map_;
+    QByteArray decoded_;    // image of a compact file or of load()
+    const uchar *data_;     // map_ or decoded_, NULL when closed
+    QString error_;
+};
+
+#endif // TSCIMAGE_H